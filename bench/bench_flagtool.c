@@ -0,0 +1,953 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime, dup
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "flagtool.h"
+#include "flagtool_static.h"
+#include "../src/flagtool_internal.h" // ft_hash_name for colliding names, ft_release_usage
+
+#define BENCH_LOOKUPS 2000000   // Lookups timed per measurement
+#define BENCH_COLLIDE_LOOKUPS 200000 // Fewer, every lookup walks a long cluster
+#define BENCH_REGISTRATIONS 200000 // Flags registered per measurement
+#define BENCH_PARSE_ARGS 2000000 // Arguments parsed per measurement
+#define BENCH_VECTORS 20000     // Command lines per batch
+#define BENCH_BATCHES 10        // Batches timed per measurement
+#define BENCH_MAX_THREADS 8
+#define BENCH_COLLIDE_BITS 12   // Colliding names share this many low hash bits
+#define BENCH_LIST_VALUES 1000000 // Values in the --ids list
+#define BENCH_LIST_ROUNDS 20      // Parses timed per measurement
+#define BENCH_STARTUPS 200000     // Process startups simulated per measurement
+#define BENCH_WIDE_ARGS 4000000   // Arguments parsed per measurement of the wide suite
+#define BENCH_IMAGE_FLAGS 4000000 // Flags brought up per measurement of the image suite
+#define BENCH_IMAGE_PATH "/tmp/bench_flagtool.img"
+#define BENCH_STREAM_VALUES 1000000 // --user values per measurement of the stream suite
+#define BENCH_NUMBER_VALUES 1000000 // Values per mix of the numbers suite
+#define BENCH_PARALLEL_ARGS 4000000 // Arguments in the one argv of the parallel suite
+#define BENCH_ENV_FLAGS 400       // Flags bound to APP_* variables, every other one set
+#define BENCH_ENV_OTHER 200       // Unrelated variables in the environment
+#define BENCH_ENV_ROUNDS 2000     // Passes over the environment per measurement
+#define BENCH_COMPLETE_FLAGS 2000 // Flags (half of them boolean) in the complete suite
+#define BENCH_COMPLETE_QUERIES 200000 // Completions timed per measurement
+#define BENCH_COMMANDS 40         // Subcommands of the multi-tool in the commands suite
+#define BENCH_COMMAND_FLAGS 25    // Flags of each subcommand
+#define BENCH_COMMAND_STARTUPS 2000 // Startups timed per measurement
+#define BENCH_INTERN_VALUES 1000000 // --user values per parse of the intern suite
+#define BENCH_INTERN_DISTINCT 1000  // Distinct users among them
+#define BENCH_INTERN_ROUNDS 5       // Warm parses timed per measurement
+#define BENCH_CONFIG_KEYS 20000     // Keys of the config file in the config suite
+#define BENCH_CONFIG_CHANGED 10     // Keys changed between versions
+#define BENCH_CONFIG_ROUNDS 50      // Reloads timed per measurement
+#define BENCH_CONFIG_PATH "/tmp/bench_flagtool.conf"
+
+// Output format of the results, one record per measurement
+static enum { FORMAT_CSV, FORMAT_JSON } format = FORMAT_CSV;
+static int records;
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Print one result as a CSV row or JSON object
+static void report(const char *suite, const char *name, long n, const char *metric, double value) {
+    if (format == FORMAT_JSON) {
+        printf("%s\n  {\"suite\": \"%s\", \"case\": \"%s\", \"n\": %ld, \"metric\": \"%s\", \"value\": %.3f}",
+               records ? "," : "[", suite, name, n, metric, value);
+    } else {
+        if (!records) printf("suite,case,n,metric,value\n");
+        printf("%s,%s,%ld,%s,%.3f\n", suite, name, n, metric, value);
+    }
+    records++;
+    fflush(stdout);
+}
+
+static void fail(const char *what) {
+    fprintf(stderr, "bench: %s failed\n", what);
+    exit(1);
+}
+
+// Names "<prefix><i>", caller frees with free_names()
+static char **make_names(int count, const char *prefix) {
+    char **names = malloc(count * sizeof(char *));
+    for (int i = 0; i < count; i++) {
+        names[i] = malloc(64);
+        snprintf(names[i], 64, "%s%d", prefix, i);
+    }
+    return names;
+}
+
+static void free_names(char **names, int count) {
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+// Names whose registry hashes all share their low bits, so in any table of
+// up to 2^BENCH_COLLIDE_BITS slots they pile into one probe sequence
+static char **make_colliding_names(int count) {
+    char **names = malloc(count * sizeof(char *));
+    char buf[64];
+    uint64_t mask = (1ULL << BENCH_COLLIDE_BITS) - 1;
+    int found = 0;
+    for (unsigned long i = 0; found < count; i++) {
+        int len = snprintf(buf, sizeof(buf), "--collide-%lu", i);
+        if ((ft_hash_name(buf, (size_t)len) & mask) == 0) names[found++] = strdup(buf);
+    }
+    return names;
+}
+
+// Look up names `lookups` times, returns ns per lookup
+static double time_lookups(FlagSet *set, char **names, int name_count, int lookups, int expect_hits) {
+    int found = 0;
+    double start = now_ns();
+    for (int i = 0; i < lookups; i++) {
+        found += flagset_find(set, names[(i * 7919UL) % name_count]) != NULL; // Stride over the names
+    }
+    double elapsed = now_ns() - start;
+    if (found != (expect_hits ? lookups : 0)) fail("lookup check");
+    return elapsed / lookups;
+}
+
+// Registration cost per flag, with malloc and with the arena
+static void bench_register() {
+    static const int sizes[] = { 100, 1000, 10000, 100000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        char **names = make_names(count, "--service-option-");
+        int rounds = BENCH_REGISTRATIONS / count;
+        for (int arena = 0; arena < 2; arena++) {
+            double elapsed = 0;
+            for (int r = 0; r < rounds; r++) {
+                FlagSet *set = flagset_new();
+                if (arena) flagset_use_arena(set, NULL, 0);
+                double start = now_ns();
+                for (int i = 0; i < count; i++) flagset_string(set, NULL, "Benchmark flag", names[i], NULL);
+                elapsed += now_ns() - start;
+                flagset_free(set);
+            }
+            report("register", arena ? "arena" : "malloc", count, "ns_per_flag", elapsed / ((double)rounds * count));
+        }
+        free_names(names, count);
+    }
+}
+
+// flag_find hit and miss latency from 10 to 100k flags, table and frozen
+static void bench_find() {
+    static const int sizes[] = { 10, 100, 1000, 10000, 100000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        char **names = make_names(count, "--service-option-");
+        char **missing = make_names(count, "--missing-option-");
+        FlagSet *set = flagset_new();
+        for (int i = 0; i < count; i++) flagset_string(set, NULL, "Benchmark flag", names[i], NULL);
+
+        report("find", "table_hit", count, "ns_per_op", time_lookups(set, names, count, BENCH_LOOKUPS, 1));
+        report("find", "table_miss", count, "ns_per_op", time_lookups(set, missing, count, BENCH_LOOKUPS, 0));
+        if (flagset_freeze(set) != 0) fail("flagset_freeze");
+        report("find", "frozen_hit", count, "ns_per_op", time_lookups(set, names, count, BENCH_LOOKUPS, 1));
+        report("find", "frozen_miss", count, "ns_per_op", time_lookups(set, missing, count, BENCH_LOOKUPS, 0));
+
+        flagset_free(set);
+        free_names(names, count);
+        free_names(missing, count);
+    }
+}
+
+// flag_find when every name collides in the open-addressing table
+static void bench_find_collisions() {
+    static const int sizes[] = { 100, 1000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        char **all = make_colliding_names(count * 2);
+        char **names = all, **missing = all + count; // Misses collide as well
+        FlagSet *set = flagset_new();
+        for (int i = 0; i < count; i++) flagset_string(set, NULL, "Benchmark flag", names[i], NULL);
+
+        report("find_collide", "table_hit", count, "ns_per_op", time_lookups(set, names, count, BENCH_COLLIDE_LOOKUPS, 1));
+        report("find_collide", "table_miss", count, "ns_per_op", time_lookups(set, missing, count, BENCH_COLLIDE_LOOKUPS, 0));
+        if (flagset_freeze(set) != 0) fail("flagset_freeze");
+        report("find_collide", "frozen_hit", count, "ns_per_op", time_lookups(set, names, count, BENCH_COLLIDE_LOOKUPS, 1));
+        report("find_collide", "frozen_miss", count, "ns_per_op", time_lookups(set, missing, count, BENCH_COLLIDE_LOOKUPS, 0));
+
+        flagset_free(set);
+        free_names(all, count * 2);
+    }
+}
+
+// Fill argv with argc - 1 arguments of one form, cycling over a few flags
+static void fill_argv(char **argv, int argc, const char *form) {
+    static char *eq[] = { "--name=build", "--count=42", "--user=alice", "--retries=3" };
+    static char *neg[] = { "--verbose", "--no-verbose", "--dry-run", "--no-dry-run" };
+    argv[0] = "bench";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(form, "eq") == 0) {
+            argv[i] = eq[i % 2]; // Single-value flags only
+        } else if (strcmp(form, "sep") == 0) {
+            argv[i] = (i % 2) ? (i % 4 == 1 ? "--name" : "--count") : (i % 4 == 2 ? "build" : "42");
+        } else if (strcmp(form, "bool") == 0) {
+            argv[i] = neg[i % 4];
+        } else if (strcmp(form, "multi") == 0) {
+            argv[i] = eq[2 + i % 2];
+        } else { // mixed
+            int k = i % 6;
+            argv[i] = k < 4 ? eq[k] : neg[k - 3];
+        }
+    }
+    if (strcmp(form, "sep") == 0 && argc % 2 == 0) argv[argc - 1] = "--verbose"; // No dangling name
+}
+
+// flag_parse throughput across argv sizes and argument forms
+static void bench_parse() {
+    static const int sizes[] = { 10, 100, 1000, 10000 };
+    static const char *forms[] = { "eq", "sep", "bool", "multi", "mixed" };
+
+    FlagSet *set = flagset_new();
+    flagset_string(set, "", "Job name", "--name", "-n", NULL);
+    flagset_int(set, 0, "Count", "--count", "-c", NULL);
+    flagset_bool(set, 0, "Verbose", "--verbose", "-v", NULL);
+    flagset_bool(set, 0, "Dry run", "--dry-run", NULL);
+    flagset_string_multi(set, NULL, "Users", "--user", "-u", NULL);
+    flagset_int_multi(set, 0, "Retries", "--retries", "-r", NULL);
+    char **padding = make_names(64, "--unused-option-"); // A realistic table size
+    for (int i = 0; i < 64; i++) flagset_string(set, NULL, "Unused", padding[i], NULL);
+
+    for (size_t f = 0; f < sizeof(forms) / sizeof(forms[0]); f++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            int argc = sizes[s] + 1;
+            char **argv = malloc((argc + 1) * sizeof(char *));
+            fill_argv(argv, argc, forms[f]);
+            argv[argc] = NULL;
+
+            int rounds = BENCH_PARSE_ARGS / sizes[s];
+            flagset_parse(set, argc, argv); // Warm up value buffers
+            double start = now_ns();
+            for (int r = 0; r < rounds; r++) {
+                flagset_reset(set);
+                if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+            }
+            double elapsed = now_ns() - start;
+            report("parse", forms[f], sizes[s], "args_per_s", (double)rounds * sizes[s] / (elapsed / 1e9));
+            free(argv);
+        }
+    }
+    flagset_free(set);
+    free_names(padding, 64);
+}
+
+// One argv of four million mixed arguments, serial flag_parse against
+// flagset_parse_parallel on 1 to BENCH_MAX_THREADS threads
+static void bench_parallel() {
+    FlagSet *set = flagset_new();
+    flagset_string(set, "", "Job name", "--name", "-n", NULL);
+    flagset_int(set, 0, "Count", "--count", "-c", NULL);
+    flagset_bool(set, 0, "Verbose", "--verbose", "-v", NULL);
+    flagset_bool(set, 0, "Dry run", "--dry-run", NULL);
+    flagset_string_multi(set, NULL, "Users", "--user", "-u", NULL);
+    flagset_int_multi(set, 0, "Retries", "--retries", "-r", NULL);
+    int argc = BENCH_PARALLEL_ARGS + 1;
+    char **argv = malloc((argc + 1) * sizeof(char *));
+    fill_argv(argv, argc, "mixed");
+    argv[argc] = NULL;
+
+    flagset_parse(set, argc, argv); // Warm up value buffers
+    flagset_reset(set);
+    double start = now_ns();
+    if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+    report("parallel", "serial", 1, "args_per_s", BENCH_PARALLEL_ARGS / ((now_ns() - start) / 1e9));
+    for (int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        flagset_reset(set);
+        start = now_ns();
+        if (flagset_parse_parallel(set, argc, argv, threads) != 0) fail("flagset_parse_parallel");
+        report("parallel", "threads", threads, "args_per_s", BENCH_PARALLEL_ARGS / ((now_ns() - start) / 1e9));
+    }
+    free(argv);
+    flagset_free(set);
+}
+
+// Environment fallback: one getenv() per flag against one indexed pass over environ
+static void bench_env() {
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "APP_");
+    char **names = make_names(BENCH_ENV_FLAGS, "--opt-");
+    char **vars = make_names(BENCH_ENV_FLAGS, "APP_OPT_");
+    char **other = make_names(BENCH_ENV_OTHER, "UNRELATED_");
+    int *values = calloc(BENCH_ENV_FLAGS, sizeof(int));
+    for (int i = 0; i < BENCH_ENV_FLAGS; i++) {
+        flagset_int_var(set, &values[i], 0, "Option", names[i], NULL);
+        if (i % 2 == 0) setenv(vars[i], "7", 1);
+    }
+    for (int i = 0; i < BENCH_ENV_OTHER; i++) setenv(other[i], "x", 1);
+
+    long naive_sum = 0;
+    double start = now_ns();
+    for (int r = 0; r < BENCH_ENV_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_ENV_FLAGS; i++) {
+            const char *v = getenv(vars[i]);
+            if (v) naive_sum += strtol(v, NULL, 10);
+        }
+    }
+    report("env", "getenv", BENCH_ENV_FLAGS, "ns_per_pass", (now_ns() - start) / BENCH_ENV_ROUNDS);
+
+    long sum = 0;
+    start = now_ns();
+    for (int r = 0; r < BENCH_ENV_ROUNDS; r++) {
+        if (flagset_apply_env(set) != 0) fail("flagset_apply_env");
+        for (int i = 0; i < BENCH_ENV_FLAGS; i++) sum += values[i];
+    }
+    report("env", "apply_env", BENCH_ENV_FLAGS, "ns_per_pass", (now_ns() - start) / BENCH_ENV_ROUNDS);
+    if (sum != naive_sum) fail("environment values");
+
+    for (int i = 0; i < BENCH_ENV_FLAGS; i++) unsetenv(vars[i]);
+    for (int i = 0; i < BENCH_ENV_OTHER; i++) unsetenv(other[i]);
+    free(values);
+    free_names(names, BENCH_ENV_FLAGS);
+    free_names(vars, BENCH_ENV_FLAGS);
+    free_names(other, BENCH_ENV_OTHER);
+    flagset_free(set);
+}
+
+// Bytes in use on the heap, mapped blocks included
+static double heap_bytes() {
+    struct mallinfo2 mi = mallinfo2();
+    return (double)(mi.uordblks + mi.hblkhd);
+}
+
+// Repetitive string multi values (users of an access log) stored per
+// occurrence against interned: heap grown by the first parse, then warm parses
+static void bench_intern() {
+    char **users = make_names(BENCH_INTERN_DISTINCT, "user-");
+    int argc = 2 * BENCH_INTERN_VALUES + 1;
+    char **argv = malloc((argc + 1) * sizeof(char *));
+    argv[0] = "bench";
+    for (int i = 0; i < BENCH_INTERN_VALUES; i++) {
+        argv[1 + 2 * i] = "-u";
+        argv[2 + 2 * i] = users[(i * 7919UL) % BENCH_INTERN_DISTINCT];
+    }
+    argv[argc] = NULL;
+
+    for (int interned = 0; interned <= 1; interned++) {
+        const char *name = interned ? "interned" : "plain";
+        FlagSet *set = flagset_new();
+        Flag *f = flagset_string_multi(set, NULL, "Users", "--user", "-u", NULL);
+        if (interned) flag_intern(f);
+
+        double before = heap_bytes();
+        if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+        report("intern", name, BENCH_INTERN_VALUES, "heap_bytes", heap_bytes() - before);
+        if (interned && flag_get_distinct_count(f) != BENCH_INTERN_DISTINCT) fail("distinct count");
+
+        double start = now_ns();
+        for (int r = 0; r < BENCH_INTERN_ROUNDS; r++) {
+            flagset_reset(set);
+            if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+        }
+        report("intern", name, BENCH_INTERN_VALUES, "values_per_s",
+               (double)BENCH_INTERN_ROUNDS * BENCH_INTERN_VALUES / ((now_ns() - start) / 1e9));
+        flagset_free(set);
+    }
+    free(argv);
+    free_names(users, BENCH_INTERN_DISTINCT);
+}
+
+// Write version `round` of the config file: the first BENCH_CONFIG_CHANGED
+// keys change with every version, the rest never do. Renamed into place.
+static void write_config(int round) {
+    FILE *f = fopen(BENCH_CONFIG_PATH ".tmp", "w");
+    if (!f) fail("fopen");
+    for (int i = 0; i < BENCH_CONFIG_KEYS; i++) {
+        if (i % 2) fprintf(f, "key-%d = %d\n", i, i < BENCH_CONFIG_CHANGED ? round : i);
+        else fprintf(f, "key-%d = value-%d\n", i, i < BENCH_CONFIG_CHANGED ? round : i);
+    }
+    fclose(f);
+    if (rename(BENCH_CONFIG_PATH ".tmp", BENCH_CONFIG_PATH) != 0) fail("rename");
+}
+
+// Config file with a few changed keys per version: everything reset and
+// loaded again against an incremental reload, and a poll with no change
+static void bench_config() {
+    FlagSet *set = flagset_new();
+    char **names = make_names(BENCH_CONFIG_KEYS, "--key-");
+    for (int i = 0; i < BENCH_CONFIG_KEYS; i++) {
+        if (i % 2) flagset_int(set, 0, "Option", names[i], NULL);
+        else flagset_string(set, "", "Option", names[i], NULL);
+    }
+    double full = 0, incremental = 0;
+    for (int r = 0; r < BENCH_CONFIG_ROUNDS; r++) {
+        write_config(r);
+        double start = now_ns();
+        flagset_reset(set);
+        if (flagset_load_config(set, BENCH_CONFIG_PATH) != 0) fail("flagset_load_config");
+        full += now_ns() - start;
+    }
+    report("config", "full", BENCH_CONFIG_KEYS, "ns_per_reload", full / BENCH_CONFIG_ROUNDS);
+    for (int r = 0; r < BENCH_CONFIG_ROUNDS; r++) {
+        write_config(BENCH_CONFIG_ROUNDS + r);
+        double start = now_ns();
+        if (flagset_reload_config(set) != 0) fail("flagset_reload_config");
+        incremental += now_ns() - start;
+    }
+    report("config", "incremental", BENCH_CONFIG_KEYS, "ns_per_reload", incremental / BENCH_CONFIG_ROUNDS);
+    if (flag_get_int(flagset_find(set, "--key-1")) != 2 * BENCH_CONFIG_ROUNDS - 1) fail("reloaded value");
+
+    double start = now_ns();
+    for (int r = 0; r < BENCH_CONFIG_ROUNDS; r++) {
+        if (flagset_reload_config(set) != 0) fail("flagset_reload_config");
+    }
+    report("config", "unchanged", BENCH_CONFIG_KEYS, "ns_per_reload", (now_ns() - start) / BENCH_CONFIG_ROUNDS);
+    unlink(BENCH_CONFIG_PATH);
+    free_names(names, BENCH_CONFIG_KEYS);
+    flagset_free(set);
+}
+
+// Completion of a Tab press: first query (sorting the names) and warm queries,
+// then abbreviated against exact names in a parse
+static void bench_complete() {
+    char **names = make_names(BENCH_COMPLETE_FLAGS, "--option-");
+    const char *matches[16];
+    double start = now_ns();
+    FlagSet *set = flagset_new();
+    for (int i = 0; i < BENCH_COMPLETE_FLAGS; i++) {
+        if (i % 2) flagset_bool(set, 0, "Switch", names[i], NULL);
+        else flagset_int(set, 0, "Option", names[i], NULL);
+    }
+    double registered = now_ns();
+    int n = flagset_complete(set, "--option-123", matches, 16);
+    double done = now_ns();
+    if (n != 11) fail("flagset_complete");
+    report("complete", "register", BENCH_COMPLETE_FLAGS, "us", (registered - start) / 1e3);
+    report("complete", "first_query", BENCH_COMPLETE_FLAGS, "us", (done - registered) / 1e3);
+
+    static const char *partials[] = { "--option-1", "--option-42", "--no-option-77", "--zzz" };
+    long total = 0;
+    start = now_ns();
+    for (int q = 0; q < BENCH_COMPLETE_QUERIES; q++) {
+        total += flagset_complete(set, partials[q & 3], matches, 16);
+    }
+    report("complete", "query", BENCH_COMPLETE_FLAGS, "ns_per_query", (now_ns() - start) / BENCH_COMPLETE_QUERIES);
+    if (total == 0) fail("flagset_complete");
+
+    flagset_allow_abbrev(set, 1);
+    flagset_string(set, "", "Long name", "--option-with-a-long-name", NULL);
+    char *exact[] = { "bench", "--option-1998=1", "--option-with-a-long-name=x" };
+    char *abbrev[] = { "bench", "--option-1998=1", "--option-w=x" };
+    start = now_ns();
+    for (int q = 0; q < BENCH_COMPLETE_QUERIES; q++) {
+        if (flagset_parse(set, 3, exact) != 0) fail("flagset_parse");
+    }
+    report("complete", "exact_parse", 2, "ns_per_parse", (now_ns() - start) / BENCH_COMPLETE_QUERIES);
+    start = now_ns();
+    for (int q = 0; q < BENCH_COMPLETE_QUERIES; q++) {
+        if (flagset_parse(set, 3, abbrev) != 0) fail("flagset_parse abbreviated");
+    }
+    report("complete", "abbrev_parse", 2, "ns_per_parse", (now_ns() - start) / BENCH_COMPLETE_QUERIES);
+    free_names(names, BENCH_COMPLETE_FLAGS);
+    flagset_free(set);
+}
+
+static char **command_flag_names;
+
+// Flags of one subcommand of the multi-tool
+static void register_command_flags(FlagSet *set, void *ctx) {
+    (void)ctx;
+    for (int i = 0; i < BENCH_COMMAND_FLAGS; i++) {
+        if (i % 3 == 0) flagset_bool(set, 0, "Switch", command_flag_names[i], NULL);
+        else if (i % 3 == 1) flagset_int(set, 0, "Count", command_flag_names[i], NULL);
+        else flagset_string(set, "", "Name", command_flag_names[i], NULL);
+    }
+}
+
+// Startup of a multi-tool running one of its subcommands: every command's
+// flags registered up front against only the invoked command's
+static void bench_commands() {
+    command_flag_names = make_names(BENCH_COMMAND_FLAGS, "--flag-");
+    char **commands = make_names(BENCH_COMMANDS, "cmd");
+    char *argv[] = { "tool", "--verbose", "cmd17", "--flag-1", "3", "--flag-2=x", "--flag-0", NULL };
+    int argc = 7;
+
+    double start = now_ns();
+    for (int r = 0; r < BENCH_COMMAND_STARTUPS; r++) {
+        FlagSet *set = flagset_new();
+        flagset_bool(set, 0, "Verbose output", "--verbose", "-v", NULL);
+        FlagSet *sets[BENCH_COMMANDS];
+        for (int c = 0; c < BENCH_COMMANDS; c++) {
+            sets[c] = flagset_new();
+            register_command_flags(sets[c], NULL);
+        }
+        // Dispatch by hand: global flags, then the command's set
+        if (flagset_parse(set, 2, argv) != 0) fail("flagset_parse");
+        if (flagset_parse(sets[17], argc - 2, argv + 2) != 0) fail("flagset_parse");
+        for (int c = 0; c < BENCH_COMMANDS; c++) flagset_free(sets[c]);
+        flagset_free(set);
+    }
+    report("commands", "eager", BENCH_COMMANDS, "ns_per_startup", (now_ns() - start) / BENCH_COMMAND_STARTUPS);
+
+    start = now_ns();
+    for (int r = 0; r < BENCH_COMMAND_STARTUPS; r++) {
+        FlagSet *set = flagset_new();
+        flagset_bool(set, 0, "Verbose output", "--verbose", "-v", NULL);
+        for (int c = 0; c < BENCH_COMMANDS; c++) {
+            flagset_command(set, commands[c], "Command", register_command_flags, NULL);
+        }
+        if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+        if (!flagset_active_command(set)) fail("flagset_active_command");
+        flagset_free(set);
+    }
+    report("commands", "lazy", BENCH_COMMANDS, "ns_per_startup", (now_ns() - start) / BENCH_COMMAND_STARTUPS);
+    free_names(commands, BENCH_COMMANDS);
+    free_names(command_flag_names, BENCH_COMMAND_FLAGS);
+}
+
+// print_flag_usage rendering time with stdout sent to /dev/null
+static void bench_usage() {
+    static const int sizes[] = { 10, 100, 1000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        char **names = make_names(count, "--service-option-");
+        FlagSet *set = flagset_new();
+        FlagGroup *group = flagset_create_group(set, "Service");
+        for (int i = 0; i < count; i++) {
+            Flag *f = (i % 3 == 0) ? flagset_int(set, i, "Numeric option", names[i], NULL)
+                    : (i % 3 == 1) ? flagset_bool(set, 0, "Switch option", names[i], NULL)
+                    : flagset_string(set, "value", "String option", names[i], NULL);
+            if (i % 2) add_flag_to_group(group, f);
+        }
+
+        int rounds = 200000 / count;
+        fflush(stdout);
+        int saved = dup(STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        double start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            ft_release_usage(set); // Render from the registry every time
+            flagset_print_usage(set, "bench");
+        }
+        fflush(stdout);
+        double elapsed = now_ns() - start;
+        start = now_ns();
+        for (int r = 0; r < rounds; r++) flagset_print_usage(set, "bench");
+        double cached = now_ns() - start;
+        dup2(saved, STDOUT_FILENO);
+        close(devnull);
+        close(saved);
+
+        report("usage", "render", count, "ns_per_render", elapsed / rounds);
+        report("usage", "cached", count, "ns_per_render", cached / rounds);
+        flagset_free(set);
+        free_names(names, count);
+    }
+}
+
+// flag_parse_batch throughput over 1 to BENCH_MAX_THREADS workers
+static void bench_batch_scaling() {
+    FlagSet *schema = flagset_new();
+    flagset_string(schema, "", "Job name", "--name", "-n", NULL);
+    flagset_int(schema, 0, "Priority", "--priority", "-p", NULL);
+    flagset_bool(schema, 0, "Dry run", "--dry-run", NULL);
+    flagset_string_multi(schema, NULL, "Users", "--user", "-u", NULL);
+    flagset_int_multi(schema, 0, "Retries", "--retries", "-r", NULL);
+    flagset_freeze(schema);
+
+    static char *templates[][9] = {
+        { "job", "--name=build", "-p", "3", "--dry-run", "-u", "alice", "-u", "bob" },
+        { "job", "-n", "deploy", "--priority=7", "--no-dry-run", "-r", "1", "-r", "2" },
+        { "job", "--user=carol", "--retries=5", "--name", "test", "-p", "1", "-u", "dave" },
+    };
+    int *argcs = malloc(BENCH_VECTORS * sizeof(int));
+    char ***argvs = malloc(BENCH_VECTORS * sizeof(char **));
+    FlagValues **results = malloc(BENCH_VECTORS * sizeof(FlagValues *));
+    for (int i = 0; i < BENCH_VECTORS; i++) {
+        argcs[i] = 9;
+        argvs[i] = templates[i % 3];
+        results[i] = flag_values_new(schema);
+    }
+
+    flag_parse_batch_threads(schema, BENCH_VECTORS, argcs, argvs, results, NULL, 1); // Warm up records
+    for (int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        double start = now_ns();
+        for (int b = 0; b < BENCH_BATCHES; b++) {
+            if (flag_parse_batch_threads(schema, BENCH_VECTORS, argcs, argvs, results, NULL, threads) != 0) {
+                fail("flag_parse_batch");
+            }
+        }
+        double rate = (double)BENCH_VECTORS * BENCH_BATCHES / ((now_ns() - start) / 1e9);
+        report("batch", "threads", threads, "vectors_per_s", rate);
+    }
+
+    for (int i = 0; i < BENCH_VECTORS; i++) flag_values_free(results[i]);
+    free(results);
+    free(argvs);
+    free(argcs);
+    flagset_free(schema);
+}
+
+// Build "v,v,...,v" with a mix of short and full-width values
+static char *make_int_list(int count) {
+    char *list = malloc((size_t)count * 12 + 1), *p = list;
+    srand(42);
+    for (int i = 0; i < count; i++) {
+        int v = (i % 4 == 0) ? rand() - RAND_MAX / 2 : rand() % 10000;
+        p += sprintf(p, i ? ",%d" : "%d", v);
+    }
+    return list;
+}
+
+// Delimited int list throughput, flagtool's list kernel against a strtol loop
+static void bench_int_list() {
+    char *list = make_int_list(BENCH_LIST_VALUES);
+    int *values = malloc(BENCH_LIST_VALUES * sizeof(int));
+
+    double start = now_ns();
+    long sum = 0;
+    for (int r = 0; r < BENCH_LIST_ROUNDS; r++) {
+        int count = 0;
+        for (char *p = list, *end;; p = end + 1) {
+            values[count++] = (int)strtol(p, &end, 10);
+            if (*end != ',') break;
+        }
+        sum += count;
+    }
+    report("int_list", "strtol", BENCH_LIST_VALUES, "values_per_s", (double)sum / ((now_ns() - start) / 1e9));
+
+    FlagSet *set = flagset_new();
+    Flag *ids = flag_separator(flagset_int_multi(set, 0, "IDs", "--ids", NULL), ',');
+    char *argv[] = { "bench", "--ids", list, NULL };
+    flagset_parse(set, 3, argv); // Warm up: grow the value array once
+    start = now_ns();
+    sum = 0;
+    for (int r = 0; r < BENCH_LIST_ROUNDS; r++) {
+        flagset_reset(set);
+        if (flagset_parse(set, 3, argv) != 0) fail("list parse");
+        sum += flag_get_multi_count(ids);
+    }
+    report("int_list", "flagtool", BENCH_LIST_VALUES, "values_per_s", (double)sum / ((now_ns() - start) / 1e9));
+
+    flagset_free(set);
+    free(values);
+    free(list);
+}
+
+// Parsing into registries of 1k+ flags, each argument setting a different
+// flag in scattered order, so every value store touches a cold cache line
+static void bench_wide() {
+    static const int sizes[] = { 1000, 4000, 16000, 64000 };
+    report("wide", "flag_hot_bytes", 1, "bytes", sizeof(Flag) + sizeof(FlagValue));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        char **names = make_names(count, "--service-option-");
+        FlagSet *set = flagset_new();
+        for (int i = 0; i < count; i++) {
+            if (i % 3 == 0) flagset_int(set, i, "Numeric option", names[i], NULL);
+            else if (i % 3 == 1) flagset_bool(set, 0, "Switch option", names[i], NULL);
+            else flagset_string(set, "value", "String option", names[i], NULL);
+        }
+        flagset_freeze(set);
+
+        // One argument per flag: --opt=N, --opt or --opt=value by type
+        char **argv = malloc((count + 2) * sizeof(char *));
+        argv[0] = "bench";
+        for (int i = 0; i < count; i++) {
+            int k = (int)((i * 7919UL) % count); // Stride over the registry
+            argv[i + 1] = malloc(80);
+            snprintf(argv[i + 1], 80, k % 3 == 1 ? "%s" : "%s=%d", names[k], k);
+        }
+        argv[count + 1] = NULL;
+
+        int rounds = BENCH_WIDE_ARGS / count;
+        flagset_parse(set, count + 1, argv); // Warm up value buffers
+        double start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            flagset_reset(set);
+            if (flagset_parse(set, count + 1, argv) != 0) fail("flagset_parse");
+        }
+        report("wide", "parse", count, "ns_per_arg", (now_ns() - start) / ((double)rounds * count));
+
+        for (int i = 1; i <= count; i++) free(argv[i]);
+        free(argv);
+        flagset_free(set);
+        free_names(names, count);
+    }
+}
+
+// Register the image suite's flags: every third one an int, bool or string
+static void register_service_flags(FlagSet *set, char **names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (i % 3 == 0) flagset_int(set, i, "Numeric option", names[i], NULL);
+        else if (i % 3 == 1) flagset_bool(set, 0, "Switch option", names[i], NULL);
+        else flagset_string(set, "value", "String option", names[i], NULL);
+    }
+}
+
+// Worker start-up: register and reparse the supervisor's command line, or
+// map the image it wrote and look every flag up in it
+static void bench_image() {
+    static const int sizes[] = { 100, 1000, 10000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        char **names = make_names(count, "--service-option-");
+        char **argv = malloc((count + 2) * sizeof(char *));
+        argv[0] = "bench";
+        for (int i = 0; i < count; i++) {
+            argv[i + 1] = malloc(80);
+            snprintf(argv[i + 1], 80, i % 3 == 1 ? "%s" : "%s=%d", names[i], i);
+        }
+        argv[count + 1] = NULL;
+
+        FlagSet *supervisor = flagset_new();
+        register_service_flags(supervisor, names, count);
+        if (flagset_parse(supervisor, count + 1, argv) != 0) fail("flagset_parse");
+        if (flagset_write_image(supervisor, BENCH_IMAGE_PATH) != 0) fail("flagset_write_image");
+        flagset_free(supervisor);
+
+        int rounds = BENCH_IMAGE_FLAGS / count;
+        long sum = 0;
+        double start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            FlagSet *set = flagset_new();
+            register_service_flags(set, names, count);
+            if (flagset_parse(set, count + 1, argv) != 0) fail("flagset_parse");
+            sum += flag_get_int(flagset_find(set, names[0]));
+            flagset_free(set);
+        }
+        report("image", "reparse", count, "ns_per_start", (now_ns() - start) / rounds);
+
+        start = now_ns();
+        for (int r = 0; r < rounds; r++) {
+            FlagSet *set = flagset_new();
+            if (flagset_map_image(set, BENCH_IMAGE_PATH) != 0) fail("flagset_map_image");
+            for (int i = 0; i < count; i++) sum += flagset_find(set, names[i]) != NULL;
+            sum += flag_get_int(flagset_find(set, names[0]));
+            flagset_free(set);
+        }
+        report("image", "map_find_all", count, "ns_per_start", (now_ns() - start) / rounds);
+        if (sum < 0) fail("image values");
+
+        unlink(BENCH_IMAGE_PATH);
+        for (int i = 1; i <= count; i++) free(argv[i]);
+        free(argv);
+        free_names(names, count);
+    }
+}
+
+static void count_value(const char *value, size_t len, void *ctx) {
+    *(size_t *)ctx += len + (value != NULL);
+}
+
+// A million --user values: stored by flag_parse, streamed to a handler from
+// argv, and streamed from a text buffer fed in 64 KiB pieces
+static void bench_stream() {
+    int argc = 2 * BENCH_STREAM_VALUES + 1;
+    char **argv = malloc((argc + 1) * sizeof(char *));
+    char *text = malloc((size_t)BENCH_STREAM_VALUES * 24);
+    size_t text_len = 0;
+    argv[0] = "bench";
+    for (int i = 0; i < BENCH_STREAM_VALUES; i++) {
+        argv[2 * i + 1] = "--user";
+        argv[2 * i + 2] = malloc(16);
+        snprintf(argv[2 * i + 2], 16, "user%d", i);
+        text_len += (size_t)sprintf(text + text_len, "--user user%d\n", i);
+    }
+    argv[argc] = NULL;
+
+    size_t seen = 0;
+    FlagSet *set = flagset_new();
+    Flag *users = flagset_string_multi(set, NULL, "Users", "--user", NULL);
+    double start = now_ns();
+    if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+    report("stream", "stored", BENCH_STREAM_VALUES, "ns_per_value", (now_ns() - start) / BENCH_STREAM_VALUES);
+    flagset_reset(set);
+
+    flag_on_string(users, count_value, &seen);
+    start = now_ns();
+    if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+    report("stream", "argv_handler", BENCH_STREAM_VALUES, "ns_per_value", (now_ns() - start) / BENCH_STREAM_VALUES);
+
+    start = now_ns();
+    FlagStream *stream = flagset_stream_new(set);
+    for (size_t at = 0; at < text_len; at += 65536) {
+        if (flag_stream_feed(stream, text + at, text_len - at < 65536 ? text_len - at : 65536) != 0) fail("flag_stream_feed");
+    }
+    if (flag_stream_finish(stream) != 0) fail("flag_stream_finish");
+    report("stream", "feed_handler", BENCH_STREAM_VALUES, "ns_per_value", (now_ns() - start) / BENCH_STREAM_VALUES);
+    flag_stream_free(stream);
+    if (seen == 0) fail("stream values");
+
+    for (int i = 0; i < BENCH_STREAM_VALUES; i++) free(argv[2 * i + 2]);
+    free(argv);
+    free(text);
+    flagset_free(set);
+}
+
+// Value mixes of the numbers suite, printed into one buffer of terminated values
+typedef struct NumberMix {
+    char *text;     // Values, each followed by '\0'
+    char **values;  // Start of each value
+} NumberMix;
+
+static NumberMix make_number_mix(const char *kind) {
+    NumberMix mix = { malloc((size_t)BENCH_NUMBER_VALUES * 32), malloc(BENCH_NUMBER_VALUES * sizeof(char *)) };
+    static const char *sizes[] = { "", "K", "M", "G", "KiB", "MB" };
+    static const char *durations[] = { "ns", "us", "ms", "s", "m", "h" };
+    char *p = mix.text;
+    srand(11);
+    for (int i = 0; i < BENCH_NUMBER_VALUES; i++) {
+        mix.values[i] = p;
+        long long wide = ((long long)rand() << 32) ^ ((long long)rand() << 8) ^ rand();
+        if (strcmp(kind, "small") == 0) p += sprintf(p, "%d", rand() % 10000);
+        else if (strcmp(kind, "int64") == 0) p += sprintf(p, "%lld", rand() & 1 ? wide : -wide);
+        else if (strcmp(kind, "decimal") == 0) p += sprintf(p, "%d.%03d", rand() % 100000, rand() % 1000);
+        else if (strcmp(kind, "scientific") == 0) p += sprintf(p, "%.17g", (double)rand() / RAND_MAX * 1e-30 * (double)(1LL << (rand() % 60)));
+        else if (strcmp(kind, "size") == 0) p += sprintf(p, "%d%s", rand() % 1000, sizes[rand() % 6]);
+        else p += sprintf(p, "%d%s", rand() % 1000, durations[rand() % 6]);
+        *p++ = '\0';
+    }
+    return mix;
+}
+
+// Time one converter over a mix and report it as values per second
+#define TIME_NUMBERS(mix, label, convert)                            \
+    do {                                                             \
+        double start = now_ns();                                     \
+        for (int i = 0; i < BENCH_NUMBER_VALUES; i++) {              \
+            const char *v = (mix).values[i];                         \
+            convert;                                                 \
+        }                                                            \
+        snprintf(name, sizeof(name), "%s_%s", kinds[k], label);      \
+        report("numbers", name, BENCH_NUMBER_VALUES, "values_per_s", \
+               BENCH_NUMBER_VALUES / ((now_ns() - start) / 1e9));    \
+    } while (0)
+
+// Numeric flag values: flagtool's parsers against the libc conversions on
+// mixes of small ints, full-width 64-bit ints, short decimals and doubles
+// printed with 17 significant digits, then sizes and durations on their own.
+// Both sides sum their results, which must agree.
+static void bench_numbers() {
+    static const char *kinds[] = { "small", "int64", "decimal", "scientific", "size", "duration" };
+    char name[32];
+    for (int k = 0; k < 6; k++) {
+        NumberMix mix = make_number_mix(kinds[k]);
+        uint64_t libc = 0, ours = 0, n;
+        double libc_d = 0, ours_d = 0, d;
+        FlagNumber number;
+        if (k < 2) {
+            TIME_NUMBERS(mix, "strtoll", libc += (uint64_t)strtoll(v, NULL, 10));
+            TIME_NUMBERS(mix, "flagtool", {
+                if (ft_parse_int64(v, v + strlen(v), &number.i64) != 0) fail("ft_parse_int64");
+                ours += (uint64_t)number.i64;
+            });
+        }
+        if (k == 0) {
+            TIME_NUMBERS(mix, "strtoull", libc += strtoull(v, NULL, 10));
+            TIME_NUMBERS(mix, "flagtool_uint64", {
+                if (ft_parse_uint64(v, v + strlen(v), &n) != 0) fail("ft_parse_uint64");
+                ours += n;
+            });
+        }
+        if (k == 2 || k == 3) {
+            TIME_NUMBERS(mix, "strtod", libc_d += strtod(v, NULL));
+            TIME_NUMBERS(mix, "flagtool", {
+                if (ft_parse_double(v, v + strlen(v), &d) != 0) fail("ft_parse_double");
+                ours_d += d;
+            });
+        }
+        if (k >= 4) {
+            TIME_NUMBERS(mix, "flagtool", {
+                if (ft_parse_number(k == 4 ? TYPE_SIZE : TYPE_DURATION, v, v + strlen(v), &number) != 0) fail(kinds[k]);
+                ours += number.u64;
+            });
+            libc = ours; // Nothing to compare with
+        }
+        if (libc != ours || libc_d != ours_d) fail("numbers");
+        free(mix.text);
+        free(mix.values);
+    }
+}
+
+// Flag table of a small CLI, declared statically for the startup suite
+#define BENCH_CLI_FLAGS(X)                                                  \
+    X(STRING, cli_name, "build", "Job name", "--name", "-n")                \
+    X(STRING, cli_output, "out", "Output directory", "--output", "-o")      \
+    X(INT, cli_jobs, 1, "Parallel jobs", "--jobs", "-j")                    \
+    X(INT, cli_retries, 0, "Retries", "--retries")                          \
+    X(BOOL, cli_verbose, 0, "Verbose output", "--verbose", "-v")            \
+    X(BOOL, cli_dry_run, 0, "Dry run", "--dry-run")                         \
+    X(BOOL, cli_color, 1, "Colored output", "--color")                      \
+    X(BOOL, cli_help, 0, "Show help", "--help", "-h")
+FLAGTOOL_STATIC(bench_cli, BENCH_CLI_FLAGS)
+
+// Startup of a small CLI: register and parse once, dynamic against static
+static void bench_startup() {
+    char *argv[] = { "cli", "--name=test", "-j", "8", "--no-color", "-v", "--output", "dist", NULL };
+    int argc = 8;
+
+    double start = now_ns();
+    for (int r = 0; r < BENCH_STARTUPS; r++) {
+        FlagSet *set = flagset_new();
+        flagset_string(set, "build", "Job name", "--name", "-n", NULL);
+        flagset_string(set, "out", "Output directory", "--output", "-o", NULL);
+        flagset_int(set, 1, "Parallel jobs", "--jobs", "-j", NULL);
+        flagset_int(set, 0, "Retries", "--retries", NULL);
+        flagset_bool(set, 0, "Verbose output", "--verbose", "-v", NULL);
+        flagset_bool(set, 0, "Dry run", "--dry-run", NULL);
+        flagset_bool(set, 1, "Colored output", "--color", NULL);
+        flagset_bool(set, 0, "Show help", "--help", "-h", NULL);
+        if (flagset_parse(set, argc, argv) != 0) fail("flagset_parse");
+        flagset_free(set);
+    }
+    report("startup", "dynamic", argc - 1, "ns_per_startup", (now_ns() - start) / BENCH_STARTUPS);
+
+    start = now_ns();
+    for (int r = 0; r < BENCH_STARTUPS; r++) {
+        flag_reset_static(&bench_cli_flags);
+        if (flag_parse_static(&bench_cli_flags, argc, argv) != 0) fail("flag_parse_static");
+    }
+    report("startup", "static", argc - 1, "ns_per_startup", (now_ns() - start) / BENCH_STARTUPS);
+    if (cli_jobs != 8 || cli_color || !cli_verbose) fail("static values");
+}
+
+// Usage: bench_flagtool [--csv | --json] [suite...]
+int main(int argc, char *argv[]) {
+    static const struct {
+        const char *name;
+        void (*run)();
+    } suites[] = {
+        { "register", bench_register },
+        { "find", bench_find },
+        { "find_collide", bench_find_collisions },
+        { "parse", bench_parse },
+        { "usage", bench_usage },
+        { "batch", bench_batch_scaling },
+        { "int_list", bench_int_list },
+        { "startup", bench_startup },
+        { "wide", bench_wide },
+        { "image", bench_image },
+        { "stream", bench_stream },
+        { "numbers", bench_numbers },
+        { "parallel", bench_parallel },
+        { "env", bench_env },
+        { "complete", bench_complete },
+        { "commands", bench_commands },
+        { "intern", bench_intern },
+        { "config", bench_config },
+    };
+    int nsuites = sizeof(suites) / sizeof(suites[0]);
+    int selected = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) format = FORMAT_JSON;
+        else if (strcmp(argv[i], "--csv") == 0) format = FORMAT_CSV;
+        else selected = 1;
+    }
+    for (int s = 0; s < nsuites; s++) {
+        int run = !selected;
+        for (int i = 1; i < argc && !run; i++) run = strcmp(argv[i], suites[s].name) == 0;
+        if (run) suites[s].run();
+    }
+    if (format == FORMAT_JSON) printf("%s\n]\n", records ? "" : "[");
+    return 0;
+}
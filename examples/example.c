@@ -2,7 +2,7 @@
 #include "flagtool.h"
 
 int main(int argc, char *argv[]) {
-    // Help flag with single name
+    // Help flag with single name, the list HAS TO END WITH NULL as well
     Flag *flagHelp = flag_bool(0, "Show help menu", "--help", NULL);
 
     // Debug flag with multiple names, HAS TO END WITH NULL
@@ -22,6 +22,9 @@ int main(int argc, char *argv[]) {
     FlagGroup *outputGroup = create_flag_group("Output Options");
     add_flag_to_group(outputGroup, flagDebug);
 
+    // Answer shell completion (example --__complete --d) before parsing
+    if (flag_complete_command_line(argc, argv)) return 0;
+
     // Show flag usage
     if (flag_parse(argc, argv)) {
         print_flag_usage(argv[0]);
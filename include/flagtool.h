@@ -2,24 +2,146 @@
 #define FLAGTOOL_H
 
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 typedef struct Flag Flag;
 typedef struct FlagGroup FlagGroup;
+typedef struct FlagSet FlagSet;
+typedef struct FlagValues FlagValues;
+typedef struct FlagCommand FlagCommand;
+
+// Error codes returned by the parse functions (all non-zero on failure)
+enum {
+    FLAG_ERR_UNKNOWN = 1,       // Argument does not name a registered flag
+    FLAG_ERR_MISSING_VALUE,     // Flag needs a value but none followed
+    FLAG_ERR_BAD_VALUE,         // Value could not be converted to the flag's type
+    FLAG_ERR_RESPONSE_FILE,     // @file could not be read or nests too deeply
+    FLAG_ERR_READ,              // Stream input could not be read
+    FLAG_ERR_OUT_OF_RANGE,      // Value is well-formed but does not fit the flag's type
+    FLAG_ERR_AMBIGUOUS,         // Abbreviated --name matches several flags
+    FLAG_ERR_CONFIG,            // Config file could not be read or has a malformed line
+    FLAG_ERR_IN_READ_SECTION    // Reload called inside the caller's own read section
+};
+
+// Serve all allocations from an arena, released at once by flags_cleanup()
+// (buf may be NULL for internal blocks; call before registering flags)
+int flags_use_arena(void *buf, size_t size);
+
+// Names of the creators end with NULL; GCC and Clang warn when it is missing
+#ifdef __GNUC__
+#define FLAG_NAMES __attribute__((sentinel))
+#else
+#define FLAG_NAMES
+#endif
 
 // flag creators (variadic, NULL-terminated names)
-Flag *flag_string(const char *default_val, const char *help, ...);
-Flag *flag_bool(int default_val, const char *help, ...);
-Flag *flag_int(int default_val, const char *help, ...);
+Flag *flag_string(const char *default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_bool(int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_int(int default_val, const char *help, ...) FLAG_NAMES;
+
+// Creators writing parsed values straight into user variables (defaults at registration)
+Flag *flag_string_var(const char **var, const char *default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_bool_var(int *var, int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_int_var(int *var, int default_val, const char *help, ...) FLAG_NAMES;
 
 // Multi-instance flag creators
-Flag *flag_string_multi(const char *default_val, const char *help,...);
-Flag *flag_int_multi(int default_val, const char *help, ...);
+Flag *flag_string_multi(const char *default_val, const char *help,...) FLAG_NAMES;
+Flag *flag_int_multi(int default_val, const char *help, ...) FLAG_NAMES;
+// Numeric flags: locale-independent, out-of-range values fail with
+// FLAG_ERR_OUT_OF_RANGE. Sizes take K/M/G/T/P/E suffixes (powers of 1024,
+// e.g. 4K, 1.5GiB) and are in bytes; durations take ns, us, ms, s, m, h
+// (e.g. 250ms, 1h30m) and are in nanoseconds.
+Flag *flag_int64(int64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_uint64(uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_double(double default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_size(uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_duration(int64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_int64_multi(int64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_uint64_multi(uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_double_multi(double default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_size_multi(uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flag_duration_multi(int64_t default_val, const char *help, ...) FLAG_NAMES;
+// Preallocate room for count instances of a multi flag (returns flag)
+Flag *flag_reserve(Flag *flag, int count);
+// Split each value of a multi flag on sep, e.g. --ids=1,2,3 (returns flag);
+// ignored if sep can be part of a value ('\0', or a digit, sign, point or
+// letter for number flags)
+Flag *flag_separator(Flag *flag, char sep);
+// Keep one copy of each distinct value of a string multi flag (returns flag):
+// repeats share the pointer and get the same dense ID, 0 for the first value
+Flag *flag_intern(Flag *flag);
+int flag_get_distinct_count(Flag *flag);
+int flag_get_string_id(Flag *flag, int i);
+const char *flag_get_distinct_string(Flag *flag, int id);
+
+// Environment fallback: bind a flag to a variable (returns flag, "" opts out
+// of the prefix) or every flag to PREFIX + NAME (--max-conns -> APP_MAX_CONNS),
+// then apply the environment before flag_parse() so argv takes priority
+Flag *flag_env(Flag *flag, const char *name);
+void flag_env_prefix(const char *prefix);
+int flag_apply_env();
+
+// Config file layer under the environment and argv: `key = value` lines
+// (key is a long name without its dashes, # starts a comment), loaded
+// before flag_apply_env() and flag_parse(). Reloading re-applies only the
+// flags whose lines changed and leaves flags set by other layers alone.
+int flag_load_config(const char *path);
+int flag_reload_config();
+
+// Accept unique prefixes of --names (--verb for --verbose) when parsing
+void flag_allow_abbrev(int allow);
+// Names starting with partial in bytewise order, --no- forms included: the
+// first max go to names, the total is returned.
+int flag_complete(const char *partial, const char **names, int max);
+// Shell completion, opt-in: answers `prog --__complete [words...] partial` on
+// stdout and returns 1 (main then exits), returns 0 for any other argv
+int flag_complete_command_line(int argc, char *argv[]);
+
+// Subcommands: init registers the command's flags into its own set and runs
+// only when flag_parse() meets the command's name; the arguments after it go
+// to that set, with every flag of the parent sets inherited as a global (flags
+// registered after the command included).
+// flag_active_command() is the command parsed last (NULL for none).
+typedef void (*FlagCommandInit)(FlagSet *set, void *ctx);
+FlagCommand *flag_command(const char *name, const char *help, FlagCommandInit init, void *ctx);
+FlagCommand *flag_active_command();
+const char *flag_command_name(const FlagCommand *cmd);
+FlagSet *flag_command_set(FlagCommand *cmd);
+
+// Hand every value of a multi flag to a handler as it is parsed instead of
+// storing it (returns flag). String views are only valid during the call.
+typedef void (*FlagStringHandler)(const char *value, size_t len, void *ctx);
+typedef void (*FlagIntHandler)(int value, void *ctx);
+Flag *flag_on_string(Flag *flag, FlagStringHandler handler, void *ctx);
+Flag *flag_on_int(Flag *flag, FlagIntHandler handler, void *ctx);
+
+// Streaming parse of whitespace-separated arguments (response file quoting)
+// fed in pieces of any size, memory stays bounded by the longest argument
+typedef struct FlagStream FlagStream;
+FlagStream *flag_stream_new();
+FlagStream *flagset_stream_new(FlagSet *set);
+int flag_stream_feed(FlagStream *stream, const char *data, size_t len);
+int flag_stream_finish(FlagStream *stream);
+void flag_stream_free(FlagStream *stream);
+// Stream everything readable from fd
+int flag_parse_stream(int fd);
+int flagset_parse_stream(FlagSet *set, int fd);
+
+// Compile registered names into a minimal perfect hash (call after registration)
+int flags_freeze();
 
 Flag *flag_find(const char *name);
+// Frees the values of a flag; the flag itself stays allocated (and
+// registered) until flags_cleanup()
 void flag_free(Flag *flag);
 void free_hash_table();
 void flags_cleanup();
+void flags_reset();
 int flag_parse(int argc, char *argv[]);
+// Parse storing string values as pointers into argv (argv must outlive them)
+int flag_parse_borrowed(int argc, char *argv[]);
 
 // Flag grouping
 FlagGroup *create_flag_group(const char *name);
@@ -29,9 +151,188 @@ void flag_free_group(FlagGroup *group);
 const char *flag_get_string(Flag *flag);
 int flag_get_bool(Flag *flag);
 int flag_get_int(Flag *flag);
+// Multi getters return an empty array (never NULL) while the flag has no
+// values; the string array is also NULL-terminated
 const char **flag_get_string_multi(Flag *flag);
 const int *flag_get_int_multi(Flag *flag);
 int flag_get_multiple_int_count(Flag *flag);
+int flag_get_multi_count(Flag *flag);
+int64_t flag_get_int64(Flag *flag);
+uint64_t flag_get_uint64(Flag *flag);
+double flag_get_double(Flag *flag);
+uint64_t flag_get_size(Flag *flag);
+int64_t flag_get_duration(Flag *flag);
+// Values of numeric multi flags, flag_get_multi_count() of them
+const int64_t *flag_get_int64_multi(Flag *flag);
+const uint64_t *flag_get_uint64_multi(Flag *flag);
+const double *flag_get_double_multi(Flag *flag);
+const uint64_t *flag_get_size_multi(Flag *flag);
+const int64_t *flag_get_duration_multi(Flag *flag);
 void print_flag_usage(const char *progname);
+// Usage rendered once, column-aligned and wrapped, and cached until a flag,
+// group or command is registered; also as JSON or a man page (roff).
+// flag_write_usage() sends it with a single write(2), returns 0 or -1.
+enum { FLAG_USAGE_TEXT, FLAG_USAGE_JSON, FLAG_USAGE_MAN };
+const char *flag_usage(const char *progname, int format, size_t *len);
+int flag_write_usage(const char *progname, int format, int fd);
+
+// Re-entrant flag sets: each set owns its registry and values, so threads
+// can parse with separate sets without sharing any state. The functions
+// above operate on a process-wide default set.
+FlagSet *flagset_new();
+void flagset_free(FlagSet *set);
+int flagset_use_arena(FlagSet *set, void *buf, size_t size);
+
+Flag *flagset_string(FlagSet *set, const char *default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_bool(FlagSet *set, int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_int(FlagSet *set, int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_string_var(FlagSet *set, const char **var, const char *default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_bool_var(FlagSet *set, int *var, int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_int_var(FlagSet *set, int *var, int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_string_multi(FlagSet *set, const char *default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_int_multi(FlagSet *set, int default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_int64(FlagSet *set, int64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_uint64(FlagSet *set, uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_double(FlagSet *set, double default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_size(FlagSet *set, uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_duration(FlagSet *set, int64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_int64_multi(FlagSet *set, int64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_uint64_multi(FlagSet *set, uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_double_multi(FlagSet *set, double default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_size_multi(FlagSet *set, uint64_t default_val, const char *help, ...) FLAG_NAMES;
+Flag *flagset_duration_multi(FlagSet *set, int64_t default_val, const char *help, ...) FLAG_NAMES;
+
+void flagset_env_prefix(FlagSet *set, const char *prefix);
+int flagset_apply_env(FlagSet *set);
+int flagset_load_config(FlagSet *set, const char *path);
+int flagset_reload_config(FlagSet *set);
+
+void flagset_allow_abbrev(FlagSet *set, int allow);
+int flagset_complete(FlagSet *set, const char *partial, const char **names, int max);
+int flagset_complete_command_line(FlagSet *set, int argc, char *argv[]);
+
+FlagCommand *flagset_command(FlagSet *set, const char *name, const char *help, FlagCommandInit init, void *ctx);
+FlagCommand *flagset_active_command(FlagSet *set);
+
+int flagset_freeze(FlagSet *set);
+Flag *flagset_find(FlagSet *set, const char *name);
+void flagset_free_hash_table(FlagSet *set);
+void flagset_cleanup(FlagSet *set);
+// Restore defaults keeping the registry and value buffers, for cheap reparsing;
+// also drops the config file (load it again) and the environment layer
+void flagset_reset(FlagSet *set);
+int flagset_parse(FlagSet *set, int argc, char *argv[]);
+int flagset_parse_borrowed(FlagSet *set, int argc, char *argv[]);
+
+FlagGroup *flagset_create_group(FlagSet *set, const char *name);
+void flagset_print_usage(FlagSet *set, const char *progname);
+const char *flagset_usage(FlagSet *set, const char *progname, int format, size_t *len);
+int flagset_write_usage(FlagSet *set, const char *progname, int format, int fd);
+
+// Value records: parse against a shared, read-only schema without touching it
+FlagValues *flag_values_new(FlagSet *schema);
+void flag_values_reset(FlagValues *values);
+void flag_values_free(FlagValues *values);
+int flag_values_error(const FlagValues *values);
+int flag_parse_values(FlagSet *schema, FlagValues *values, int argc, char *argv[]);
+
+const char *flag_values_get_string(const FlagValues *values, Flag *flag);
+int flag_values_get_bool(const FlagValues *values, Flag *flag);
+int flag_values_get_int(const FlagValues *values, Flag *flag);
+const char **flag_values_get_string_multi(const FlagValues *values, Flag *flag);
+const int *flag_values_get_int_multi(const FlagValues *values, Flag *flag);
+int flag_values_get_multiple_int_count(const FlagValues *values, Flag *flag);
+int flag_values_get_multi_count(const FlagValues *values, Flag *flag);
+int64_t flag_values_get_int64(const FlagValues *values, Flag *flag);
+uint64_t flag_values_get_uint64(const FlagValues *values, Flag *flag);
+double flag_values_get_double(const FlagValues *values, Flag *flag);
+uint64_t flag_values_get_size(const FlagValues *values, Flag *flag);
+int64_t flag_values_get_duration(const FlagValues *values, Flag *flag);
+const int64_t *flag_values_get_int64_multi(const FlagValues *values, Flag *flag);
+const uint64_t *flag_values_get_uint64_multi(const FlagValues *values, Flag *flag);
+const double *flag_values_get_double_multi(const FlagValues *values, Flag *flag);
+const uint64_t *flag_values_get_size_multi(const FlagValues *values, Flag *flag);
+const int64_t *flag_values_get_duration_multi(const FlagValues *values, Flag *flag);
+
+// Parse n command lines in parallel into results[i] (from flag_values_new),
+// error codes go to errors[i] when errors is non-NULL. threads <= 0 uses
+// one thread per online CPU. Returns the number of vectors that failed.
+int flag_parse_batch(FlagSet *schema, int n, const int argcs[], char **argvs[],
+                     FlagValues *results[], int errors[]);
+int flag_parse_batch_threads(FlagSet *schema, int n, const int argcs[], char **argvs[],
+                             FlagValues *results[], int errors[], int threads);
+
+// Parse one very long command line on several threads (threads <= 0: one per
+// online CPU), with exactly the result and error of the serial parse
+int flag_parse_parallel(int argc, char *argv[], int threads);
+int flagset_parse_parallel(FlagSet *set, int argc, char *argv[], int threads);
+
+// Hot reload: replace the command line, keeping the config file and
+// environment layers, and publish a copy of the values atomically
+// (RCU-style). Getters then read the latest snapshot without locking, and
+// every later parse, load or reset of the set is published the same way;
+// bound variables follow each snapshot. Strings and arrays stay valid up to
+// the end of the flag_read_lock()/flag_read_unlock() section they were read
+// in; one fetched outside a section keeps its snapshot allocated until
+// cleanup. Read several flags from one snapshot with flag_snapshot(). Returns FLAG_ERR_IN_READ_SECTION when called
+// inside a read section.
+int flag_reload(int argc, char *argv[]);
+int flagset_reload(FlagSet *set, int argc, char *argv[]);
+void flag_read_lock();
+void flag_read_unlock();
+// Snapshot for consistent multi-flag reads with flag_values_get_* (kept until
+// cleanup when taken outside a read section)
+FlagValues *flag_snapshot();
+FlagValues *flagset_snapshot(FlagSet *set);
+
+// Snapshot images: write the parsed registry and values to a file that other
+// processes map read-only; flag_find and flag_get_* then answer from the
+// mapping without parsing. Flags registered in the mapping process take the
+// image's value of the same name and type. Mapped flags are read-only:
+// calls that would change them (reserve, separator, handlers, env, groups)
+// ignore them.
+int flag_write_image(const char *path);
+int flagset_write_image(FlagSet *set, const char *path);
+int flag_map_image(const char *path);
+int flagset_map_image(FlagSet *set, const char *path);
+
+// Registry and parser statistics, collected only when the library is built
+// with FLAGTOOL_STATS (make STATS=1); otherwise the hooks compile to nothing
+#define FLAG_STATS_PROBE_BUCKETS 16
+
+typedef struct FlagStats {
+    int enabled;                // 0 when built without FLAGTOOL_STATS
+
+    // Shape of the registry when the stats were taken
+    size_t flags;               // Registered flags
+    size_t table_slots;         // Slots of the open-addressing table
+    size_t table_used;          // Occupied slots (names and --no- aliases)
+    int frozen;                 // Lookups go through the frozen table
+    size_t probe_histogram[FLAG_STATS_PROBE_BUCKETS]; // Names found after 1, 2, ... probes (last: or more)
+    size_t probe_max;           // Longest probe sequence of a stored name
+    double probe_mean;          // Average probes to find a stored name
+    size_t cluster_max;         // Longest run of occupied slots
+
+    // Lookups (flag_find and every name matched while parsing)
+    uint64_t finds, find_hits;
+    uint64_t probes;            // Table slots inspected
+    uint64_t compares;          // Name comparisons (memcmp calls)
+
+    // Allocations made for the registry and the parsed values
+    uint64_t allocs, alloc_bytes, frees;
+
+    // Phase counts and timings in nanoseconds
+    uint64_t registrations, register_ns;
+    uint64_t parses, parsed_args, parse_ns;
+    uint64_t freeze_ns, reset_ns, cleanup_ns;
+} FlagStats;
+
+// Fill stats, returns non-zero (stats zeroed) when built without FLAGTOOL_STATS
+int flagset_stats(FlagSet *set, FlagStats *stats);
+void flagset_stats_reset(FlagSet *set);
+int flagset_stats_json(FlagSet *set, FILE *out);
+int flag_stats(FlagStats *stats);
+void flag_stats_reset();
+int flag_stats_json(FILE *out);
 
 #endif
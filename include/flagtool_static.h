@@ -0,0 +1,116 @@
+#ifndef FLAGTOOL_STATIC_H
+#define FLAGTOOL_STATIC_H
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Static flag tables: flags declared at compile time with an X-macro, no
+ * registration and no heap. Each entry is
+ *
+ *     X(TYPE, variable, default, help, names...)
+ *
+ * with TYPE one of STRING, BOOL or INT, e.g.
+ *
+ *     #define APP_FLAGS(X) \
+ *         X(STRING, opt_name, "build", "Job name", "--name", "-n") \
+ *         X(BOOL, opt_verbose, 0, "Verbose output", "--verbose", "-v") \
+ *         X(INT, opt_count, 1, "Repeat count", "--count", "-c")
+ *
+ *     FLAGTOOL_STATIC(app, APP_FLAGS)   // in one .c file
+ *
+ * defines the variables (const char *opt_name = "build", int opt_verbose,
+ * int opt_count) and the table app_flags, passed to flag_parse_static().
+ * FLAGTOOL_STATIC_DECLARE(app, APP_FLAGS) declares them in a header. The
+ * name index is a lookup function generated from the table, so the
+ * compiler resolves every name to a length check and a fixed-size compare.
+ * Up to 10 names per flag.
+ */
+
+typedef enum { FLAG_STATIC_STRING, FLAG_STATIC_BOOL, FLAG_STATIC_INT } FlagStaticType;
+
+// One flag of a static table
+typedef struct FlagStaticDef {
+    FlagStaticType type;        // Type of the flag
+    const char *const *names;   // NULL-terminated names
+    const char *help;           // Help description
+    void *var;                  // Variable holding the value
+    const char *default_str;    // Default of a string flag
+    int default_int;            // Default of a bool or int flag
+} FlagStaticDef;
+
+// Table built by FLAGTOOL_STATIC()
+typedef struct FlagStaticTable {
+    const FlagStaticDef *defs;  // Flags in declaration order
+    int count;                  // Number of flags
+    int (*lookup)(const char *name, size_t len); // Index of a name, -1 if unknown
+} FlagStaticTable;
+
+// Parse into the table's variables, string values point into argv
+int flag_parse_static(const FlagStaticTable *table, int argc, char *argv[]);
+// Write every default back into the variables
+void flag_reset_static(const FlagStaticTable *table);
+void flag_print_usage_static(const FlagStaticTable *table, const char *progname);
+
+// Variable definitions and declarations per type
+#define FT_STATIC_VAR_STRING(var, def) const char *var = def;
+#define FT_STATIC_VAR_BOOL(var, def) int var = def;
+#define FT_STATIC_VAR_INT(var, def) int var = def;
+#define FT_STATIC_EXTERN_STRING(var) extern const char *var;
+#define FT_STATIC_EXTERN_BOOL(var) extern int var;
+#define FT_STATIC_EXTERN_INT(var) extern int var;
+#define FT_STATIC_DEFSTR_STRING(def) def
+#define FT_STATIC_DEFSTR_BOOL(def) NULL
+#define FT_STATIC_DEFSTR_INT(def) NULL
+#define FT_STATIC_DEFINT_STRING(def) 0
+#define FT_STATIC_DEFINT_BOOL(def) def
+#define FT_STATIC_DEFINT_INT(def) def
+
+#define FT_STATIC_DEFINE_VAR(type, var, def, help, ...) FT_STATIC_VAR_##type(var, def)
+#define FT_STATIC_DECLARE_VAR(type, var, def, help, ...) FT_STATIC_EXTERN_##type(var)
+#define FT_STATIC_INDEX(type, var, def, help, ...) ft_static_index_##var,
+#define FT_STATIC_NAMES(type, var, def, help, ...) \
+    static const char *const ft_static_names_##var[] = { __VA_ARGS__, NULL };
+#define FT_STATIC_DEF(type, var, def, help, ...) \
+    { FLAG_STATIC_##type, ft_static_names_##var, help, &var, \
+      FT_STATIC_DEFSTR_##type(def), FT_STATIC_DEFINT_##type(def) },
+
+// Compare name[0..len) against each literal name, the lengths are constants
+#define FT_STATIC_IS(n) (len == sizeof(n) - 1 && memcmp(name, n, sizeof(n) - 1) == 0)
+#define FT_STATIC_ANY_1(a) FT_STATIC_IS(a)
+#define FT_STATIC_ANY_2(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_1(__VA_ARGS__)
+#define FT_STATIC_ANY_3(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_2(__VA_ARGS__)
+#define FT_STATIC_ANY_4(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_3(__VA_ARGS__)
+#define FT_STATIC_ANY_5(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_4(__VA_ARGS__)
+#define FT_STATIC_ANY_6(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_5(__VA_ARGS__)
+#define FT_STATIC_ANY_7(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_6(__VA_ARGS__)
+#define FT_STATIC_ANY_8(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_7(__VA_ARGS__)
+#define FT_STATIC_ANY_9(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_8(__VA_ARGS__)
+#define FT_STATIC_ANY_10(a, ...) FT_STATIC_IS(a) || FT_STATIC_ANY_9(__VA_ARGS__)
+#define FT_STATIC_COUNT(...) FT_STATIC_COUNT_(__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define FT_STATIC_COUNT_(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, n, ...) n
+#define FT_STATIC_CAT(a, b) FT_STATIC_CAT_(a, b)
+#define FT_STATIC_CAT_(a, b) a##b
+#define FT_STATIC_MATCH(type, var, def, help, ...) \
+    if (FT_STATIC_CAT(FT_STATIC_ANY_, FT_STATIC_COUNT(__VA_ARGS__))(__VA_ARGS__)) return ft_static_index_##var;
+
+#define FLAGTOOL_STATIC_DECLARE(prefix, FLAGS) \
+    FLAGS(FT_STATIC_DECLARE_VAR)               \
+    extern const FlagStaticTable prefix##_flags;
+
+#define FLAGTOOL_STATIC(prefix, FLAGS)                                      \
+    FLAGS(FT_STATIC_DEFINE_VAR)                                             \
+    FLAGS(FT_STATIC_NAMES)                                                  \
+    enum { FLAGS(FT_STATIC_INDEX) };                                        \
+    static const FlagStaticDef prefix##_flag_defs[] = { FLAGS(FT_STATIC_DEF) }; \
+    static int prefix##_flag_lookup(const char *name, size_t len) {         \
+        FLAGS(FT_STATIC_MATCH)                                              \
+        return -1;                                                          \
+    }                                                                       \
+    const FlagStaticTable prefix##_flags = {                                \
+        prefix##_flag_defs,                                                 \
+        (int)(sizeof(prefix##_flag_defs) / sizeof(prefix##_flag_defs[0])),  \
+        prefix##_flag_lookup,                                               \
+    };
+
+#endif
@@ -6,161 +6,438 @@
  *
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "flagtool.h"
+#include "flagtool_internal.h"
+#include <limits.h>
 #include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 
-// Enum for flag types
-typedef enum { TYPE_STRING, TYPE_BOOL, TYPE_INT } FlagType;
-
-// Constants for hash table and maximum flag names
-#define HASH_TABLE_SIZE 256
-#define MAX_FLAG_NAMES 10
-#define MAX_FLAG_INSTANCES 64
-
-// Structure for hash table nodes
-typedef struct HashNode {
-    Flag *flag;               // Pointer to the associated flag
-    struct HashNode *next;    // Pointer to the next node in the linked list
-} HashNode;
-
-// Hash table for storing flags
-static HashNode *hash_table[HASH_TABLE_SIZE];
-
-// Hash function to compute index for a given string
-unsigned int hash(const char *str) {
-    unsigned int hash = 0;
-    while (*str) {
-        hash = (hash << 5) + *str++; // Shift and add character
-    }
-    return hash % HASH_TABLE_SIZE; // Return index within hash table size
-}
-
-// Structure representing a flag
-struct Flag {
-    const char *names[MAX_FLAG_NAMES];  // Array of flag names
-    int name_count;                     // Number of names
-    const char *help;                   // Help description
-    FlagType type;                      // Type of the flag
-    FlagGroup *group;                   // Pointer to flag group
-
-    const char *default_str;            // Default string value
-    char *value_str;                    // Current string value
-    char *multiple_str_values[MAX_FLAG_INSTANCES]; // Store string values
-
-    int default_bool;                   // Default boolean value
-    int value_bool;                     // Current boolean value
-
-    int default_int;                    // Default integer value
-    int value_int;                      // Current integer value
-    int multiple_int_values[MAX_FLAG_INSTANCES - 1]; // Stores int values (no NULL for int)
-    
-    int multiple_values_count;          // Number of multi values
-    int supports_multiple;              // Flag to indicate if multiple instances allowed
-    int is_set;                         // Flag indicating if the value is set
-};
-
-// Structure representing a flag group
-typedef struct FlagGroup {
-    const char *name; // Name of flag group
-    Flag **flags; // Flag in group
-    int flag_count; // Number of flags in group
-} FlagGroup;
-
-#define MAX_FLAGS 100
-#define MAX_GROUPS 20
-static FlagGroup *groups[MAX_GROUPS];
-static int group_count = 0;
-static Flag *flags[MAX_FLAGS]; // Array to store registered flags
-static int flag_count = 0;      // Count of registered flags
+// Finalizer from MurmurHash3, spreads every input bit over the output
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
 
-// Function to add a flag to the hash table
-static void add_flag_to_hash_table(Flag *flag) {
-    for (int i = 0; i < flag->name_count; i++) {
-        unsigned int index = hash(flag->names[i]); // Compute index
-        HashNode *new_node = malloc(sizeof(HashNode)); // Allocate new node
-        new_node->flag = flag; // Set flag in node
-        new_node->next = hash_table[index]; // Link to existing nodes
-        hash_table[index] = new_node; // Insert at the head of the list
+// Seeded 64-bit hash of a length-delimited name, consumes 8 bytes per step
+static uint64_t hash64(const char *str, size_t len, uint64_t seed) {
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+    uint64_t w;
+    while (len >= 8) {
+        memcpy(&w, str, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 29;
+        str += 8;
+        len -= 8;
     }
+    w = 0;
+    for (size_t i = 0; i < len; i++) w |= (uint64_t)(unsigned char)str[i] << (i * 8); // Tail bytes
+    h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    return mix64(h);
 }
 
-// Function to create a new flag
-static Flag *create_flag(const char *names[], int name_count, const char *help, FlagType type) {
-    if (flag_count >= MAX_FLAGS) {
-        fprintf(stderr, "Too many flags registered\n");
-        exit(1);
+// Hash the open-addressing table files a name under (for benchmarks)
+uint64_t ft_hash_name(const char *name, size_t len) {
+    return hash64(name, len, 0);
+}
+
+// Set used by every function without a FlagSet argument
+static FlagSet default_set;
+
+FlagSet *ft_default_set() {
+    return &default_set;
+}
+
+// Set up an arena, optionally starting with a caller supplied buffer
+static void arena_init(Arena *a, void *buf, size_t size, size_t block_size) {
+    a->user_buf = buf;
+    a->user_size = buf ? size : 0;
+    a->blocks = NULL;
+    a->block_size = block_size;
+    a->initial_block = block_size;
+    a->cur = a->user_buf;
+    a->end = a->user_buf + a->user_size;
+}
+
+// Allocate from the arena, starting a new block when the current one is full
+static void *arena_alloc(Arena *a, size_t size) {
+    uintptr_t p = ((uintptr_t)a->cur + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    if (!a->cur || p + size > (uintptr_t)a->end) {
+        if (!a->blocks) a->initial_block = a->block_size; // Growth restarts from here after a release
+        size_t block_size = a->block_size ? a->block_size : ARENA_DEFAULT_BLOCK;
+        while (block_size < size) block_size *= 2;
+        ArenaBlock *block = malloc(sizeof(ArenaBlock) + block_size);
+        if (!block) {
+            perror("malloc");
+            exit(1);
+        }
+        block->next = a->blocks;
+        block->size = block_size;
+        a->blocks = block;
+        a->block_size = block_size * 2; // Few blocks however much gets allocated
+        a->cur = (char *)block->data;
+        a->end = a->cur + block_size;
+        p = (uintptr_t)a->cur;
     }
-    if (name_count > MAX_FLAG_NAMES) {
-        fprintf(stderr, "Too many names for one flag (max %d)\n", MAX_FLAG_NAMES);
+    a->cur = (char *)(p + size);
+    return (void *)p;
+}
+
+// Release every block at once and start over with the caller buffer and
+// the first block size, so repeated cleanup cycles do not keep doubling it
+static void arena_release(Arena *a) {
+    while (a->blocks) {
+        ArenaBlock *next = a->blocks->next;
+        free(a->blocks);
+        a->blocks = next;
+    }
+    a->block_size = a->initial_block;
+    a->cur = a->user_buf;
+    a->end = a->user_buf + a->user_size;
+}
+
+// Make the arena empty again but keep its largest block for reuse
+static void arena_rewind(Arena *a) {
+    if (!a->blocks) {
+        a->cur = a->user_buf;
+        a->end = a->user_buf + a->user_size;
+        return;
+    }
+    ArenaBlock *keep = a->blocks; // Newest block is the largest
+    size_t block_size = a->block_size; // Still growing past the kept block
+    a->blocks = keep->next;
+    arena_release(a);
+    a->block_size = block_size;
+    keep->next = NULL;
+    a->blocks = keep;
+    a->cur = (char *)keep->data;
+    a->end = a->cur + keep->size;
+}
+
+void *ft_arena_alloc(Arena *a, size_t size) {
+    return arena_alloc(a, size);
+}
+
+void ft_arena_rewind(Arena *a) {
+    arena_rewind(a);
+}
+
+void ft_arena_release(Arena *a) {
+    arena_release(a);
+}
+
+// Allocation helpers used for everything the registry keeps, exit on failure
+static void *mem_alloc(FlagSet *set, size_t size) {
+    FT_STAT_ADD(set, allocs, 1);
+    FT_STAT_ADD(set, alloc_bytes, size);
+    if (set->use_arena) return arena_alloc(&set->arena, size);
+    void *p = malloc(size);
+    if (!p) {
+        perror("malloc");
         exit(1);
     }
-    Flag *f = calloc(1, sizeof(Flag)); // Allocate memory for the flag
-    if (!f) {
+    return p;
+}
+
+static void *mem_calloc(FlagSet *set, size_t count, size_t size) {
+    FT_STAT_ADD(set, allocs, 1);
+    FT_STAT_ADD(set, alloc_bytes, count * size);
+    if (set->use_arena) return memset(arena_alloc(&set->arena, count * size), 0, count * size);
+    void *p = calloc(count, size);
+    if (!p) {
         perror("calloc");
         exit(1);
     }
-    for (int i = 0; i < name_count; i++) {
-        f->names[i] = names[i]; // Copy names
+    return p;
+}
+
+static void *mem_realloc(FlagSet *set, void *ptr, size_t old_size, size_t new_size) {
+    FT_STAT_ADD(set, allocs, 1);
+    FT_STAT_ADD(set, alloc_bytes, new_size);
+    if (set->use_arena) {
+        void *p = arena_alloc(&set->arena, new_size); // Old copy stays in its block until release
+        if (ptr) memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        return p;
     }
-    f->name_count = name_count;
-    f->help = help;
-    f->type = type;
-    flags[flag_count++] = f; // Register the flag
+    void *p = realloc(ptr, new_size);
+    if (!p) {
+        perror("realloc");
+        exit(1);
+    }
+    return p;
+}
 
-    // Add flag to hash table
-    add_flag_to_hash_table(f);
+static char *mem_strdup(FlagSet *set, const char *str) {
+    size_t len = strlen(str) + 1;
+    return memcpy(mem_alloc(set, len), str, len);
+}
 
-    return f;
+static void mem_free(FlagSet *set, void *ptr) {
+    if (ptr) FT_STAT_ADD(set, frees, 1);
+    if (!set->use_arena) free(ptr); // Arena memory goes away with its block
 }
 
-// Function to create a flag group
-FlagGroup *create_flag_group(const char *name) {
-    // Check if we can add more groups
-    if (group_count >= MAX_GROUPS) {
-        fprintf(stderr, "Cannot create more groups, maximum limit reached\n");
+// Allocator entry points for the other translation units
+void *ft_mem_calloc(FlagSet *set, size_t count, size_t size) {
+    return mem_calloc(set, count, size);
+}
+
+void *ft_mem_realloc(FlagSet *set, void *ptr, size_t old_size, size_t new_size) {
+    return mem_realloc(set, ptr, old_size, new_size);
+}
+
+void ft_mem_free(FlagSet *set, void *ptr) {
+    mem_free(set, ptr);
+}
+
+// Cold data and own value slot of a flag, both columns of its set
+static inline FlagInfo *flag_info(const Flag *f) {
+    return &f->set->info[f->index];
+}
+
+static inline FlagValue *flag_slot(const Flag *f) {
+    return &f->set->slots[f->index];
+}
+
+// Create an empty flag set
+FlagSet *flagset_new() {
+    FlagSet *set = calloc(1, sizeof(FlagSet));
+    if (!set) {
+        perror("calloc");
         exit(1);
     }
+    return set;
+}
 
-    // Allocate memory for the group
-    FlagGroup *group = malloc(sizeof(FlagGroup));
-    if (!group) {
-        perror("Failed to allocate memory for FlagGroup");
-        exit(1);
+// Free a flag set together with everything registered in it
+void flagset_free(FlagSet *set) {
+    if (set && set != &default_set) {
+        flagset_cleanup(set);
+        free(set);
     }
+}
 
-    // Allocate memory for the group name and copy it
-    group->name = strdup(name);
-    if (!group->name) {
-        perror("Failed to allocate memory for group name");
-        free(group); // Free previously allocated memory
-        exit(1);
+/**
+ * flagset_use_arena - Serves all registry allocations of a set from an arena.
+ *
+ * Flags, hash table slots and groups (including their names) are carved
+ * from a few large blocks instead of individual malloc calls, and
+ * flagset_cleanup() releases them all at once. Parsed string values always
+ * live in a separate per-set value arena. If @buf is non-NULL it is used as
+ * the first block; further blocks are allocated when it runs out. With @buf
+ * NULL, @size is the size of the first internal block (0 for default).
+ * Must be called before the first flag or group is registered.
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero if flags are already registered
+ */
+int flagset_use_arena(FlagSet *set, void *buf, size_t size) {
+    if (set->flag_count || set->group_count) {
+        fprintf(stderr, "flags_use_arena must be called before registering flags\n");
+        return 1;
+    }
+    set->use_arena = 1;
+    arena_init(&set->arena, buf, size, (!buf && size) ? size : ARENA_DEFAULT_BLOCK);
+    return 0;
+}
+
+int flags_use_arena(void *buf, size_t size) {
+    return flagset_use_arena(&default_set, buf, size);
+}
+
+// Map a 32-bit hash onto [0, n) without a division
+static inline size_t reduce(uint32_t h, size_t n) {
+    return (size_t)(((uint64_t)h * n) >> 32);
+}
+
+static inline size_t frozen_bucket(const FrozenTable *ft, uint64_t h) {
+    return reduce((uint32_t)(h >> 32), ft->bucket_count);
+}
+
+static inline size_t frozen_slot(const FrozenTable *ft, uint64_t h, uint32_t disp) {
+    return reduce((uint32_t)(((h ^ disp) * 0x9e3779b97f4a7c15ULL) >> 32), ft->slot_count);
+}
+
+// Release the frozen table and go back to the open-addressing hash table.
+// Once the hash table is gone the frozen slots own the --no- alias names.
+static void flags_thaw(FlagSet *set) {
+    for (size_t i = 0; !set->hash_table && i < set->frozen.slot_count && !set->use_arena; i++) {
+        if (set->frozen.slots[i].negated) mem_free(set, (char *)set->frozen.slots[i].name);
+    }
+    mem_free(set, set->frozen.slots);
+    mem_free(set, set->frozen.disp);
+    memset(&set->frozen, 0, sizeof(set->frozen));
+}
+
+// Grow an array geometrically so it holds at least `needed` elements
+static void *grow_array(FlagSet *set, void *array, int *capacity, int needed, size_t elem_size) {
+    if (needed <= *capacity) return array;
+    int new_capacity = *capacity ? *capacity : 8;
+    while (new_capacity < needed) new_capacity *= 2;
+    void *grown = mem_realloc(set, array, (size_t)*capacity * elem_size, (size_t)new_capacity * elem_size);
+    *capacity = new_capacity;
+    return grown;
+}
+
+// Find the slot holding `name`, or the empty slot where it belongs
+static HashEntry *hash_table_slot(HashEntry *table, size_t size, const char *name, size_t len, uint64_t h) {
+    size_t mask = size - 1;
+    for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+        HashEntry *e = &table[i];
+        if (!e->flag) return e;
+        if (e->hash == (uint32_t)h && e->len == len && memcmp(e->name, name, len) == 0) return e;
+    }
+}
+
+// Double the hash table and reinsert every entry using its stored hash
+static void hash_table_grow(FlagSet *set) {
+    size_t new_size = set->hash_table_size ? set->hash_table_size * 2 : HASH_TABLE_MIN_SIZE;
+    HashEntry *table = mem_calloc(set, new_size, sizeof(HashEntry));
+    for (size_t i = 0; i < set->hash_table_size; i++) {
+        HashEntry *e = &set->hash_table[i];
+        if (!e->flag) continue;
+        size_t j = e->hash & (new_size - 1); // Stored hash, names are not rehashed
+        while (table[j].flag) j = (j + 1) & (new_size - 1);
+        table[j] = *e;
+    }
+    mem_free(set, set->hash_table);
+    set->hash_table = table;
+    set->hash_table_size = new_size;
+}
+
+// Insert or replace one name, generated aliases never replace a real name
+static void hash_table_insert(FlagSet *set, const char *name, size_t len, Flag *flag, int negated) {
+    ft_release_prefix(set); // Sorted names are stale
+    if ((set->hash_table_used + 1) * 100 > set->hash_table_size * HASH_TABLE_MAX_LOAD) {
+        hash_table_grow(set);
+    }
+    uint64_t h = hash64(name, len, 0);
+    HashEntry *e = hash_table_slot(set->hash_table, set->hash_table_size, name, len, h);
+    if (e->flag) {
+        if (negated && !e->negated) {
+            mem_free(set, (char *)name);
+            return;
+        }
+        if (e->negated) mem_free(set, (char *)e->name); // Replaced alias owned its name
+    } else {
+        set->hash_table_used++;
+    }
+    // A name registered again resolves to the latest flag
+    *e = (HashEntry){ name, flag, (uint32_t)h, (uint32_t)len, (uint32_t)negated };
+}
+
+// Function to add a flag to the hash table
+static void add_flag_to_hash_table(FlagSet *set, Flag *flag) {
+    const FlagInfo *info = flag_info(flag);
+    for (int i = 0; i < info->name_count; i++) {
+        const char *name = info->names[i];
+        size_t len = strlen(name);
+        hash_table_insert(set, name, len, flag, 0);
+
+        // --name of a boolean also answers to --no-name, resolved without copying argv
+        if (flag->type == TYPE_BOOL && len > 2 && strncmp(name, "--", 2) == 0) {
+            char *alias = mem_alloc(set, len + 4);
+            memcpy(alias, "--no-", 5);
+            memcpy(alias + 5, name + 2, len - 1); // Including the terminator
+            hash_table_insert(set, alias, len + 3, flag, 1);
+        }
     }
+}
+
+// Grow the flag pointers, value slots and cold data together, one capacity covers all three
+static void grow_flag_columns(FlagSet *set) {
+    if (set->flag_count < set->flag_capacity) return;
+    size_t old = (size_t)set->flag_capacity, capacity = old ? old * 2 : 8;
+    set->flags = mem_realloc(set, set->flags, old * sizeof(Flag *), capacity * sizeof(Flag *));
+    set->slots = mem_realloc(set, set->slots, old * sizeof(FlagValue), capacity * sizeof(FlagValue));
+    set->info = mem_realloc(set, set->info, old * sizeof(FlagInfo), capacity * sizeof(FlagInfo));
+    set->flag_capacity = (int)capacity;
+}
+
+// Carve a zeroed flag from the set's flag store (or its arena), so flags
+// registered together share cache lines and never move
+static Flag *alloc_flag(FlagSet *set) {
+    Arena *store = set->use_arena ? &set->arena : &set->flag_store;
+    if (!store->block_size) store->block_size = FLAG_STORE_MIN_FLAGS * sizeof(Flag);
+    FT_STAT_ADD(set, allocs, 1);
+    FT_STAT_ADD(set, alloc_bytes, sizeof(Flag));
+    return memset(arena_alloc(store, sizeof(Flag)), 0, sizeof(Flag));
+}
 
-    // Allocate memory for flags
-    group->flags = malloc(MAX_FLAGS * sizeof(Flag *));
-    if (!group->flags) {
-        perror("Failed to allocate memory for flags");
-        free(group);       // Free group
+// Function to create a new flag
+static Flag *create_flag(FlagSet *set, const char *names[], int name_count, const char *help, FlagType type) {
+    FT_STAT_CLOCK(start);
+    if (set->frozen.active) flags_thaw(set); // Registry changes invalidate the frozen table
+    if (name_count > MAX_FLAG_NAMES) {
+        fprintf(stderr, "Too many names for one flag (max %d)\n", MAX_FLAG_NAMES);
         exit(1);
     }
+    grow_flag_columns(set);
+    Flag *f = alloc_flag(set);
+    f->type = type;
+    f->set = set;
+    f->index = set->flag_count;
+    set->flags[f->index] = f; // Register the flag
+    set->slots[f->index] = (FlagValue){ 0 };
+    FlagInfo *info = &set->info[f->index];
+    *info = (FlagInfo){ .name_count = name_count, .help = help };
+    for (int i = 0; i < name_count; i++) {
+        info->names[i] = names[i]; // Copy names
+    }
+    set->flag_count++;
+    set->generation++; // Cached usage is stale
+
+    // Add flag to hash table
+    add_flag_to_hash_table(set, f);
 
+    FT_STAT_ADD(set, registrations, 1);
+    FT_STAT_ELAPSED(set, register_ns, start);
+    return f;
+}
+
+// Function to create a flag group
+FlagGroup *flagset_create_group(FlagSet *set, const char *name) {
+    // Allocate memory for the group
+    FlagGroup *group = mem_alloc(set, sizeof(FlagGroup));
+
+    // Allocate memory for the group name and copy it
+    group->name = mem_strdup(set, name);
+
+    // Flags are allocated on demand as they are added
+    group->flags = NULL;
     group->flag_count = 0;
+    group->flag_capacity = 0;
+    group->set = set;
 
-    // Automatically add the group to the global groups array
-    groups[group_count++] = group; // Add to global groups array
+    // Automatically add the group to the set's groups array
+    set->groups = grow_array(set, set->groups, &set->group_capacity, set->group_count + 1, sizeof(FlagGroup *));
+    set->groups[set->group_count++] = group;
+    set->generation++;
 
     return group;
 }
 
+FlagGroup *create_flag_group(const char *name) {
+    return flagset_create_group(&default_set, name);
+}
+
 void add_flag_to_group(FlagGroup *group, Flag *flag) {
-    if (group->flag_count < MAX_FLAGS) {
-        group->flags[group->flag_count++] = flag;
-        flag->group = group; // Set group pointer to flag
-    }
+    if (!flag->set) return; // Flags of a mapped image are read-only
+    group->flags = grow_array(group->set, group->flags, &group->flag_capacity, group->flag_count + 1, sizeof(Flag *));
+    group->flags[group->flag_count++] = flag;
+    flag_info(flag)->group = group; // Set group pointer to flag
+    group->set->generation++;
 }
 
 // Function to collect names from variadic arguments
@@ -174,341 +451,1420 @@ static int collect_names(va_list args, const char *names[], int max_names) {
     return count; // Return the number of names collected
 }
 
+// Function to create a string flag from a list of names
+static Flag *new_string_flag(FlagSet *set, const char *default_val, const char *help, int multiple, va_list args) {
+    const char *names[MAX_FLAG_NAMES];
+    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+
+    Flag *f = create_flag(set, names, count, help, TYPE_STRING);
+    f->default_str = default_val;
+    f->supports_multiple = multiple;
+    if (set->image) ft_image_adopt(f); // Same flag in a mapped image
+    return f;
+}
+
+// Function to create a boolean flag from a list of names
+static Flag *new_bool_flag(FlagSet *set, int default_val, const char *help, va_list args) {
+    const char *names[MAX_FLAG_NAMES];
+    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+
+    Flag *f = create_flag(set, names, count, help, TYPE_BOOL);
+    f->default_bool = default_val;
+    flag_slot(f)->value_bool = default_val;
+    if (set->image) ft_image_adopt(f); // Same flag in a mapped image
+    return f;
+}
+
+// Function to create an integer flag from a list of names
+static Flag *new_int_flag(FlagSet *set, int default_val, const char *help, int multiple, va_list args) {
+    const char *names[MAX_FLAG_NAMES];
+    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+
+    Flag *f = create_flag(set, names, count, help, TYPE_INT);
+    f->default_int = default_val;
+    flag_slot(f)->value_int = default_val;
+    f->supports_multiple = multiple;
+    if (set->image) ft_image_adopt(f); // Same flag in a mapped image
+    return f;
+}
+
 // Function to create a string flag (multiple names)
 Flag *flag_string(const char *default_val, const char *help, ...) {
-    const char *names[MAX_FLAG_NAMES];
     va_list args;
     va_start(args, help);
-    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+    Flag *f = new_string_flag(&default_set, default_val, help, 0, args);
     va_end(args);
+    return f;
+}
 
-    Flag *f = create_flag(names, count, help, TYPE_STRING);
-    f->default_str = default_val;
-    f->value_str = NULL;
-    f->is_set = 0;
+Flag *flagset_string(FlagSet *set, const char *default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_string_flag(set, default_val, help, 0, args);
+    va_end(args);
     return f;
 }
 
 // Function to create a boolean flag (multiple names)
 Flag *flag_bool(int default_val, const char *help, ...) {
-    const char *names[MAX_FLAG_NAMES];
     va_list args;
     va_start(args, help);
-    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+    Flag *f = new_bool_flag(&default_set, default_val, help, args);
     va_end(args);
+    return f;
+}
 
-    Flag *f = create_flag(names, count, help, TYPE_BOOL);
-    f->default_bool = default_val;
-    f->value_bool = default_val;
-    f->is_set = 0;
+Flag *flagset_bool(FlagSet *set, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_bool_flag(set, default_val, help, args);
+    va_end(args);
     return f;
 }
 
 // Function to create an integer flag (multiple names)
 Flag *flag_int(int default_val, const char *help, ...) {
-    const char *names[MAX_FLAG_NAMES];
     va_list args;
     va_start(args, help);
-    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+    Flag *f = new_int_flag(&default_set, default_val, help, 0, args);
     va_end(args);
+    return f;
+}
 
-    Flag *f = create_flag(names, count, help, TYPE_INT);
-    f->default_int = default_val;
-    f->value_int = default_val;
-    f->is_set = 0;
+Flag *flagset_int(FlagSet *set, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_int_flag(set, default_val, help, 0, args);
+    va_end(args);
     return f;
 }
 
 // Function to create string flag (multiple names and instances)
 Flag *flag_string_multi(const char *default_val, const char *help, ...) {
-    const char *names[MAX_FLAG_NAMES];
     va_list args;
     va_start(args, help);
-    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+    Flag *f = new_string_flag(&default_set, default_val, help, 1, args);
     va_end(args);
+    return f;
+}
 
-    Flag *f = create_flag(names, count, help, TYPE_STRING);
-    f->default_str = default_val;
-    f->value_str = NULL;
-    f->is_set = 0;
-    f->supports_multiple = 1;
-    f->multiple_values_count = 0;
+Flag *flagset_string_multi(FlagSet *set, const char *default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_string_flag(set, default_val, help, 1, args);
+    va_end(args);
     return f;
 }
 
 // Function to create int flag (multiple names and instances)
 Flag *flag_int_multi(int default_val, const char *help, ...) {
-    const char *names[MAX_FLAG_NAMES];
     va_list args;
     va_start(args, help);
-    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
+    Flag *f = new_int_flag(&default_set, default_val, help, 1, args);
     va_end(args);
+    return f;
+}
 
-    Flag *f = create_flag(names, count, help, TYPE_INT);
-    f->default_int = default_val;
-    f->value_int = default_val;
-    f->is_set = 0;
-    f->supports_multiple = 1;
-    f->multiple_values_count = 0;
+Flag *flagset_int_multi(FlagSet *set, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_int_flag(set, default_val, help, 1, args);
+    va_end(args);
     return f;
 }
 
-static int set_flag_value(Flag *f, const char *val, int is_negative_bool) {
-    if (!f) return 1;
+// Function to create a flag of one of the 64-bit numeric types, the caller sets the default
+static Flag *new_number_flag(FlagSet *set, FlagType type, const char *help, int multiple, va_list args) {
+    const char *names[MAX_FLAG_NAMES];
+    int count = collect_names(args, names, MAX_FLAG_NAMES); // Collect names
 
-    if (f->type == TYPE_BOOL) {
-        f->value_bool = is_negative_bool ? 0 : 1;
-        f->is_set = 1;
-        return 0;
-    }
+    Flag *f = create_flag(set, names, count, help, type);
+    f->supports_multiple = multiple;
+    return f;
+}
 
-    if (!val && f->type != TYPE_BOOL) {
-        fprintf(stderr, "Missing value for flag %s\n", f->names[0]);
-        return 1;
+// Creators of one numeric type (single and multi instance, default and explicit set)
+#define NUMBER_FLAG_CREATORS(name, ctype, member, flag_type)                               \
+    static Flag *number_flag_##name(FlagSet *set, ctype default_val, const char *help,     \
+                                    int multiple, va_list args) {                          \
+        Flag *f = new_number_flag(set, flag_type, help, multiple, args);                   \
+        f->default_##member = default_val;                                                 \
+        flag_slot(f)->value_##member = default_val;                                        \
+        if (set->image) ft_image_adopt(f); /* Same flag in a mapped image */               \
+        return f;                                                                          \
+    }                                                                                      \
+    Flag *flag_##name(ctype default_val, const char *help, ...) {                          \
+        va_list args;                                                                      \
+        va_start(args, help);                                                              \
+        Flag *f = number_flag_##name(&default_set, default_val, help, 0, args);            \
+        va_end(args);                                                                      \
+        return f;                                                                          \
+    }                                                                                      \
+    Flag *flagset_##name(FlagSet *set, ctype default_val, const char *help, ...) {         \
+        va_list args;                                                                      \
+        va_start(args, help);                                                              \
+        Flag *f = number_flag_##name(set, default_val, help, 0, args);                     \
+        va_end(args);                                                                      \
+        return f;                                                                          \
+    }                                                                                      \
+    Flag *flag_##name##_multi(ctype default_val, const char *help, ...) {                  \
+        va_list args;                                                                      \
+        va_start(args, help);                                                              \
+        Flag *f = number_flag_##name(&default_set, default_val, help, 1, args);            \
+        va_end(args);                                                                      \
+        return f;                                                                          \
+    }                                                                                      \
+    Flag *flagset_##name##_multi(FlagSet *set, ctype default_val, const char *help, ...) { \
+        va_list args;                                                                      \
+        va_start(args, help);                                                              \
+        Flag *f = number_flag_##name(set, default_val, help, 1, args);                     \
+        va_end(args);                                                                      \
+        return f;                                                                          \
     }
 
-    if (f->supports_multiple) {
-        if (f->multiple_values_count < MAX_FLAG_INSTANCES - 1) {
-            if (f->type == TYPE_STRING) {
-                f->multiple_str_values[f->multiple_values_count++] = strdup(val);
-                f->multiple_str_values[f->multiple_values_count] = NULL;
-                return 0;
-            } else if (f->type == TYPE_INT) {
-                char *endptr;
-                long v = strtol(val, &endptr, 10);
-                if (*endptr != '\0') return 1; // Error
-                f->multiple_int_values[f->multiple_values_count++] = (int)v;
-                return 0;
-            }
-        }
-    } else {
-        // Single-instance setting
-        if (f->type == TYPE_STRING) {
-            if (f->value_str) free(f->value_str);
-            f->value_str = strdup(val);
-            if (!f->value_str) return 1;
-            f->is_set = 1;
-        } else if (f->type == TYPE_INT) {
-            char *endptr;
-            long v = strtol(val, &endptr, 10);
-            if (*endptr != '\0') return 1; // Error
-            f->value_int = (int)v;
-            f->is_set = 1;
-        }
+NUMBER_FLAG_CREATORS(int64, int64_t, int64, TYPE_INT64)
+NUMBER_FLAG_CREATORS(uint64, uint64_t, uint64, TYPE_UINT64)
+NUMBER_FLAG_CREATORS(double, double, double, TYPE_DOUBLE)
+NUMBER_FLAG_CREATORS(size, uint64_t, uint64, TYPE_SIZE)
+NUMBER_FLAG_CREATORS(duration, int64_t, int64, TYPE_DURATION)
+
+// Copy a value of a flag into the variable bound by flag_*_var()
+static void write_bound_value(Flag *f, const FlagValue *v) {
+    switch (f->type) {
+        case TYPE_STRING:
+            *(const char **)f->bound = v->value_str ? v->value_str : f->default_str;
+            break;
+        case TYPE_BOOL:
+            *(int *)f->bound = v->value_bool;
+            break;
+        case TYPE_INT:
+            *(int *)f->bound = v->value_int;
+            break;
+        default:
+            break; // Numeric types have no flag_*_var creators
     }
+}
 
-    return 0;
+// Copy a flag's own value into its bound variable. Once the set has been
+// reloaded the variable follows the published snapshot instead, written
+// by ft_publish() after every change
+static void write_bound(Flag *f) {
+    if (!f->bound || atomic_load_explicit(&f->set->live, memory_order_relaxed)) return;
+    write_bound_value(f, flag_slot(f));
 }
 
+static Flag *bind_flag(Flag *f, void *var) {
+    f->bound = var;
+    write_bound_value(f, flag_slot(f)); // Default is visible right after registration
+    return f;
+}
 
 /**
- * flag_parse - Parses command-line arguments and updates registered flags.
- *
- * Supported formats:
- *   --flag                // for booleans
- *   --flag=value          // value assignment in same argument
- *   --flag value          // value assignment in next argument
- *
- * Behavior:
- *   - Matches against all registered flag names.
- *   - Updates the flag's value based on its type (bool, int, string).
- *   - Prints an error and returns non-zero for unknown flags or bad values.
- *
- * @argc: Argument count from main().
- * @argv: Argument vector from main().
+ * flag_string_var - Creates a string flag bound to a variable.
  *
- * Returns:
- *   0 on success
- *   non-zero on error
+ * Like flag_string(), but flag_parse() stores the value straight into *@var
+ * and flags_reset() restores the default there, so hot code reads the flag
+ * with an ordinary load instead of flag_get_string(). The default is
+ * written at registration. The string lives in the set's storage (or in
+ * argv when borrowed) until the next reset or cleanup. Value records leave
+ * bound variables alone; once the set has been reloaded they follow each
+ * published snapshot (see flagset_reload()).
  */
- 
- int flag_parse(int argc, char *argv[]) {
-     for (int i = 1; i < argc; i++) { // Loop through each argument
-         const char *original_arg = argv[i];
-         char *value_from_equal = NULL;
-         int is_negative_bool = 0;
- 
-         // Make a safe copy for matching
-         char argbuf[256];
-         strncpy(argbuf, original_arg, sizeof(argbuf) - 1);
-         argbuf[sizeof(argbuf) - 1] = '\0';
- 
-         // Detect --no-flag for booleans
-         if (strncmp(argbuf, "--no-", 5) == 0) {
-             is_negative_bool = 1;
-             memmove(argbuf + 2, argbuf + 5, strlen(argbuf + 5) + 1); // Remove "no-"
-         }
- 
-         // Check for --flag=value form
-         char *eq = strchr(argbuf, '=');
-         if (eq) {
-             *eq = '\0'; // Split the argument at '='
-             value_from_equal = eq + 1;
-         }
- 
-         // Use the hash table to find the flag
-         Flag *f = flag_find(argbuf);
-         if (f) {
-             const char *val = value_from_equal;
-             if (!val && f->type != TYPE_BOOL) {
-                 if (i + 1 >= argc) {
-                     fprintf(stderr, "Missing value for flag %s\n", f->names[0]);
-                     return 1;
-                 }
-                 val = argv[++i]; // Get the next argument as value
-             }
-             if (set_flag_value(f, val, is_negative_bool) != 0) {
-                 return 1; // Error setting value
-             }
-         } else {
-             fprintf(stderr, "Unknown flag: %s\n", original_arg);
-             return 1; // Return error for unknown flag
-         }
-     }
-     return 0; // Success
- }
+Flag *flag_string_var(const char **var, const char *default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_string_flag(&default_set, default_val, help, 0, args);
+    va_end(args);
+    return bind_flag(f, var);
+}
 
-// Function to find a flag by name in the hash table
-Flag *flag_find(const char *name) {
-    unsigned int index = hash(name); // Compute index
-    HashNode *node = hash_table[index]; // Get the head of the linked list
-    while (node) { // Traverse the linked list
-        for (int n = 0; n < node->flag->name_count; n++) { // Loop through flag names
-            if (strcmp(node->flag->names[n], name) == 0) {
-                return node->flag; // Return the found flag
-            }
-        }
-        node = node->next; // Move to the next node
-    }
-    return NULL; // Return NULL if not found
+Flag *flagset_string_var(FlagSet *set, const char **var, const char *default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_string_flag(set, default_val, help, 0, args);
+    va_end(args);
+    return bind_flag(f, var);
 }
 
-// Functions to free a flag from memory
-void flag_free(Flag *flag) {
-    if (flag) {
-        free(flag->value_str);
-        free(flag);
-    }
+// Function to create a boolean flag bound to a variable
+Flag *flag_bool_var(int *var, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_bool_flag(&default_set, default_val, help, args);
+    va_end(args);
+    return bind_flag(f, var);
 }
 
-void flag_free_group(FlagGroup *group) {
-    if (group) {
-        free(group->flags);
-        free(group);
-    }
+Flag *flagset_bool_var(FlagSet *set, int *var, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_bool_flag(set, default_val, help, args);
+    va_end(args);
+    return bind_flag(f, var);
 }
 
-void flags_cleanup() {
-    for (int i = 0; i < flag_count; i++) {
-        flag_free(flags[i]);
+// Function to create an integer flag bound to a variable
+Flag *flag_int_var(int *var, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_int_flag(&default_set, default_val, help, 0, args);
+    va_end(args);
+    return bind_flag(f, var);
+}
+
+Flag *flagset_int_var(FlagSet *set, int *var, int default_val, const char *help, ...) {
+    va_list args;
+    va_start(args, help);
+    Flag *f = new_int_flag(set, default_val, help, 0, args);
+    va_end(args);
+    return bind_flag(f, var);
+}
+
+// Store a string value, copied into the owner's arena unless borrowed from argv
+static char *store_string(Arena *strings, const char *val, int borrow) {
+    if (borrow) return (char *)val;
+    size_t len = strlen(val) + 1;
+    return memcpy(arena_alloc(strings, len), val, len);
+}
+
+// Bytes per element of a flag's multi array: 4 for int, 8 for every other type
+static inline size_t multi_elem_size(const Flag *f) {
+    return f->type == TYPE_INT ? sizeof(int) : sizeof(uint64_t);
+}
+
+/**
+ * multi_grow - Makes room for at least @needed multi values in @v.
+ *
+ * The array doubles whenever it fills up, so appending stays amortized
+ * O(1) and values remain contiguous. It starts at the flag's reserve hint.
+ * Arrays of the flags themselves come from their set (and its arena if
+ * enabled); arrays of value records (@owner NULL) from malloc, since
+ * records are filled concurrently against a shared set.
+ */
+static void multi_grow(FlagSet *owner, Flag *f, FlagValue *v, int needed) {
+    if (needed <= v->multiple_capacity) return;
+    size_t elem_size = multi_elem_size(f);
+    size_t capacity = v->multiple_capacity;
+    int reserve = flag_info(f)->multiple_reserve;
+    if (!capacity) capacity = reserve > MULTI_MIN_CAPACITY ? (size_t)reserve : MULTI_MIN_CAPACITY;
+    while (capacity < (size_t)needed) capacity *= 2;
+    if (capacity > INT_MAX) capacity = INT_MAX;
+
+    void *old = v->multiple_str_values, *grown;
+    if (owner) {
+        grown = mem_realloc(owner, old, (size_t)v->multiple_capacity * elem_size, capacity * elem_size); // Counts itself
+    } else {
+        FT_STAT_ADD(f->set, allocs, 1);
+        FT_STAT_ADD(f->set, alloc_bytes, capacity * elem_size);
+        if (!(grown = realloc(old, capacity * elem_size))) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    v->multiple_str_values = grown;
+    v->multiple_capacity = (int)capacity;
+}
+
+/**
+ * flag_reserve - Hints how many instances a multi-instance flag will get.
+ *
+ * The flag's value array is allocated with room for @count values right
+ * away, and value records start their arrays at that size, so parsing
+ * does not have to grow them. Further values still grow the arrays.
+ *
+ * Returns:
+ *   @flag, so the call can wrap the creator
+ */
+Flag *flag_reserve(Flag *flag, int count) {
+    if (flag->set && flag->supports_multiple && count > 0) {
+        flag_info(flag)->multiple_reserve = count;
+        multi_grow(flag->set, flag, flag_slot(flag), flag->type == TYPE_STRING ? count + 1 : count);
     }
-    flag_count = 0; // Reset the count
-    for (int n = 0; n < group_count; n++) {
-        flag_free_group(groups[n]);
+    return flag;
+}
+
+// Whether sep can appear inside a value of the flag's type: '\0' always,
+// and for numbers the digits, signs, points and letters (exponents, units)
+static int separator_in_value(const Flag *f, char sep) {
+    if (sep == '\0') return 1;
+    if (f->type == TYPE_STRING) return 0;
+    unsigned char c = (unsigned char)sep;
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') ||
+           c == '+' || c == '-' || c == '.';
+}
+
+/**
+ * flag_separator - Makes every value of a multi-instance flag a list.
+ *
+ * With a separator set, "--ids=1,2,3" appends three values, exactly as
+ * three separate occurrences would. Int lists are parsed in bulk (see
+ * flagtool_intlist.c), string lists are copied once and split in place.
+ * A separator that could be part of a value ('\0', or for number flags a
+ * digit, sign, point or letter) is refused and the flag stays unsplit.
+ *
+ * Returns:
+ *   @flag, so the call can wrap the creator
+ */
+Flag *flag_separator(Flag *flag, char sep) {
+    if (flag->set && flag->supports_multiple && !separator_in_value(flag, sep)) flag->separator = sep;
+    return flag;
+}
+
+/**
+ * flag_on_string - Streams every value of a string multi flag to a handler.
+ *
+ * While parsing into the flag's own set (flag_parse(), flag_stream_feed(),
+ * ...) each value, or each list element with a separator, is passed to
+ * @handler as a view that is only valid during the call, and nothing is
+ * stored: the flag keeps its default however many values arrive. Value
+ * records still collect values as usual.
+ *
+ * Returns:
+ *   @flag, so the call can wrap the creator
+ */
+Flag *flag_on_string(Flag *flag, FlagStringHandler handler, void *ctx) {
+    if (flag->set && flag->supports_multiple && flag->type == TYPE_STRING) {
+        flag_info(flag)->on_string = handler;
+        flag_info(flag)->handler_ctx = ctx;
+        flag->has_handler = handler != NULL;
     }
-    group_count = 0;
-    free_hash_table(); // Clear hash table
+    return flag;
 }
 
-// Function to free hash table
-void free_hash_table() {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        HashNode *node = hash_table[i];
-        while (node) {
-            HashNode *temp = node;
-            node = node->next;
-            free(temp); // Free each node
+// Streams every value of an int multi flag to a handler, converted like stored values
+Flag *flag_on_int(Flag *flag, FlagIntHandler handler, void *ctx) {
+    if (flag->set && flag->supports_multiple && flag->type == TYPE_INT) {
+        flag_info(flag)->on_int = handler;
+        flag_info(flag)->handler_ctx = ctx;
+        flag->has_handler = handler != NULL;
+    }
+    return flag;
+}
+
+// Pass a value (or each element of a list) to the flag's handler
+static int deliver_value(Flag *f, const char *val) {
+    const FlagInfo *info = flag_info(f);
+    const char *end = val + strlen(val);
+    for (const char *p = val;; p++) {
+        const char *stop = f->separator ? memchr(p, f->separator, (size_t)(end - p)) : NULL;
+        if (!stop) stop = end;
+        if (f->separator && stop == p) return FLAG_ERR_BAD_VALUE; // Empty list element
+        if (f->type == TYPE_STRING) {
+            info->on_string(p, (size_t)(stop - p), info->handler_ctx);
+        } else {
+            FlagNumber n;
+            int rc = ft_parse_number(TYPE_INT, p, stop, &n); // Converted like a stored value
+            if (rc != 0) return rc;
+            info->on_int(n.i, info->handler_ctx);
         }
-        hash_table[i] = NULL; // Clear the pointer
+        if (stop == end) return 0;
+        p = stop;
     }
 }
 
-// Function to get the string value of a flag
-const char *flag_get_string(Flag *flag) {
+// Parse one number and append it to a multi flag
+static int append_number(FlagSet *owner, Flag *f, FlagValue *v, const char *s, const char *end) {
+    FlagNumber n;
+    int rc = ft_parse_number(f->type, s, end, &n);
+    if (rc != 0) return rc;
+    multi_grow(owner, f, v, v->multiple_values_count + 1);
+    if (f->type == TYPE_INT) v->multiple_int_values[v->multiple_values_count++] = n.i;
+    else v->multiple_uint64_values[v->multiple_values_count++] = n.u64; // Same 8 bytes for every 64-bit type
+    return 0;
+}
+
+// Tell a malformed int list from one with an element out of range
+static int list_error(const Flag *f, const char *val, size_t len) {
+    FlagNumber n;
+    for (const char *p = val, *end = val + len;; p++) {
+        const char *stop = memchr(p, f->separator, (size_t)(end - p));
+        if (!stop) stop = end;
+        int rc = ft_parse_number(TYPE_INT, p, stop, &n);
+        if (rc != 0 || stop == end) return rc ? rc : FLAG_ERR_BAD_VALUE;
+        p = stop;
+    }
+}
+
+// Append every element of a separated list value to a multi flag
+static int append_list(FlagSet *owner, Flag *f, FlagValue *v, Arena *strings, const char *val, int borrow) {
+    size_t len = strlen(val);
+    if (len / 2 >= (size_t)(INT_MAX - 2 - v->multiple_values_count)) return FLAG_ERR_BAD_VALUE;
+
+    if (f->type == TYPE_INT) {
+        // Reserve the most values the list can hold, the kernel writes in place
+        multi_grow(owner, f, v, v->multiple_values_count + (int)((len + 1) / 2));
+        int n = ft_parse_int_list(val, len, f->separator, v->multiple_int_values + v->multiple_values_count);
+        if (n < 0) return list_error(f, val, len); // Nothing is kept from a bad list
+        v->multiple_values_count += n;
+        return 0;
+    }
+
+    if (f->type != TYPE_STRING) {
+        int first = v->multiple_values_count;
+        for (const char *p = val, *end = val + len;; p++) {
+            const char *stop = memchr(p, f->separator, (size_t)(end - p));
+            if (!stop) stop = end;
+            int rc = append_number(owner, f, v, p, stop);
+            if (rc != 0) {
+                v->multiple_values_count = first; // Nothing is kept from a bad list
+                return rc;
+            }
+            if (stop == end) return 0;
+            p = stop;
+        }
+    }
+
+    if (owner && f->interned) { // Pieces are looked up in place, only new values are copied
+        for (const char *p = val, *end = val + len;; p++) {
+            const char *stop = memchr(p, f->separator, (size_t)(end - p));
+            if (!stop) stop = end;
+            multi_grow(owner, f, v, v->multiple_values_count + 2); // Room for the NULL terminator
+            v->multiple_str_values[v->multiple_values_count++] = ft_intern(f, p, (size_t)(stop - p));
+            if (stop == end) break;
+            p = stop;
+        }
+        v->multiple_str_values[v->multiple_values_count] = NULL;
+        return 0;
+    }
+
+    // Strings are copied (even when borrowing) so they can be split, unless
+    // the borrowed value may be split where it is
+    char *copy = borrow == FT_BORROW_SPLIT ? (char *)val : store_string(strings, val, 0);
+    int n = 1;
+    for (const char *p = copy; (p = memchr(p, f->separator, len - (size_t)(p - copy))); p++) n++;
+    multi_grow(owner, f, v, v->multiple_values_count + n + 1); // Room for the NULL terminator
+    for (char *p = copy;; p++) {
+        v->multiple_str_values[v->multiple_values_count++] = p;
+        p = strchr(p, f->separator);
+        if (!p) break;
+        *p = '\0';
+    }
+    v->multiple_str_values[v->multiple_values_count] = NULL;
+    return 0;
+}
+
+static int set_flag_value(FlagSet *owner, Flag *f, FlagValue *v, Arena *strings, const char *val, int is_negative_bool, int borrow) {
+    if (!f) return FLAG_ERR_UNKNOWN;
+
+    if (!val && f->type != TYPE_BOOL) {
+        return FLAG_ERR_MISSING_VALUE;
+    }
+
+    if (owner && owner->config) {
+        ft_config_claim(owner, f, v); // Overrides the config file from now on, booleans included
+    }
+
+    if (f->type == TYPE_BOOL) {
+        v->value_bool = is_negative_bool ? 0 : 1;
+        return 0;
+    }
+
+    if (owner && owner->env_pending && f->supports_multiple) {
+        ft_drop_env_values(owner, f, v); // First command-line value replaces the environment's
+    }
+
+    if (owner && f->has_handler) {
+        return deliver_value(f, val); // Streamed, nothing is kept
+    }
+
+    if (f->supports_multiple && f->separator) {
+        return append_list(owner, f, v, strings, val, borrow);
+    }
+
+    if (f->supports_multiple) {
+        if (f->type == TYPE_STRING) {
+            multi_grow(owner, f, v, v->multiple_values_count + 2); // Room for the NULL terminator
+            char *copy = owner && f->interned ? ft_intern(f, val, strlen(val)) : store_string(strings, val, borrow);
+            v->multiple_str_values[v->multiple_values_count++] = copy;
+            v->multiple_str_values[v->multiple_values_count] = NULL;
+        } else {
+            return append_number(owner, f, v, val, val + strlen(val));
+        }
+        return 0;
+    } else {
+        // Single-instance setting
+        if (f->type == TYPE_STRING) {
+            v->value_str = store_string(strings, val, borrow);
+        } else {
+            FlagNumber n;
+            int rc = ft_parse_number(f->type, val, val + strlen(val), &n);
+            if (rc != 0) return rc; // Error
+            if (f->type == TYPE_INT) v->value_int = n.i;
+            else v->value_uint64 = n.u64;
+        }
+    }
+
+    return 0;
+}
+
+// Restore one value slot to the flag's defaults
+static void reset_value(Flag *f, FlagValue *v) {
+    if (f->type == TYPE_STRING) {
+        v->value_str = NULL; // Reads fall back to the default
+        if (v->multiple_capacity) v->multiple_str_values[0] = NULL; // Keep the array
+    } else if (f->type == TYPE_BOOL || f->type == TYPE_INT) {
+        v->value_int = f->default_int; // Same storage as the bool value and default
+    } else {
+        v->value_uint64 = f->default_uint64; // Whole 8 bytes of any 64-bit default
+    }
+    v->multiple_values_count = 0;
+}
+
+static const HashEntry *find_entry(FlagSet *set, const char *name, size_t len);
+
+/**
+ * flag_parse - Parses command-line arguments and updates registered flags.
+ *
+ * Supported formats:
+ *   --flag                // for booleans
+ *   --flag=value          // value assignment in same argument
+ *   --flag value          // value assignment in next argument
+ *   @file                 // arguments read from a response file
+ *
+ * Behavior:
+ *   - Matches against all registered flag names.
+ *   - Updates the flag's value based on its type (bool, int, string).
+ *   - Prints an error and returns non-zero for unknown flags or bad values.
+ *
+ * @argc: Argument count from main().
+ * @argv: Argument vector from main().
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero on error
+ */
+
+ // Shared parse loop, names are matched as views into argv without copying.
+ // Values go to the flags themselves, or to `out` leaving the set untouched.
+ int ft_parse_args(FlagSet *set, FlagValues *out, int argc, char *argv[], int first, int borrow, int depth) {
+     for (int i = first; i < argc; i++) { // Loop through each argument
+         const char *original_arg = argv[i];
+         const char *value_from_equal = NULL;
+
+         // Expand @file in place of the argument
+         if (original_arg[0] == '@' && original_arg[1] != '\0') {
+             int rc = ft_parse_response_file(set, out, original_arg + 1, depth + 1, 0);
+             if (rc != 0) return rc;
+             continue;
+         }
+
+         // Check for --flag=value form, the name is everything before '='
+         size_t name_len = strcspn(original_arg, "=");
+         if (original_arg[name_len] == '=') {
+             value_from_equal = original_arg + name_len + 1;
+         }
+
+         // Use the hash table to find the flag (--no-flag is a registered alias)
+         const HashEntry *e = find_entry(set, original_arg, name_len);
+         if (!e && set->abbrev) {
+             int ambiguous;
+             e = ft_find_abbrev(set, original_arg, name_len, &ambiguous);
+             if (ambiguous) {
+                 if (!out) fprintf(stderr, "Ambiguous flag: %s\n", original_arg);
+                 return FLAG_ERR_AMBIGUOUS;
+             }
+         }
+         // Global flags of the commands above a subcommand's set
+         for (FlagSet *p = set->parent; !e && p && !out; p = p->parent) {
+             e = find_entry(p, original_arg, name_len);
+         }
+         if (!e && !out && depth == 0 && set->command_count) {
+             // A subcommand takes the rest of the command line
+             FlagCommand *cmd = ft_find_command(set, original_arg);
+             if (cmd) return ft_parse_command(set, cmd, argc, argv, i + 1, borrow);
+         }
+         if (!e) {
+             if (!out) fprintf(stderr, "Unknown flag: %s\n", original_arg);
+             return FLAG_ERR_UNKNOWN; // Return error for unknown flag
+         }
+         Flag *f = e->flag;
+         if (out && f->index >= out->count) return FLAG_ERR_UNKNOWN; // Registered after the record
+         const char *val = value_from_equal;
+         if (!val && f->type != TYPE_BOOL) {
+             if (i + 1 >= argc) {
+                 if (!out) fprintf(stderr, "Missing value for flag %s\n", flag_info(f)->names[0]);
+                 return FLAG_ERR_MISSING_VALUE;
+             }
+             val = argv[++i]; // Get the next argument as value
+         }
+         FlagSet *owner = out ? NULL : f->set; // A global flag stores into its own set
+         FlagValue *v = out ? &out->slots[f->index] : flag_slot(f);
+         int rc = set_flag_value(owner, f, v, out ? &out->strings : &owner->values, val, e->negated, borrow);
+         if (rc != 0) {
+             if (!out && rc == FLAG_ERR_MISSING_VALUE) fprintf(stderr, "Missing value for flag %s\n", flag_info(f)->names[0]);
+             return rc; // Error setting value
+         }
+         if (!out) write_bound(f);
+         else if (out->seen) out->seen[f->index] = 1;
+     }
+     return 0; // Success
+ }
+
+// Store one value of a flag parsed into its own set, strings copied unless borrowed
+int ft_set_value(FlagSet *set, Flag *f, const char *val, int negated, int borrow) {
+    int rc = set_flag_value(set, f, flag_slot(f), &set->values, val, negated, borrow);
+    if (rc == 0) write_bound(f);
+    return rc;
+}
+
+// Put one flag of a set back to its default, as flagset_reset() does
+void ft_reset_flag(Flag *f) {
+    reset_value(f, flag_slot(f));
+    write_bound(f);
+}
+
+void ft_write_bound(Flag *f) {
+    write_bound(f);
+}
+
+// Store one value of a flag into a record, like the parse loop with `out` set
+int ft_record_value(FlagValues *out, Flag *f, const char *val, int negated, int borrow) {
+    return set_flag_value(NULL, f, &out->slots[f->index], &out->strings, val, negated, borrow);
+}
+
+// Apply a value parsed into a record to the flag itself, in the order the
+// serial loop would have stored it: a single value replaces, multi values append
+void ft_merge_value(Flag *f, const FlagValue *from) {
+    FlagValue *v = flag_slot(f);
+    if (f->set->config) ft_config_claim(f->set, f, v);
+    if (!f->supports_multiple) {
+        v->value_uint64 = from->value_uint64; // Whole scalar, string pointer included
+    } else if (from->multiple_values_count) {
+        if (f->set->env_pending) ft_drop_env_values(f->set, f, v);
+        int n = from->multiple_values_count, terminated = f->type == TYPE_STRING;
+        multi_grow(f->set, f, v, v->multiple_values_count + n + terminated);
+        if (f->interned) { // The record holds plain copies
+            for (int i = 0; i < n; i++) {
+                const char *s = from->multiple_str_values[i];
+                v->multiple_str_values[v->multiple_values_count + i] = ft_intern(f, s, strlen(s));
+            }
+        } else {
+            size_t elem_size = multi_elem_size(f);
+            memcpy((char *)v->multiple_str_values + (size_t)v->multiple_values_count * elem_size,
+                   from->multiple_str_values, (size_t)n * elem_size);
+        }
+        v->multiple_values_count += n;
+        if (terminated) v->multiple_str_values[v->multiple_values_count] = NULL;
+    }
+    write_bound(f);
+}
+
+// Replace a flag's own value with a copy of another (a mapped image's),
+// strings and multi arrays copied into the set as if they had been parsed
+void ft_copy_value(Flag *f, const FlagValue *from) {
+    FlagSet *set = f->set;
+    FlagValue *v = flag_slot(f);
+    if (set->config) ft_config_claim(set, f, v);
+    reset_value(f, v);
+    if (f->type == TYPE_STRING) {
+        v->value_str = from->value_str ? store_string(&set->values, from->value_str, 0) : NULL;
+    } else {
+        v->value_uint64 = from->value_uint64; // Whole scalar of any other type
+    }
+    int n = f->supports_multiple ? from->multiple_values_count : 0;
+    if (n) {
+        int terminated = f->type == TYPE_STRING;
+        multi_grow(set, f, v, n + terminated);
+        if (f->type == TYPE_STRING) {
+            for (int i = 0; i < n; i++) {
+                const char *str = from->multiple_str_values[i];
+                v->multiple_str_values[i] = f->interned ? ft_intern(f, str, strlen(str)) : store_string(&set->values, str, 0);
+            }
+            v->multiple_str_values[n] = NULL;
+        } else {
+            memcpy(v->multiple_str_values, from->multiple_str_values, (size_t)n * multi_elem_size(f));
+        }
+        v->multiple_values_count = n;
+    }
+    write_bound(f);
+}
+
+// Move the string blocks of a record into its schema's value arena, so
+// merged values stay valid after the record is reset or freed
+void ft_adopt_strings(FlagSet *set, FlagValues *values) {
+    Arena *from = &values->strings, *into = &set->values;
+    while (from->blocks) {
+        ArenaBlock *block = from->blocks;
+        from->blocks = block->next;
+        if (into->blocks) { // Behind the current block, which keeps filling up
+            block->next = into->blocks->next;
+            into->blocks->next = block;
+        } else {
+            block->next = NULL;
+            into->blocks = block; // Unused until cur is set, the next allocation starts a block
+        }
+    }
+    from->cur = from->user_buf;
+    from->end = from->user_buf + from->user_size;
+}
+
+// Parse a whole command line (argv[0] is the program), timed for flag_stats
+static int parse_command_line(FlagSet *set, FlagValues *out, int argc, char *argv[], int borrow) {
+    if (!out) set->active = NULL; // Set again if a subcommand is named
+    FT_STAT_CLOCK(start);
+    int rc = ft_parse_args(set, out, argc, argv, 1, borrow, 0);
+    FT_STAT_ADD(set, parses, 1);
+    FT_STAT_ADD(set, parsed_args, argc > 1 ? argc - 1 : 0);
+    FT_STAT_ELAPSED(set, parse_ns, start);
+    if (!out) ft_publish_parse(set);
+    return rc;
+}
+
+ int flag_parse(int argc, char *argv[]) {
+     return parse_command_line(&default_set, NULL, argc, argv, 0);
+ }
+
+int flagset_parse(FlagSet *set, int argc, char *argv[]) {
+    return parse_command_line(set, NULL, argc, argv, 0);
+}
+
+/**
+ * flag_parse_borrowed - Parses like flag_parse() without copying anything.
+ *
+ * String values are stored as pointers into @argv instead of copies, so
+ * @argv must outlive every value read from the flags (true for main()'s
+ * argv).
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero on error
+ */
+int flag_parse_borrowed(int argc, char *argv[]) {
+    return parse_command_line(&default_set, NULL, argc, argv, 1);
+}
+
+int flagset_parse_borrowed(FlagSet *set, int argc, char *argv[]) {
+    return parse_command_line(set, NULL, argc, argv, 1);
+}
+
+/**
+ * flagset_reset - Restores every flag of a set to its default value.
+ *
+ * The registry, hash tables and value buffers are kept, so a set can be
+ * reset and reparsed over and over without touching the allocator once its
+ * buffers have grown to fit the command lines it sees. The layers go with
+ * the values: a loaded config file is released (load it again to get it
+ * back, reloads do nothing until then) and flagset_apply_env() applies
+ * the environment again.
+ */
+void flagset_reset(FlagSet *set) {
+    FT_STAT_CLOCK(start);
+    for (int i = 0; i < set->flag_count; i++) {
+        reset_value(set->flags[i], &set->slots[i]);
+        write_bound(set->flags[i]);
+        if (set->flags[i]->interned) ft_reset_pool(&set->info[i]);
+    }
+    arena_rewind(&set->values);
+    ft_release_mappings(&set->mappings);
+    ft_release_config(set); // Its values are gone, and they point into its mapping
+    if (set->env_pending) memset(set->env_pending, 0, (size_t)set->env_capacity); // Environment values are gone too
+    set->env_applied = 0;
+    ft_reset_commands(set);
+    ft_publish(set);
+    FT_STAT_ELAPSED(set, reset_ns, start);
+}
+
+void flags_reset() {
+    flagset_reset(&default_set);
+}
+
+// Create a value record with one slot per flag currently registered in schema
+FlagValues *flag_values_new(FlagSet *schema) {
+    int count = schema->flag_count;
+    FlagValues *values = calloc(1, sizeof(FlagValues) + (size_t)count * sizeof(FlagValue));
+    if (!values) {
+        perror("calloc");
+        exit(1);
+    }
+    values->schema = schema;
+    values->count = count;
+    values->mappings = NULL;
+    arena_init(&values->strings, NULL, 0, 1024);
+    flag_values_reset(values);
+    return values;
+}
+
+// Restore defaults in a value record, keeping its string buffer for reuse
+void flag_values_reset(FlagValues *values) {
+    for (int i = 0; i < values->count; i++) {
+        reset_value(values->schema->flags[i], &values->slots[i]);
+    }
+    values->error = 0;
+    arena_rewind(&values->strings);
+    ft_release_mappings(&values->mappings);
+}
+
+void flag_values_free(FlagValues *values) {
+    if (values) {
+        for (int i = 0; i < values->count; i++) {
+            free(values->slots[i].multiple_str_values); // Multi arrays of records come from malloc
+        }
+        free(values->seen);
+        arena_release(&values->strings);
+        ft_release_mappings(&values->mappings);
+        free(values);
+    }
+}
+
+// Copy of a multi string value, with the ID in front for a pooled one as the pool stores it
+static char *copy_string(Arena *strings, const Flag *f, const char *s) {
+    size_t prefix = f->interned ? sizeof(uint32_t) : 0, len = strlen(s) + 1;
+    char *copy = arena_alloc(strings, prefix + len);
+    memcpy(copy, s - prefix, prefix + len);
+    return copy + prefix;
+}
+
+/**
+ * ft_values_copy - Copies every value of a set into a new record.
+ *
+ * The record shares no memory with the set: strings go to its arena and
+ * multi arrays come from malloc, sized to the values. So the set's values
+ * can change, be reset or rewound while readers hold the copy.
+ *
+ * Returns:
+ *   New record, freed with flag_values_free()
+ */
+FlagValues *ft_values_copy(FlagSet *set) {
+    FlagValues *copy = flag_values_new(set);
+    for (int i = 0; i < set->flag_count; i++) {
+        Flag *f = set->flags[i];
+        const FlagValue *from = &set->slots[i];
+        FlagValue *v = &copy->slots[i];
+        if (f->type != TYPE_STRING) {
+            v->value_uint64 = from->value_uint64; // Whole scalar of any other type
+        } else if (from->value_str) {
+            v->value_str = store_string(&copy->strings, from->value_str, 0);
+        }
+        int n = f->supports_multiple ? from->multiple_values_count : 0;
+        if (!n) continue;
+        int terminated = f->type == TYPE_STRING;
+        v->multiple_str_values = malloc((size_t)(n + terminated) * multi_elem_size(f));
+        if (!v->multiple_str_values) {
+            perror("malloc");
+            exit(1);
+        }
+        if (terminated) {
+            for (int k = 0; k < n; k++) v->multiple_str_values[k] = copy_string(&copy->strings, f, from->multiple_str_values[k]);
+            v->multiple_str_values[n] = NULL;
+        } else {
+            memcpy(v->multiple_str_values, from->multiple_str_values, (size_t)n * multi_elem_size(f));
+        }
+        v->multiple_values_count = n;
+        v->multiple_capacity = n + terminated;
+    }
+    return copy;
+}
+
+// Write the bound variables of a set from a record of it, 1 if a bound
+// string now points into the record
+int ft_write_bound_values(const FlagValues *values) {
+    int strings = 0;
+    for (int i = 0; i < values->count; i++) {
+        Flag *f = values->schema->flags[i];
+        if (!f->bound) continue;
+        write_bound_value(f, &values->slots[i]);
+        strings |= f->type == TYPE_STRING && values->slots[i].value_str;
+    }
+    return strings;
+}
+
+/**
+ * ft_reload_slots - Rebuilds the values of a set under a new command line.
+ *
+ * Every flag goes back to its default, then the layers are applied again
+ * in their usual order: the loaded config file, the environment if
+ * flagset_apply_env() ran, and last the flags @argv_values saw on the
+ * command line. The record's strings and mappings move into the set.
+ */
+void ft_reload_slots(FlagSet *set, FlagValues *argv_values) {
+    for (int i = 0; i < set->flag_count; i++) {
+        reset_value(set->flags[i], &set->slots[i]);
+    }
+    arena_rewind(&set->values);
+    ft_release_mappings(&set->mappings);
+    if (set->env_pending) memset(set->env_pending, 0, (size_t)set->env_capacity);
+    if (set->config) ft_config_reapply(set);
+    if (set->env_applied) ft_env_reapply(set); // Converted before, errors are not expected
+    ft_adopt_strings(set, argv_values);
+    FlagMapping **tail = &argv_values->mappings;
+    while (*tail) tail = &(*tail)->next;
+    *tail = set->mappings;
+    set->mappings = argv_values->mappings;
+    argv_values->mappings = NULL;
+    for (int i = 0; i < argv_values->count; i++) {
+        if (argv_values->seen[i]) ft_merge_value(set->flags[i], &argv_values->slots[i]);
+    }
+}
+
+/**
+ * flag_parse_values - Parses a command line into a value record.
+ *
+ * Only reads @schema, so any number of threads may parse into their own
+ * records against one shared schema at the same time, as long as nobody
+ * registers flags meanwhile. Values accumulate on top of what the record
+ * holds; call flag_values_reset() to start over. Nothing is printed.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error (also kept in the record)
+ */
+int flag_parse_values(FlagSet *schema, FlagValues *values, int argc, char *argv[]) {
+    values->error = parse_command_line(schema, values, argc, argv, 0);
+    return values->error;
+}
+
+int flag_values_error(const FlagValues *values) {
+    return values->error;
+}
+
+// Key collected while freezing
+typedef struct FreezeKey {
+    HashEntry entry;    // Name, length and flag
+    uint64_t hash;      // Seeded hash of the name
+    size_t bucket;      // Displacement bucket of the hash
+} FreezeKey;
+
+// Bucket of keys while searching for its displacement
+typedef struct FreezeBucket {
+    size_t first;   // Index of the first key of the bucket
+    size_t size;    // Number of keys in the bucket
+    size_t id;      // Bucket number
+} FreezeBucket;
+
+static int compare_freeze_buckets(const void *a, const void *b) {
+    const FreezeBucket *x = a, *y = b;
+    if (x->size != y->size) return x->size < y->size ? 1 : -1; // Largest first
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static int compare_keys_by_bucket(const void *a, const void *b) {
+    size_t x = ((const FreezeKey *)a)->bucket;
+    size_t y = ((const FreezeKey *)b)->bucket;
+    return x < y ? -1 : x > y;
+}
+
+// Try to place every bucket with the current seed, returns 0 on success
+static int freeze_try(FrozenTable *ft, FreezeKey *keys, size_t n, FreezeBucket *buckets, char *taken) {
+    for (size_t i = 0; i < n; i++) {
+        keys[i].hash = hash64(keys[i].entry.name, keys[i].entry.len, ft->seed);
+        keys[i].bucket = frozen_bucket(ft, keys[i].hash);
+    }
+    qsort(keys, n, sizeof(FreezeKey), compare_keys_by_bucket);
+
+    // Split keys into buckets and handle the largest buckets first
+    size_t used = 0;
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && keys[j].bucket == keys[i].bucket) j++;
+        buckets[used++] = (FreezeBucket){ i, j - i, keys[i].bucket };
+        i = j;
+    }
+    qsort(buckets, used, sizeof(FreezeBucket), compare_freeze_buckets);
+
+    memset(taken, 0, n);
+    memset(ft->disp, 0, ft->bucket_count * sizeof(uint32_t));
+    size_t slots[64];
+    for (size_t b = 0; b < used; b++) {
+        FreezeBucket *bk = &buckets[b];
+        if (bk->size > 64) return 1; // Hopelessly unbalanced, reseed
+        uint32_t d, attempt;
+        for (attempt = 0; attempt < (1u << 20); attempt++) {
+            d = attempt ? (uint32_t)mix64(attempt) : 0;
+            size_t k;
+            for (k = 0; k < bk->size; k++) {
+                slots[k] = frozen_slot(ft, keys[bk->first + k].hash, d);
+                if (taken[slots[k]]) break;
+                size_t m;
+                for (m = 0; m < k && slots[m] != slots[k]; m++);
+                if (m < k) break;
+            }
+            if (k == bk->size) break; // Every key of the bucket fits
+        }
+        if (attempt == (1u << 20)) return 1;
+        ft->disp[bk->id] = d;
+        for (size_t k = 0; k < bk->size; k++) {
+            taken[slots[k]] = 1;
+            ft->slots[slots[k]] = keys[bk->first + k].entry;
+        }
+    }
+    return 0;
+}
+
+/**
+ * flags_freeze - Compiles all registered names into a minimal perfect hash.
+ *
+ * Call after registration and before flag_parse(). Afterwards flag_find()
+ * answers with one probe into a contiguous table and one length-checked
+ * compare. Registering another flag thaws the table again.
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero if no table could be built (lookups keep using the hash table)
+ */
+int flagset_freeze(FlagSet *set) {
+    FT_STAT_CLOCK(start);
+    flags_thaw(set);
+
+    // The hash table already maps each distinct name to its latest flag
+    size_t n = set->hash_table_used;
+    if (n == 0) return 0;
+    FreezeKey *keys = malloc(n * sizeof(FreezeKey));
+    if (!keys) {
+        perror("malloc");
+        exit(1);
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < set->hash_table_size; i++) {
+        HashEntry *e = &set->hash_table[i];
+        if (e->flag) keys[k++] = (FreezeKey){ *e, 0, 0 };
+    }
+
+    FrozenTable *ft = &set->frozen;
+    ft->slot_count = n;
+    ft->bucket_count = (n + 3) / 4;
+    ft->slots = mem_calloc(set, n, sizeof(HashEntry));
+    ft->disp = mem_calloc(set, ft->bucket_count, sizeof(uint32_t));
+    FreezeBucket *buckets = malloc(ft->bucket_count * sizeof(FreezeBucket)); // Scratch
+    char *taken = malloc(n);
+    if (!buckets || !taken) {
+        perror("malloc");
+        exit(1);
+    }
+
+    int rc = 1;
+    for (int attempt = 0; attempt < 16 && rc; attempt++) {
+        ft->seed = mix64(0x5eed + attempt);
+        rc = freeze_try(ft, keys, n, buckets, taken);
+    }
+    free(keys);
+    free(buckets);
+    free(taken);
+    FT_STAT_ELAPSED(set, freeze_ns, start);
+    if (rc) {
+        flags_thaw(set);
+        return 1;
+    }
+    ft->active = 1;
+    return 0;
+}
+
+int flags_freeze() {
+    return flagset_freeze(&default_set);
+}
+
+// Function to find a name in the frozen table: one probe, one compare
+static const HashEntry *frozen_find(const FrozenTable *ft, const char *name, size_t len) {
+    uint64_t h = hash64(name, len, ft->seed);
+    const HashEntry *e = &ft->slots[frozen_slot(ft, h, ft->disp[frozen_bucket(ft, h)])];
+    if (e->len == len && memcmp(e->name, name, len) == 0) return e;
+    return NULL;
+}
+
+#ifdef FLAGTOOL_STATS
+// Replay a lookup to count the slots it inspected and names it compared
+static void count_find(FlagSet *set, const char *name, size_t len, const HashEntry *hit) {
+    uint64_t probes = 0, compares = 0;
+    if (set->frozen.active) {
+        const FrozenTable *ft = &set->frozen;
+        uint64_t h = hash64(name, len, ft->seed);
+        probes = 1;
+        compares = ft->slots[frozen_slot(ft, h, ft->disp[frozen_bucket(ft, h)])].len == len;
+    } else if (set->hash_table) {
+        uint64_t h = hash64(name, len, 0);
+        size_t mask = set->hash_table_size - 1;
+        for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+            const HashEntry *e = &set->hash_table[i];
+            probes++;
+            if (!e->flag || e == hit) break;
+            compares += e->hash == (uint32_t)h && e->len == len; // Differs after memcmp
+        }
+        compares += hit != NULL;
+    }
+    FT_STAT_ADD(set, finds, 1);
+    FT_STAT_ADD(set, find_hits, hit != NULL);
+    FT_STAT_ADD(set, probes, probes);
+    FT_STAT_ADD(set, compares, compares);
+}
+#endif
+
+// Function to find a name given as pointer and length, NULL if unknown
+static const HashEntry *find_entry(FlagSet *set, const char *name, size_t len) {
+    const HashEntry *e;
+    if (set->frozen.active) {
+        e = frozen_find(&set->frozen, name, len);
+    } else if (!set->hash_table) {
+        e = NULL;
+    } else {
+        e = hash_table_slot(set->hash_table, set->hash_table_size, name, len, hash64(name, len, 0));
+        if (!e->flag) e = NULL; // Probe ended on an empty slot
+    }
+    FT_STAT_FIND(set, name, len, e);
+    return e;
+}
+
+// Lookup of flag_find(), without abbreviations
+const HashEntry *ft_find_name(FlagSet *set, const char *name, size_t len) {
+    return find_entry(set, name, len);
+}
+
+// Lookup of the streaming and parallel parsers, abbreviations included;
+// *ambiguous is set to 1 (and NULL returned) when an abbreviation matches
+// several flags, as the serial loop reports it
+const HashEntry *ft_find_entry(FlagSet *set, const char *name, size_t len, int *ambiguous) {
+    const HashEntry *e = find_entry(set, name, len);
+    *ambiguous = 0;
+    if (!e && set->abbrev) e = ft_find_abbrev(set, name, len, ambiguous);
+    return e;
+}
+
+// Function to find a flag by name in the hash table
+Flag *flagset_find(FlagSet *set, const char *name) {
+    size_t len = strlen(name);
+    const HashEntry *e = find_entry(set, name, len);
+    if (e) return e->flag;
+    return set->image ? ft_image_find(set, name, len) : NULL; // Flags of a mapped image
+}
+
+Flag *flag_find(const char *name) {
+    return flagset_find(&default_set, name);
+}
+
+// Functions to free a flag's values (strings live in the set's value arena,
+// the flag itself in the set's flag store until flagset_cleanup())
+void flag_free(Flag *flag) {
+    if (flag && flag->set) { // Flags of a mapped image are read-only
+        FlagValue *v = flag_slot(flag);
+        mem_free(flag->set, v->multiple_str_values);
+        v->multiple_str_values = NULL;
+        v->multiple_capacity = 0;
+        v->multiple_values_count = 0;
+        ft_publish(flag->set);
+    }
+}
+
+void flag_free_group(FlagGroup *group) {
+    if (group) {
+        mem_free(group->set, (char *)group->name);
+        mem_free(group->set, group->flags);
+        mem_free(group->set, group);
+    }
+}
+
+void flagset_cleanup(FlagSet *set) {
+    FT_STAT_CLOCK(start);
+    ft_release_live(set); // Snapshot refers to the flags freed below
+    ft_release_commands(set); // Commands come from the set's allocator, maybe the arena below
+    // With an arena everything below is released by arena_release()
+    for (int i = 0; i < set->flag_count && !set->use_arena; i++) {
+        flag_free(set->flags[i]);
+    }
+    for (int i = 0; i < set->flag_count; i++) {
+        ft_release_pool(&set->info[i]);
+    }
+    mem_free(set, set->flags);
+    mem_free(set, set->slots);
+    mem_free(set, set->info);
+    set->flags = NULL;
+    set->slots = NULL;
+    set->info = NULL;
+    set->flag_count = 0; // Reset the count
+    set->flag_capacity = 0;
+    arena_release(&set->flag_store);
+    ft_release_image(set);
+    for (int n = 0; n < set->group_count && !set->use_arena; n++) {
+        flag_free_group(set->groups[n]);
+    }
+    mem_free(set, set->groups);
+    set->groups = NULL;
+    set->group_count = 0;
+    set->group_capacity = 0;
+    flagset_free_hash_table(set); // Clear hash table
+    flags_thaw(set); // Drop the frozen table
+    arena_release(&set->arena); // Single release of all arena blocks
+    arena_release(&set->values);
+    ft_release_mappings(&set->mappings);
+    ft_release_config(set);
+    ft_release_env(set);
+    ft_release_usage(set);
+    FT_STAT_ELAPSED(set, cleanup_ns, start);
+}
+
+void flags_cleanup() {
+    flagset_cleanup(&default_set);
+}
+
+// Function to free hash table
+void flagset_free_hash_table(FlagSet *set) {
+    // A frozen table still resolves the --no- aliases, flags_thaw() frees them
+    for (size_t i = 0; i < set->hash_table_size && !set->use_arena && !set->frozen.active; i++) {
+        if (set->hash_table[i].negated) mem_free(set, (char *)set->hash_table[i].name);
+    }
+    mem_free(set, set->hash_table);
+    ft_release_prefix(set);
+    set->hash_table = NULL;
+    set->hash_table_size = 0;
+    set->hash_table_used = 0;
+}
+
+void free_hash_table() {
+    flagset_free_hash_table(&default_set);
+}
+
+// Value slot of a flag in a record, NULL if the flag was registered later
+static const FlagValue *record_slot(const FlagValues *values, Flag *flag) {
+    if (flag->set != values->schema || flag->index >= values->count) return NULL;
+    return &values->slots[flag->index];
+}
+
+// Typed readers shared by the flag and record getters
+static const char *value_get_string(Flag *flag, const FlagValue *v) {
     if (flag->type != TYPE_STRING) return NULL; // Check type
-    if (flag->is_set) return flag->value_str; // Return current value if set
+    if (v && v->value_str) return v->value_str; // Return current value if set
     return flag->default_str; // Return default value
 }
 
+static int value_get_bool(Flag *flag, const FlagValue *v) {
+    if (flag->type != TYPE_BOOL) return 0; // Check type
+    return v ? v->value_bool : flag->default_bool;
+}
+
+static int value_get_int(Flag *flag, const FlagValue *v) {
+    if (flag->type != TYPE_INT) return 0; // Check type
+    return v ? v->value_int : flag->default_int;
+}
+
+static const char **value_get_string_multi(Flag *flag, const FlagValue *v) {
+    static const char *none[] = { NULL };
+    if (flag->type != TYPE_STRING || !flag->supports_multiple) return NULL;
+    return v && v->multiple_values_count ? (const char **)v->multiple_str_values : none;
+}
+
+// Multi getters return an empty array, never NULL, for a flag without values
+static const int *value_get_int_multi(Flag *flag, const FlagValue *v) {
+    static const int none[1];
+    if (flag->type != TYPE_INT || !flag->supports_multiple) return NULL;
+    return v && v->multiple_int_values ? v->multiple_int_values : none;
+}
+
+static int value_get_multiple_int_count(Flag *flag, const FlagValue *v) {
+    if (flag->type != TYPE_INT || !flag->supports_multiple) return 0;
+    return v ? v->multiple_values_count : 0;
+}
+
+static int value_get_multi_count(Flag *flag, const FlagValue *v) {
+    if (!flag->supports_multiple) return 0;
+    return v ? v->multiple_values_count : 0;
+}
+
+// Readers, flag and record getters of one numeric type (scalar and multi)
+#define NUMBER_GETTERS(name, ctype, member, flag_type)                                  \
+    static ctype value_get_##name(Flag *flag, const FlagValue *v) {                     \
+        if (flag->type != flag_type) return 0; /* Check type */                         \
+        return v ? v->value_##member : flag->default_##member;                          \
+    }                                                                                   \
+    static const ctype *value_get_##name##_multi(Flag *flag, const FlagValue *v) {      \
+        static const ctype none[1];                                                     \
+        if (flag->type != flag_type || !flag->supports_multiple) return NULL;           \
+        return v && v->multiple_##member##_values ? v->multiple_##member##_values : none; \
+    }                                                                                   \
+    ctype flag_get_##name(Flag *flag) {                                                 \
+        READ_FLAG(ctype, value_get_##name, flag, 0);                                    \
+    }                                                                                   \
+    const ctype *flag_get_##name##_multi(Flag *flag) {                                  \
+        READ_FLAG(const ctype *, value_get_##name##_multi, flag, 1);                    \
+    }                                                                                   \
+    ctype flag_values_get_##name(const FlagValues *values, Flag *flag) {                \
+        return value_get_##name(flag, record_slot(values, flag));                       \
+    }                                                                                   \
+    const ctype *flag_values_get_##name##_multi(const FlagValues *values, Flag *flag) { \
+        return value_get_##name##_multi(flag, record_slot(values, flag));               \
+    }
+
+// Read a flag with `getter`: from its own slot, from the mapping for a flag
+// of a snapshot image, or once the set has been reloaded from the published
+// snapshot inside a (lock-free) read section. A pointer result (`escapes`)
+// read outside any section of the caller keeps its snapshot alive
+#define READ_FLAG(type, getter, flag, escapes)                                          \
+    do {                                                                                \
+        if (!(flag)->set) {                                                             \
+            FlagValue mapped;                                                           \
+            return getter(flag, ft_image_value(flag, &mapped));                         \
+        }                                                                               \
+        if (!atomic_load_explicit(&(flag)->set->live, memory_order_relaxed)) {          \
+            return getter(flag, flag_slot(flag));                                       \
+        }                                                                               \
+        flag_read_lock();                                                               \
+        FlagValues *live = atomic_load(&(flag)->set->live);                             \
+        type result = getter(flag, record_slot(live, flag));                            \
+        if (escapes) ft_escape(live);                                                   \
+        flag_read_unlock();                                                             \
+        return result;                                                                  \
+    } while (0)
+
+// Function to get the string value of a flag
+const char *flag_get_string(Flag *flag) {
+    READ_FLAG(const char *, value_get_string, flag, 1);
+}
+
 // Function to get the boolean value of a flag
 int flag_get_bool(Flag *flag) {
-    if (flag->type != TYPE_BOOL) return 0; // Check type
-    return flag->value_bool; // Return current boolean value
+    READ_FLAG(int, value_get_bool, flag, 0);
 }
 
 // Function to get the integer value of a flag
 int flag_get_int(Flag *flag) {
-    if (flag->type != TYPE_INT) return 0; // Check type
-    return flag->value_int; // Return current integer value
+    READ_FLAG(int, value_get_int, flag, 0);
 }
 
 // Function to get the string values from a multi-instance flag
 const char **flag_get_string_multi(Flag *flag) {
-    if (flag->type != TYPE_STRING || !flag->supports_multiple) return NULL;
-    return (const char **)flag->multiple_str_values;
+    READ_FLAG(const char **, value_get_string_multi, flag, 1);
 }
 
 const int *flag_get_int_multi(Flag *flag) {
-    if (flag->type != TYPE_INT || !flag->supports_multiple) return NULL;
-    return flag->multiple_int_values;
+    READ_FLAG(const int *, value_get_int_multi, flag, 1);
 }
 
 int flag_get_multiple_int_count(Flag *flag) {
-    if (flag->type != TYPE_INT || !flag->supports_multiple) return 0;
-    return flag->multiple_values_count;
-}
-
-void print_flag_usage(const char *progname) {
-    printf("Usage: %s [flags]\nFlags:\n", progname);
-
-    // Loop through all groups and print their flags
-    for (int i = 0; i < group_count; i++) {
-        FlagGroup *group = groups[i];
-        printf("  %s:\n", group->name);
-        for (int j = 0; j < group->flag_count; j++) {
-            Flag *f = group->flags[j];
-            printf("    ");
-            for (int n = 0; n < f->name_count; n++) {
-                printf("%s", f->names[n]);
-                if (n + 1 < f->name_count) printf(", "); // Comma separation
-            }
-            // Print help based on type
-            switch (f->type) {
-                case TYPE_STRING:
-                    printf(" <string>\t%s (default: %s)\n", f->help, f->default_str ? f->default_str : "none");
-                    break;
-                case TYPE_BOOL:
-                    printf("\t%s (default: %s)\n", f->help, f->default_bool ? "true" : "false");
-                    break;
-                case TYPE_INT:
-                    printf(" <int>\t%s (default: %d)\n", f->help, f->default_int);
-                    break;
-            }
-        }
-    }
+    READ_FLAG(int, value_get_multiple_int_count, flag, 0);
+}
 
-    // Print ungrouped flags
-    printf("\nUngrouped Flags:\n");
-    for (int i = 0; i < flag_count; i++) {
-        Flag *f = flags[i];
-        if (f->group == NULL) { // Check if the flag is not part of any group
-            printf("    ");
-            for (int n = 0; n < f->name_count; n++) {
-                printf("%s", f->names[n]);
-                if (n + 1 < f->name_count) printf(", "); // Comma separation
-            }
-            // Print help based on type
-            switch (f->type) {
-                case TYPE_STRING:
-                    printf(" <string>\t%s (default: %s)\n", f->help, f->default_str ? f->default_str : "none");
-                    break;
-                case TYPE_BOOL:
-                    printf("\t%s (default: %s)\n", f->help, f->default_bool ? "true" : "false");
-                    break;
-                case TYPE_INT:
-                    printf(" <int>\t%s (default: %d)\n", f->help, f->default_int);
-                    break;
-            }
-        }
-    }
+// Function to get the number of values of a multi-instance flag (string or int)
+int flag_get_multi_count(Flag *flag) {
+    READ_FLAG(int, value_get_multi_count, flag, 0);
+}
+
+// Getters reading a flag's value from a record instead of the flag itself
+const char *flag_values_get_string(const FlagValues *values, Flag *flag) {
+    return value_get_string(flag, record_slot(values, flag));
+}
+
+int flag_values_get_bool(const FlagValues *values, Flag *flag) {
+    return value_get_bool(flag, record_slot(values, flag));
 }
+
+int flag_values_get_int(const FlagValues *values, Flag *flag) {
+    return value_get_int(flag, record_slot(values, flag));
+}
+
+const char **flag_values_get_string_multi(const FlagValues *values, Flag *flag) {
+    return value_get_string_multi(flag, record_slot(values, flag));
+}
+
+const int *flag_values_get_int_multi(const FlagValues *values, Flag *flag) {
+    return value_get_int_multi(flag, record_slot(values, flag));
+}
+
+int flag_values_get_multiple_int_count(const FlagValues *values, Flag *flag) {
+    return value_get_multiple_int_count(flag, record_slot(values, flag));
+}
+
+int flag_values_get_multi_count(const FlagValues *values, Flag *flag) {
+    return value_get_multi_count(flag, record_slot(values, flag));
+}
+
+NUMBER_GETTERS(int64, int64_t, int64, TYPE_INT64)
+NUMBER_GETTERS(uint64, uint64_t, uint64, TYPE_UINT64)
+NUMBER_GETTERS(double, double, double, TYPE_DOUBLE)
+NUMBER_GETTERS(size, uint64_t, uint64, TYPE_SIZE)
+NUMBER_GETTERS(duration, int64_t, int64, TYPE_DURATION)
@@ -0,0 +1,101 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Batch parsing: many argv vectors against one shared, read-only schema.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Vectors a worker claims at once, amortizes the shared counter
+#define BATCH_CHUNK 64
+
+// Work shared by every worker of one batch
+typedef struct BatchJob {
+    FlagSet *schema;            // Read-only schema
+    int n;                      // Number of vectors
+    const int *argcs;           // Argument counts
+    char ***argvs;              // Argument vectors
+    FlagValues **results;       // Record per vector
+    int *errors;                // Error code per vector (optional)
+    atomic_int next;            // Next unclaimed vector
+    atomic_int failed;          // Vectors that did not parse
+} BatchJob;
+
+// Worker loop: claim chunks of vectors until none are left
+static void *batch_worker(void *arg) {
+    BatchJob *job = arg;
+    int failed = 0;
+    for (;;) {
+        int first = atomic_fetch_add_explicit(&job->next, BATCH_CHUNK, memory_order_relaxed);
+        if (first >= job->n) break;
+        int last = first + BATCH_CHUNK < job->n ? first + BATCH_CHUNK : job->n;
+        for (int i = first; i < last; i++) {
+            flag_values_reset(job->results[i]);
+            int rc = flag_parse_values(job->schema, job->results[i], job->argcs[i], job->argvs[i]);
+            if (job->errors) job->errors[i] = rc;
+            if (rc) failed++;
+        }
+    }
+    atomic_fetch_add_explicit(&job->failed, failed, memory_order_relaxed);
+    return NULL;
+}
+
+/**
+ * flag_parse_batch_threads - Parses many command lines in parallel.
+ *
+ * Every vector is parsed into its own record, which is reset first, so
+ * the records can be reused from one batch to the next. The schema is only
+ * read; freeze it beforehand with flagset_freeze() for the fastest lookups
+ * and do not register flags while a batch runs.
+ *
+ * @threads: Number of workers, <= 0 for one per online CPU.
+ *
+ * Returns:
+ *   the number of vectors that failed to parse (0 if all succeeded)
+ */
+int flag_parse_batch_threads(FlagSet *schema, int n, const int argcs[], char **argvs[],
+                             FlagValues *results[], int errors[], int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    int max_threads = (n + BATCH_CHUNK - 1) / BATCH_CHUNK; // No idle workers
+    if (threads > max_threads) threads = max_threads > 0 ? max_threads : 1;
+
+    BatchJob job = { schema, n, argcs, argvs, results, errors, 0, 0 };
+    if (threads == 1) {
+        batch_worker(&job); // Run inline, no thread start-up cost
+        return atomic_load(&job.failed);
+    }
+
+    pthread_t *workers = malloc((size_t)threads * sizeof(pthread_t));
+    if (!workers) {
+        perror("malloc");
+        exit(1);
+    }
+    int started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&workers[started], NULL, batch_worker, &job) != 0) break;
+    }
+    batch_worker(&job); // The calling thread works too
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    return atomic_load(&job.failed);
+}
+
+int flag_parse_batch(FlagSet *schema, int n, const int argcs[], char **argvs[],
+                     FlagValues *results[], int errors[]) {
+    return flag_parse_batch_threads(schema, n, argcs, argvs, results, errors, 0);
+}
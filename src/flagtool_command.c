@@ -0,0 +1,140 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Subcommands: each command owns a flag set that is only created, and only
+ * has its flags registered, when the command's name shows up on the command
+ * line. A binary with dozens of commands pays registration for one of them.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * flagset_command - Registers a subcommand of a set.
+ *
+ * Nothing but the name is recorded: @init runs with the command's own set
+ * the first time the parse meets @name, and registers the command's flags
+ * (and possibly commands of its own). Arguments after the name are parsed
+ * into that set; flags of @set and of the sets above it still apply there
+ * as global flags. The config file and environment already applied to
+ * @set are applied to the command's set when it is created. @name and
+ * @help must outlive the set.
+ *
+ * Returns:
+ *   The command, for flag_active_command() comparisons
+ */
+FlagCommand *flagset_command(FlagSet *set, const char *name, const char *help, FlagCommandInit init, void *ctx) {
+    if (set->command_count == set->command_capacity) {
+        int capacity = set->command_capacity ? set->command_capacity * 2 : 8;
+        set->commands = ft_mem_realloc(set, set->commands, (size_t)set->command_capacity * sizeof(FlagCommand *),
+                                       (size_t)capacity * sizeof(FlagCommand *));
+        set->command_capacity = capacity;
+    }
+    FlagCommand *cmd = ft_mem_calloc(set, 1, sizeof(FlagCommand));
+    *cmd = (FlagCommand){ name, help ? help : "", init, ctx, set, NULL };
+    set->commands[set->command_count++] = cmd;
+    set->generation++; // Listed in the usage
+    return cmd;
+}
+
+FlagCommand *flag_command(const char *name, const char *help, FlagCommandInit init, void *ctx) {
+    return flagset_command(ft_default_set(), name, help, init, ctx);
+}
+
+// Command the last parse of the set dispatched to, NULL if it named none
+FlagCommand *flagset_active_command(FlagSet *set) {
+    return set->active;
+}
+
+FlagCommand *flag_active_command() {
+    return flagset_active_command(ft_default_set());
+}
+
+const char *flag_command_name(const FlagCommand *cmd) {
+    return cmd->name;
+}
+
+// Set holding the command's flags, registering them if the command has not run yet
+FlagSet *flag_command_set(FlagCommand *cmd) {
+    return ft_command_set(cmd);
+}
+
+/**
+ * command_create - Creates and registers the set of a command on first use.
+ *
+ * The set comes from the parent's allocator (and uses an arena of its own
+ * if the parent does). The layers already applied to the parent are
+ * applied to it in the same order: the command's lines of the parent's
+ * config file, then the environment, so the command line still wins.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code of the config file or environment
+ */
+static int command_create(FlagCommand *cmd) {
+    FlagSet *parent = cmd->parent;
+    FlagSet *set = ft_mem_calloc(parent, 1, sizeof(FlagSet));
+    if (parent->use_arena) flagset_use_arena(set, NULL, 0);
+    set->parent = parent;
+    set->env_prefix = parent->env_prefix; // Same naming and matching rules below
+    set->abbrev = parent->abbrev;
+    cmd->set = set;
+    if (cmd->init) cmd->init(set, cmd->ctx);
+
+    int rc = ft_config_inherit(set, cmd->name);
+    if (rc == 0 && parent->env_applied) rc = flagset_apply_env(set);
+    return rc;
+}
+
+FlagSet *ft_command_set(FlagCommand *cmd) {
+    if (!cmd->set) command_create(cmd); // Errors are reported, the parse returns them
+    return cmd->set;
+}
+
+// Linear scan, a binary has tens of commands and looks one up per parse
+FlagCommand *ft_find_command(FlagSet *set, const char *name) {
+    for (int i = 0; i < set->command_count; i++) {
+        if (strcmp(set->commands[i]->name, name) == 0) return set->commands[i];
+    }
+    return NULL;
+}
+
+// Parse argv[first..argc) into a command's set, created and registered now if needed
+int ft_parse_command(FlagSet *set, FlagCommand *cmd, int argc, char *argv[], int first, int borrow) {
+    set->active = cmd;
+    if (!cmd->set) {
+        int rc = command_create(cmd);
+        if (rc != 0) return rc;
+    }
+    return ft_parse_args(cmd->set, NULL, argc, argv, first, borrow, 0);
+}
+
+// Reset the commands that ran along with their set, they stay registered
+void ft_reset_commands(FlagSet *set) {
+    for (int i = 0; i < set->command_count; i++) {
+        if (set->commands[i]->set) flagset_reset(set->commands[i]->set);
+    }
+    set->active = NULL;
+}
+
+void ft_release_commands(FlagSet *set) {
+    for (int i = 0; i < set->command_count; i++) {
+        if (set->commands[i]->set) {
+            flagset_cleanup(set->commands[i]->set);
+            ft_mem_free(set, set->commands[i]->set);
+        }
+        ft_mem_free(set, set->commands[i]);
+    }
+    ft_mem_free(set, set->commands);
+    set->commands = NULL;
+    set->command_count = 0;
+    set->command_capacity = 0;
+    set->active = NULL;
+}
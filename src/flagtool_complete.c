@@ -0,0 +1,279 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Prefix queries over the registered names: shell completion through
+ * `--__complete <partial>` and unique-prefix abbreviations (--verb for
+ * --verbose). Both search one sorted array of the names, --no- aliases
+ * included, built on first use and dropped when a name is registered.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Bytewise order of two names, a name sorts before its extensions
+static int compare_names(const char *a, size_t alen, const char *b, size_t blen) {
+    int r = memcmp(a, b, alen < blen ? alen : blen);
+    if (r) return r;
+    return alen < blen ? -1 : alen > blen;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const HashEntry *x = a, *y = b;
+    return compare_names(x->name, x->len, y->name, y->len);
+}
+
+// Order of a name cut to len bytes against the prefix, 0 if it starts with it
+static inline int compare_prefix(const HashEntry *e, const char *prefix, size_t len) {
+    if (e->len >= len) return memcmp(e->name, prefix, len);
+    int r = memcmp(e->name, prefix, e->len);
+    return r ? r : -1;
+}
+
+// Table holding every name of the set, NULL if nothing is registered
+static const HashEntry *registry_table(const FlagSet *set, size_t *size, size_t *used) {
+    if (!set->hash_table && set->frozen.active) { // Hash table freed after freezing
+        *size = *used = set->frozen.slot_count;
+        return set->frozen.slots;
+    }
+    *size = set->hash_table_size;
+    *used = set->hash_table_used;
+    return set->hash_table;
+}
+
+// Copy the live entries of the registry and sort them by name
+static PrefixIndex *prefix_index_build(FlagSet *set) {
+    size_t size, count;
+    const HashEntry *table = registry_table(set, &size, &count);
+    PrefixIndex *idx = malloc(sizeof(PrefixIndex) + count * sizeof(HashEntry));
+    if (!idx) {
+        perror("malloc");
+        exit(1);
+    }
+    idx->count = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (table[i].flag) idx->entries[idx->count++] = table[i];
+    }
+    qsort(idx->entries, idx->count, sizeof(HashEntry), compare_entries);
+    return idx;
+}
+
+// Index of the set, built by the first query. Concurrent first queries
+// (flag_parse_values against a shared schema) race benignly: one index is
+// published and the others are dropped.
+static const PrefixIndex *prefix_index(FlagSet *set) {
+    PrefixIndex *idx = atomic_load_explicit(&set->prefix, memory_order_acquire);
+    if (idx) return idx;
+    PrefixIndex *built = prefix_index_build(set);
+    if (atomic_compare_exchange_strong_explicit(&set->prefix, &idx, built, memory_order_acq_rel,
+                                                memory_order_acquire)) {
+        return built;
+    }
+    free(built);
+    return idx;
+}
+
+/**
+ * prefix_range - Finds the names starting with a prefix.
+ *
+ * Two binary searches over the sorted names: the first name not ordered
+ * before the prefix, and the first one ordered after every extension of it.
+ *
+ * Returns:
+ *   Index of the first match, the matches end at *end
+ */
+static size_t prefix_range(const PrefixIndex *idx, const char *prefix, size_t len, size_t *end) {
+    size_t lo = 0, hi = idx->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_prefix(&idx->entries[mid], prefix, len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t first = lo;
+    hi = idx->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_prefix(&idx->entries[mid], prefix, len) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *end = lo;
+    return first;
+}
+
+void ft_release_prefix(FlagSet *set) {
+    free(atomic_exchange_explicit(&set->prefix, NULL, memory_order_acq_rel));
+}
+
+/**
+ * ft_find_abbrev - Resolves a unique prefix of a long name.
+ *
+ * Only --names of sets with abbreviations enabled are expanded. All
+ * matches have to be spellings of the same flag (and the same --no- sense)
+ * for the prefix to be unique.
+ *
+ * Returns:
+ *   Entry of the name the prefix abbreviates, or NULL
+ *   *ambiguous set to 1 when several flags match
+ */
+const HashEntry *ft_find_abbrev(FlagSet *set, const char *name, size_t len, int *ambiguous) {
+    *ambiguous = 0;
+    if (!set->abbrev || len < 3 || name[0] != '-' || name[1] != '-') return NULL;
+    const PrefixIndex *idx = prefix_index(set);
+    size_t end, first = prefix_range(idx, name, len, &end);
+    if (first == end) return NULL;
+    const HashEntry *e = &idx->entries[first];
+    for (size_t i = first + 1; i < end; i++) {
+        if (idx->entries[i].flag != e->flag || idx->entries[i].negated != e->negated) {
+            *ambiguous = 1;
+            return NULL;
+        }
+    }
+    return e;
+}
+
+// Accept unique prefixes of long names in flagset_parse() and friends
+void flagset_allow_abbrev(FlagSet *set, int allow) {
+    set->abbrev = allow != 0;
+}
+
+void flag_allow_abbrev(int allow) {
+    flagset_allow_abbrev(ft_default_set(), allow);
+}
+
+/**
+ * flagset_complete - Lists the registered names starting with a prefix.
+ *
+ * Names come out in bytewise order, --no- forms of boolean flags included.
+ * Only the registry is read, never the values. The pointers stay valid
+ * until the next flag is registered.
+ *
+ * @names: Receives the first @max matches, may be NULL if @max is 0.
+ *
+ * Returns:
+ *   Total number of matching names, which may exceed @max
+ */
+int flagset_complete(FlagSet *set, const char *partial, const char **names, int max) {
+    if (!set->hash_table && !set->frozen.active) return 0;
+    const PrefixIndex *idx = prefix_index(set);
+    size_t end, first = prefix_range(idx, partial, strlen(partial), &end);
+    for (size_t i = first; i < end && (int)(i - first) < max; i++) {
+        names[i - first] = idx->entries[i].name;
+    }
+    return (int)(end - first);
+}
+
+int flag_complete(const char *partial, const char **names, int max) {
+    return flagset_complete(ft_default_set(), partial, names, max);
+}
+
+// Add the names of one set starting with the prefix to a growing list, its
+// command names too unless the set is only inherited from
+static void collect_matches(const FlagSet *set, const char *prefix, size_t len, int commands,
+                            HashEntry **list, size_t *count, size_t *capacity) {
+    size_t size, used;
+    const HashEntry *table = registry_table(set, &size, &used);
+    size_t needed = *count + used + (size_t)set->command_count;
+    if (needed > *capacity) {
+        *capacity = needed * 2;
+        *list = realloc(*list, *capacity * sizeof(HashEntry));
+        if (!*list) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    for (size_t i = 0; table && i < size; i++) {
+        if (table[i].flag && compare_prefix(&table[i], prefix, len) == 0) (*list)[(*count)++] = table[i];
+    }
+    if (!commands || (len && prefix[0] == '-')) return; // Commands are words
+    for (int i = 0; i < set->command_count; i++) {
+        const char *name = set->commands[i]->name;
+        HashEntry e = { name, NULL, 0, (uint32_t)strlen(name), 0 };
+        if (compare_prefix(&e, prefix, len) == 0) (*list)[(*count)++] = e;
+    }
+}
+
+/**
+ * flagset_complete_command_line - Answers a shell completion request.
+ *
+ * A command line `prog --__complete [words...] partial` asks for the names
+ * completing the last word: flag names, those of the global flags inherited
+ * by a subcommand named among the words, and subcommand names. They are
+ * written to stdout one per line with a single write(2), before any value
+ * is touched. Nothing is printed when the word is a value (after '=' or
+ * after a flag that takes the next argument), so the shell falls back to
+ * its own completion. The parse functions never look for the request: the
+ * program calls this first, on its own argv, and exits when it answered.
+ *
+ * A completing process asks exactly one question, so the tables are
+ * scanned once and only the matches sorted, which is cheaper than sorting
+ * every name into the prefix index.
+ *
+ * Returns:
+ *   1 if argv was a completion request (answered), 0 otherwise
+ */
+int flagset_complete_command_line(FlagSet *set, int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "--__complete") != 0) return 0;
+    const char *partial = argc > 2 ? argv[argc - 1] : "";
+    size_t len = strlen(partial);
+
+    // Descend into the subcommands named before the partial word
+    for (int i = 2; i < argc - 1; i++) {
+        FlagCommand *cmd = argv[i][0] != '-' ? ft_find_command(set, argv[i]) : NULL;
+        if (cmd) set = ft_command_set(cmd);
+    }
+    int is_value = strchr(partial, '=') != NULL;
+    if (argc > 3 && !is_value) { // Value of the flag before it?
+        const char *prev = argv[argc - 2];
+        size_t prev_len = strcspn(prev, "=");
+        const HashEntry *e = NULL;
+        int ambiguous = 0;
+        if (!prev[prev_len]) e = ft_find_entry(set, prev, prev_len, &ambiguous);
+        // Globals of the parents match exactly, as in the parse loop; an
+        // ambiguous abbreviation takes no value, so the word is a flag
+        for (FlagSet *p = set->parent; !e && !ambiguous && p && !prev[prev_len]; p = p->parent) {
+            e = ft_find_name(p, prev, prev_len);
+        }
+        is_value = e && e->flag->type != TYPE_BOOL;
+    }
+
+    HashEntry *matches = NULL;
+    size_t count = 0, capacity = 0;
+    for (FlagSet *p = set; p && !is_value; p = p->parent) {
+        collect_matches(p, partial, len, p == set, &matches, &count, &capacity);
+    }
+    if (count) qsort(matches, count, sizeof(HashEntry), compare_entries);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) bytes += matches[i].len + 1;
+    char *buf = malloc(bytes + 1);
+    if (!buf) {
+        perror("malloc");
+        exit(1);
+    }
+    char *w = buf;
+    for (size_t i = 0; i < count; i++) {
+        if (i && compare_entries(&matches[i - 1], &matches[i]) == 0) continue; // Shadowed global
+        memcpy(w, matches[i].name, matches[i].len);
+        w += matches[i].len;
+        *w++ = '\n';
+    }
+    for (size_t off = 0; off < (size_t)(w - buf);) { // One write unless the pipe is short
+        ssize_t n = write(STDOUT_FILENO, buf + off, (size_t)(w - buf) - off);
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+    free(buf);
+    free(matches);
+    return 1;
+}
+
+int flag_complete_command_line(int argc, char *argv[]) {
+    return flagset_complete_command_line(ft_default_set(), argc, argv);
+}
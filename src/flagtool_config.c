@@ -0,0 +1,562 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Config files: `key = value` lines applied as a layer under the
+ * environment and the command line. The file is memory-mapped and split in
+ * place, string values point into the mapping. Reloading after the file
+ * changed compares it flag by flag with the previous version and re-applies
+ * only the flags whose lines changed.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define CONFIG_MAX_KEY 128
+
+// Who last stored into a flag, by flag index
+enum {
+    CONFIG_NONE,        // Not in the file, nothing stored since it was loaded
+    CONFIG_OWNED,       // Holds exactly the file's values
+    CONFIG_CLAIMED      // Stored by a later layer, reloads leave it alone
+};
+
+// One `key = value` line, resolved to its flag
+typedef struct ConfigEntry {
+    Flag *flag;
+    const char *key;        // Key as written, in the mapping
+    char *value;            // Terminated in place in the mapping
+    uint32_t key_len;       // Length of the key
+    uint32_t len;           // Length of the value
+    uint32_t line;          // Line number, for messages
+    unsigned char negated;  // Key is the --no- alias of a boolean flag
+    unsigned char split;    // List value split in place, separators now '\0'
+} ConfigEntry;
+
+// Entries of one version of the file, in file order and grouped by flag
+typedef struct ConfigVersion {
+    FlagMapping *mapping;   // The file, keys and values point into it
+    ConfigEntry *entries;   // In file order
+    int *order;             // Entry indices sorted by flag, file order within a flag
+    int *first;             // Flag i has order[first[i]] to order[first[i + 1] - 1]
+    int flag_count;         // Flags first has room for
+    int count;              // Number of entries
+    struct stat st;         // Identity and mtime of the mapped file
+} ConfigVersion;
+
+typedef struct ConfigSource {
+    char *path;             // File to reload from
+    char *scope;            // `command.` prefix of the lines of a command's set, or NULL
+    ConfigVersion now;      // Version the flags hold
+    unsigned char *state;   // CONFIG_*, by flag index
+    int state_capacity;
+    int applying;           // Stores are the file's own, not claims
+} ConfigSource;
+
+static void version_release(ConfigVersion *v) {
+    if (v->mapping) ft_release_mappings(&v->mapping);
+    free(v->entries);
+    free(v->order);
+    free(v->first);
+    memset(v, 0, sizeof(*v));
+}
+
+// Grow the state array to cover every flag of the set
+static void state_fit(ConfigSource *c, int count) {
+    if (count <= c->state_capacity) return;
+    unsigned char *grown = realloc(c->state, (size_t)count);
+    if (!grown) {
+        perror("realloc");
+        exit(1);
+    }
+    memset(grown + c->state_capacity, CONFIG_NONE, (size_t)(count - c->state_capacity));
+    c->state = grown;
+    c->state_capacity = count;
+}
+
+/**
+ * ft_config_claim - Hands a flag over from the config file to a later layer.
+ *
+ * Called for every value stored into a set with a config file, except for
+ * the file's own. Values from the file stop counting: a multi-instance
+ * flag drops them before the new value is appended, and reloads no longer
+ * touch the flag.
+ */
+void ft_config_claim(FlagSet *set, Flag *f, FlagValue *v) {
+    ConfigSource *c = set->config;
+    if (c->applying) return;
+    state_fit(c, set->flag_count);
+    if (c->state[f->index] == CONFIG_OWNED && f->supports_multiple) {
+        v->multiple_values_count = 0;
+        if (f->type == TYPE_STRING && v->multiple_capacity) v->multiple_str_values[0] = NULL;
+    }
+    c->state[f->index] = CONFIG_CLAIMED;
+}
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int config_error(const char *path, uint32_t line, const char *what, int rc) {
+    fprintf(stderr, "%s in %s:%u\n", what, path, line);
+    return rc;
+}
+
+// Whether a key is `command.key` for a command of the set, read by the command's set
+static int command_key(FlagSet *set, const char *key, size_t len) {
+    const char *dot = memchr(key, '.', len);
+    if (!dot || dot == key || dot - key > CONFIG_MAX_KEY || !set->command_count) return 0;
+    char name[CONFIG_MAX_KEY + 1];
+    memcpy(name, key, (size_t)(dot - key));
+    name[dot - key] = '\0';
+    return ft_find_command(set, name) != NULL;
+}
+
+/**
+ * scan_lines - Splits a mapped config file into resolved entries.
+ *
+ * Each line is blank, a comment starting with '#' or ';', or
+ * `key = value` with blanks allowed around both. A key is a long name
+ * without its dashes (`max-conns`) or any registered name written out
+ * (`-v`). A value may be wrapped in matching single or double quotes,
+ * which are dropped. Values are terminated by overwriting the byte after
+ * them, so @end must be followed by one writable byte. `command.key`
+ * lines belong to a command of the set and are skipped; the set of a
+ * command reads only the lines starting with its own scope.
+ *
+ * Keys are resolved against @prev first: a line is compared with the line
+ * after the previous version's entry of the last key looked up, which is
+ * the same line unless lines were added or removed around it. Most lines
+ * of a file that changed in a few places are resolved by one short
+ * memcmp() instead of a hash lookup.
+ *
+ * Returns:
+ *   0 on success, entries appended to *out (grown with realloc)
+ *   FLAG_ERR_CONFIG for a malformed line, FLAG_ERR_UNKNOWN for an unknown key
+ */
+static int scan_lines(FlagSet *set, const char *path, char *p, char *end, const ConfigVersion *prev,
+                      ConfigVersion *out) {
+    int capacity = 0, guess = 0; // Entry of prev expected next
+    if (prev->count) { // Most likely about as many lines as before
+        capacity = prev->count + prev->count / 8;
+        out->entries = malloc((size_t)capacity * sizeof(ConfigEntry));
+        if (!out->entries) {
+            perror("malloc");
+            exit(1);
+        }
+    }
+    char name[CONFIG_MAX_KEY + 2] = "--";
+    const char *scope = set->config->scope;
+    size_t scope_len = scope ? strlen(scope) : 0;
+    for (uint32_t line = 1; p < end; line++) {
+        char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        char *next = eol + 1;
+        while (p < eol && is_blank(*p)) p++;
+        while (eol > p && is_blank(eol[-1])) eol--;
+        if (p == eol || *p == '#' || *p == ';') {
+            p = next;
+            continue;
+        }
+
+        const char *key = p;
+        char *eq = memchr(p, '=', (size_t)(eol - p));
+        if (!eq) return config_error(path, line, "Malformed line", FLAG_ERR_CONFIG);
+        for (p = eq; p > key && is_blank(p[-1]); p--) {}
+        size_t key_len = (size_t)(p - key); // Blanks inside make it unknown
+        if (key_len == 0) return config_error(path, line, "Malformed line", FLAG_ERR_CONFIG);
+        for (p = eq + 1; p < eol && is_blank(*p); p++) {}
+        if (eol - p >= 2 && (*p == '"' || *p == '\'') && eol[-1] == *p) { // Quoted
+            p++;
+            eol--;
+        }
+        if (scope_len) { // Another set's line unless it starts with our scope
+            if (key_len <= scope_len || memcmp(key, scope, scope_len) != 0) {
+                p = next;
+                continue;
+            }
+            key += scope_len;
+            key_len -= scope_len;
+        }
+
+        Flag *flag = NULL;
+        unsigned char negated = 0;
+        const ConfigEntry *same = guess < prev->count ? &prev->entries[guess] : NULL;
+        if (same && same->key_len == key_len && memcmp(same->key, key, key_len) == 0) {
+            flag = same->flag;
+            negated = same->negated;
+            guess++;
+        } else {
+            const HashEntry *e = NULL;
+            if (key[0] == '-') {
+                e = ft_find_name(set, key, key_len);
+            } else if (key_len <= CONFIG_MAX_KEY) {
+                memcpy(name + 2, key, key_len);
+                e = ft_find_name(set, name, key_len + 2);
+            }
+            if (!e && command_key(set, key, key_len)) { // Applied when the command's set is created
+                p = next;
+                continue;
+            }
+            if (!e) {
+                fprintf(stderr, "Unknown key %.*s in %s:%u\n", (int)key_len, key, path, line);
+                return FLAG_ERR_UNKNOWN;
+            }
+            flag = e->flag;
+            negated = e->negated;
+            int i = flag->index;
+            if (i < prev->flag_count && prev->first[i + 1] > prev->first[i]) {
+                guess = prev->order[prev->first[i + 1] - 1] + 1; // Resynchronize after its last line
+            }
+        }
+
+        *eol = '\0';
+        if (out->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            ConfigEntry *grown = realloc(out->entries, (size_t)capacity * sizeof(ConfigEntry));
+            if (!grown) {
+                perror("realloc");
+                exit(1);
+            }
+            out->entries = grown;
+        }
+        out->entries[out->count++] = (ConfigEntry){ flag, key, p, (uint32_t)key_len, (uint32_t)(eol - p), line, negated, 0 };
+        p = next;
+    }
+    return 0;
+}
+
+// Group the entries by flag, keeping file order within a flag (counting sort)
+static void group_entries(ConfigVersion *v, int flag_count) {
+    v->flag_count = flag_count;
+    v->first = calloc((size_t)flag_count + 1, sizeof(int));
+    v->order = malloc((size_t)v->count * sizeof(int) + 1);
+    int *at = malloc(((size_t)flag_count + 1) * sizeof(int));
+    if (!v->first || !v->order || !at) {
+        perror("malloc");
+        exit(1);
+    }
+    for (int i = 0; i < v->count; i++) v->first[v->entries[i].flag->index + 1]++;
+    for (int i = 0; i < flag_count; i++) v->first[i + 1] += v->first[i];
+    memcpy(at, v->first, ((size_t)flag_count + 1) * sizeof(int));
+    for (int i = 0; i < v->count; i++) v->order[at[v->entries[i].flag->index]++] = i;
+    free(at);
+}
+
+// Entries of flag i in a version as indices, none for flags registered after it
+static const int *flag_entries(const ConfigVersion *v, int i, int *n) {
+    if (i >= v->flag_count) {
+        *n = 0;
+        return NULL;
+    }
+    *n = v->first[i + 1] - v->first[i];
+    return v->order + v->first[i];
+}
+
+// Whether a flag's string lists are split inside the mapping, so its values
+// point into one version of the file even when they are lists
+static int splits_in_place(const Flag *f) {
+    return f->type == TYPE_STRING && f->supports_multiple && f->separator && !f->interned && !f->has_handler;
+}
+
+// Whether flag i has the same lines, in the same order, in both versions.
+// Lists split in place count as changed: they are split again in the new
+// mapping, which costs less than pointing every piece into it
+static int same_lines(const ConfigVersion *a, const ConfigVersion *b, int i) {
+    int n, m;
+    const int *x = flag_entries(a, i, &n), *y = flag_entries(b, i, &m);
+    if (n != m || (n && splits_in_place(a->entries[x[0]].flag))) return 0;
+    for (int k = 0; k < n; k++) {
+        const ConfigEntry *p = &a->entries[x[k]], *q = &b->entries[y[k]];
+        if (p->len != q->len || p->negated != q->negated || memcmp(p->value, q->value, p->len) != 0) return 0;
+    }
+    return 1;
+}
+
+// Negation to store a boolean entry with, -1 if the value is not a boolean
+static int entry_negated(const ConfigEntry *e) {
+    int b = ft_parse_bool_word(e->value);
+    if (b < 0) return -1;
+    return e->negated ? b : !b;
+}
+
+// Store one entry the way the parse loop would, or into a record to check
+// it. String lists are split in the mapping, so reloads do not copy them
+// into the set's storage again and again
+static int apply_entry(FlagSet *set, FlagValues *check, ConfigEntry *e) {
+    const char *val = e->value;
+    int negated = 0;
+    if (e->flag->type == TYPE_BOOL) {
+        negated = entry_negated(e);
+        if (negated < 0) return FLAG_ERR_BAD_VALUE;
+        val = NULL;
+    }
+    if (check) return ft_record_value(check, e->flag, val, negated, 1);
+    if (!splits_in_place(e->flag)) return ft_set_value(set, e->flag, val, negated, 1);
+    if (e->split) { // Applied before: join the pieces again
+        for (uint32_t k = 0; k < e->len; k++) {
+            if (e->value[k] == '\0') ((char *)e->value)[k] = e->flag->separator;
+        }
+    }
+    e->split = 1;
+    return ft_set_value(set, e->flag, val, negated, FT_BORROW_SPLIT);
+}
+
+// Point the values of an unchanged flag at the new mapping, when they were
+// borrowed from the old one
+static void rebase_strings(Flag *f, const ConfigVersion *v) {
+    if (f->type != TYPE_STRING || f->has_handler || f->interned || (f->supports_multiple && f->separator)) return;
+    int n;
+    const int *lines = flag_entries(v, f->index, &n);
+    FlagValue *slot = &f->set->slots[f->index];
+    if (!f->supports_multiple) {
+        slot->value_str = (char *)v->entries[lines[n - 1]].value; // Last line wins
+        ft_write_bound(f);
+        return;
+    }
+    for (int k = 0; k < n && k < slot->multiple_values_count; k++) {
+        slot->multiple_str_values[k] = (char *)v->entries[lines[k]].value;
+    }
+}
+
+/**
+ * config_update - Moves the config layer of a set to the file at @path.
+ *
+ * The new version is read and checked completely before any flag changes:
+ * a malformed line, unknown key or bad value leaves the flags and the
+ * previous version as they were. Then every flag whose lines differ from
+ * the previous version goes back to its default and gets the new lines
+ * applied; unchanged flags only have their strings pointed into the new
+ * mapping. Flags claimed by another layer are skipped either way.
+ */
+static int config_update(FlagSet *set, const char *path) {
+    ConfigSource *c = set->config;
+    ConfigVersion next = { 0 };
+    next.mapping = ft_map_file(path, &next.st);
+    if (!next.mapping) {
+        fprintf(stderr, "Cannot read config file %s: %s\n", path, strerror(errno));
+        return FLAG_ERR_CONFIG;
+    }
+    char *text = next.mapping->addr;
+    int rc = scan_lines(set, path, text, text + next.mapping->len - 1, &c->now, &next);
+    if (rc != 0) {
+        version_release(&next);
+        return rc;
+    }
+    group_entries(&next, set->flag_count);
+    state_fit(c, set->flag_count);
+
+    // Flags whose lines changed (every flag of a first load), values checked
+    // in a record so a bad one leaves everything as it was
+    int *changed = malloc((size_t)set->flag_count * sizeof(int) + 1);
+    if (!changed) {
+        perror("malloc");
+        exit(1);
+    }
+    int changed_count = 0;
+    FlagValues *check = NULL;
+    for (int i = 0; i < set->flag_count && rc == 0; i++) {
+        int n_old, n_new;
+        flag_entries(&c->now, i, &n_old);
+        const int *lines = flag_entries(&next, i, &n_new);
+        if (c->state[i] == CONFIG_CLAIMED || n_old + n_new == 0) continue;
+        if (same_lines(&c->now, &next, i)) continue;
+        changed[changed_count++] = i;
+        if (!check && n_new) check = flag_values_new(set);
+        for (int k = 0; k < n_new && rc == 0; k++) {
+            ConfigEntry *e = &next.entries[lines[k]];
+            rc = apply_entry(set, check, e);
+            if (rc != 0) fprintf(stderr, "Invalid value for flag %s in %s:%u\n", set->info[i].names[0], path, e->line);
+        }
+    }
+    if (check) flag_values_free(check);
+    if (rc != 0) {
+        free(changed);
+        version_release(&next);
+        return rc;
+    }
+
+    c->applying = 1;
+    for (int k = 0, i = 0; i < set->flag_count; i++) {
+        if (k < changed_count && changed[k] == i) {
+            k++;
+            int n;
+            const int *lines = flag_entries(&next, i, &n);
+            ft_reset_flag(set->flags[i]);
+            for (int j = 0; j < n; j++) apply_entry(set, NULL, &next.entries[lines[j]]);
+            c->state[i] = n ? CONFIG_OWNED : CONFIG_NONE;
+        } else if (c->state[i] == CONFIG_OWNED) {
+            rebase_strings(set->flags[i], &next);
+        }
+    }
+    c->applying = 0;
+    free(changed);
+    version_release(&c->now); // Nothing points into it anymore
+    c->now = next;
+    return 0;
+}
+
+// Apply the loaded version again to a set whose values were all put back
+// to their defaults (ft_reload_slots()), its values were checked on load
+void ft_config_reapply(FlagSet *set) {
+    ConfigSource *c = set->config;
+    state_fit(c, set->flag_count);
+    c->applying = 1;
+    for (int i = 0; i < set->flag_count; i++) {
+        int n;
+        const int *lines = flag_entries(&c->now, i, &n);
+        for (int j = 0; j < n; j++) apply_entry(set, NULL, &c->now.entries[lines[j]]);
+        c->state[i] = n ? CONFIG_OWNED : CONFIG_NONE;
+    }
+    c->applying = 0;
+}
+
+// Config layer of a set, created empty on first use
+static ConfigSource *config_source(FlagSet *set) {
+    if (!set->config) {
+        set->config = calloc(1, sizeof(ConfigSource));
+        if (!set->config) {
+            perror("calloc");
+            exit(1);
+        }
+    }
+    return set->config;
+}
+
+// Move the config layers of the commands that already have a set along
+static int follow_commands(FlagSet *set, int reload) {
+    int rc = 0;
+    for (int i = 0; i < set->command_count && rc == 0; i++) {
+        FlagCommand *cmd = set->commands[i];
+        if (!cmd->set) continue;
+        rc = reload ? flagset_reload_config(cmd->set) : ft_config_inherit(cmd->set, cmd->name);
+    }
+    return rc;
+}
+
+/**
+ * flagset_load_config - Applies a config file to a set.
+ *
+ * Load it before flagset_apply_env() and flagset_parse(): any value stored
+ * into a flag afterwards, by the environment, the command line or a
+ * stream, overrides the file's (the first one replaces the file's values
+ * of a multi-instance flag). Values convert like command-line values;
+ * booleans take the words of the environment fallback. A repeated key is
+ * applied like a repeated flag. Loading another path replaces the layer,
+ * changing only the flags whose lines differ. flagset_reset() drops it.
+ * Lines keyed `command.key` go to that command's set, when it is created
+ * or right away if it already exists (see ft_config_inherit()).
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_CONFIG if the file cannot be read or has a malformed line
+ *   FLAG_ERR_* code for an unknown key or bad value, nothing is applied
+ */
+int flagset_load_config(FlagSet *set, const char *path) {
+    config_source(set);
+    int rc = config_update(set, path);
+    if (rc != 0 && set->config->now.count == 0 && !set->config->now.mapping) {
+        ft_release_config(set); // Nothing was loaded before either
+        return rc;
+    }
+    if (rc == 0 && (!set->config->path || strcmp(set->config->path, path) != 0)) {
+        free(set->config->path);
+        set->config->path = strdup(path);
+        if (!set->config->path) {
+            perror("strdup");
+            exit(1);
+        }
+    }
+    if (rc == 0) ft_publish(set);
+    return rc == 0 ? follow_commands(set, 0) : rc;
+}
+
+int flag_load_config(const char *path) {
+    return flagset_load_config(ft_default_set(), path);
+}
+
+/**
+ * flagset_reload_config - Re-applies the loaded config file if it changed.
+ *
+ * A stat() of the path is compared with the mapped version (device, inode,
+ * size and mtime), so polling costs one system call while nothing changed,
+ * and replacing the file by rename() is always seen. Call it on a timer or
+ * when inotify reports the file's directory changed. Only flags whose
+ * lines changed are re-applied, see flagset_load_config(). Like parsing,
+ * it must not run while other threads read the set's flags, unless the set
+ * has been reloaded (readers then see the snapshot it publishes).
+ *
+ * Returns:
+ *   0 if the flags are up to date (or no config file was loaded)
+ *   FLAG_ERR_* code if the new version was rejected, the old one stays
+ */
+int flagset_reload_config(FlagSet *set) {
+    ConfigSource *c = set->config;
+    if (!c || !c->path) return 0;
+    struct stat st;
+    if (stat(c->path, &st) != 0) {
+        fprintf(stderr, "Cannot read config file %s: %s\n", c->path, strerror(errno));
+        return FLAG_ERR_CONFIG;
+    }
+    const struct stat *was = &c->now.st;
+    if (st.st_dev == was->st_dev && st.st_ino == was->st_ino && st.st_size == was->st_size &&
+        st.st_mtim.tv_sec == was->st_mtim.tv_sec && st.st_mtim.tv_nsec == was->st_mtim.tv_nsec) {
+        return 0;
+    }
+    int rc = config_update(set, c->path);
+    if (rc == 0) ft_publish(set);
+    return rc == 0 ? follow_commands(set, 1) : rc;
+}
+
+int flag_reload_config() {
+    return flagset_reload_config(ft_default_set());
+}
+
+void ft_release_config(FlagSet *set) {
+    ConfigSource *c = set->config;
+    if (!c) return;
+    version_release(&c->now);
+    free(c->state);
+    free(c->path);
+    free(c->scope);
+    free(c);
+    set->config = NULL;
+}
+
+/**
+ * ft_config_inherit - Gives the set of a command the config file of its parent.
+ *
+ * The command reads the lines whose key starts with its name and a dot
+ * (`serve.port = 8080`; `remote.add.force = yes` for a command of a
+ * command) and follows the parent's file when that is loaded again or
+ * reloaded.
+ *
+ * Returns:
+ *   0 on success, or if the parent has no config file
+ *   FLAG_ERR_* code as for flagset_load_config()
+ */
+int ft_config_inherit(FlagSet *set, const char *name) {
+    const ConfigSource *up = set->parent->config;
+    if (!up || !up->path) return 0;
+    size_t outer = up->scope ? strlen(up->scope) : 0, len = strlen(name);
+    char *scope = malloc(outer + len + 2);
+    if (!scope) {
+        perror("malloc");
+        exit(1);
+    }
+    if (outer) memcpy(scope, up->scope, outer);
+    memcpy(scope + outer, name, len);
+    memcpy(scope + outer + len, ".", 2);
+    ConfigSource *c = config_source(set);
+    free(c->scope);
+    c->scope = scope;
+    return flagset_load_config(set, up->path);
+}
@@ -0,0 +1,250 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Environment fallback: flags bound to environment variables (by name, or
+ * derived from a per-set prefix such as APP_ for --max-conns ->
+ * APP_MAX_CONNS) take their values from the environment. environ is
+ * scanned once against an index of the bound names instead of calling
+ * getenv() once per flag.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+extern char **environ;
+
+// Slot of the index of bound variable names
+typedef struct EnvSlot {
+    const char *name;   // Variable name (not terminated for derived names)
+    Flag *flag;         // Flag bound to it, NULL marks an empty slot
+    uint32_t hash;      // Low bits of ft_hash_name()
+    uint32_t len;       // Length of the name
+} EnvSlot;
+
+// Every variable name bound in a set, with a cheap filter in front
+typedef struct EnvIndex {
+    EnvSlot *slots;             // Open-addressing table, a power of two
+    size_t size;
+    char *derived;              // Names derived from the prefix, back to back
+    unsigned char first[256];   // Bytes some name starts with
+    size_t min_len, max_len;    // Shortest and longest name
+} EnvIndex;
+
+/**
+ * flag_env - Binds a flag to an environment variable.
+ *
+ * flag_apply_env() gives the flag the variable's value when it is set. The
+ * command line still wins: parsed values replace single values from the
+ * environment, and the first parsed value of a multi-instance flag drops
+ * the ones from the environment. @name must outlive the flag; an empty
+ * name opts the flag out of the set's prefix.
+ *
+ * Returns:
+ *   @flag, so the call can wrap the creator
+ */
+Flag *flag_env(Flag *flag, const char *name) {
+    if (flag->set) flag->set->info[flag->index].env_name = name;
+    return flag;
+}
+
+// Bind every flag of a set to PREFIX + its long name, upper-cased with - as _
+void flagset_env_prefix(FlagSet *set, const char *prefix) {
+    set->env_prefix = prefix;
+}
+
+void flag_env_prefix(const char *prefix) {
+    flagset_env_prefix(ft_default_set(), prefix);
+}
+
+// Long name a derived variable is built from, without its dashes
+static const char *env_base_name(const FlagInfo *info) {
+    for (int i = 0; i < info->name_count; i++) {
+        if (strncmp(info->names[i], "--", 2) == 0 && info->names[i][2]) return info->names[i] + 2;
+    }
+    const char *name = info->name_count ? info->names[0] : "";
+    while (*name == '-') name++;
+    return name;
+}
+
+static void env_index_add(EnvIndex *idx, const char *name, size_t len, Flag *flag) {
+    uint64_t h = ft_hash_name(name, len);
+    size_t mask = idx->size - 1;
+    size_t i = (size_t)h & mask;
+    while (idx->slots[i].flag) {
+        if (idx->slots[i].len == len && memcmp(idx->slots[i].name, name, len) == 0) break; // Later flag wins
+        i = (i + 1) & mask;
+    }
+    idx->slots[i] = (EnvSlot){ name, flag, (uint32_t)h, (uint32_t)len };
+    idx->first[(unsigned char)name[0]] = 1;
+    if (len < idx->min_len) idx->min_len = len;
+    if (len > idx->max_len) idx->max_len = len;
+}
+
+// Index the variable name of every bound flag, returns the number of names
+static size_t env_index_build(FlagSet *set, EnvIndex *idx) {
+    size_t prefix_len = set->env_prefix ? strlen(set->env_prefix) : 0;
+    size_t count = 0, derived_len = 0;
+    for (int i = 0; i < set->flag_count; i++) {
+        const FlagInfo *info = &set->info[i];
+        if (info->env_name) {
+            count++;
+        } else if (set->env_prefix) {
+            count++;
+            derived_len += prefix_len + strlen(env_base_name(info));
+        }
+    }
+    memset(idx, 0, sizeof(*idx));
+    if (count == 0) return 0;
+
+    idx->size = 16;
+    while (idx->size < count * 2) idx->size *= 2; // Load at most one half
+    idx->slots = calloc(idx->size, sizeof(EnvSlot));
+    idx->derived = malloc(derived_len + 1);
+    if (!idx->slots || !idx->derived) {
+        perror("malloc");
+        exit(1);
+    }
+    idx->min_len = SIZE_MAX;
+    char *w = idx->derived;
+    for (int i = 0; i < set->flag_count; i++) {
+        const FlagInfo *info = &set->info[i];
+        if (info->env_name) {
+            if (info->env_name[0]) env_index_add(idx, info->env_name, strlen(info->env_name), set->flags[i]);
+            continue;
+        }
+        if (!set->env_prefix) continue;
+        char *name = w;
+        memcpy(w, set->env_prefix, prefix_len);
+        w += prefix_len;
+        for (const char *p = env_base_name(info); *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            *w++ = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) ? (char)c : '_';
+        }
+        if (w > name) env_index_add(idx, name, (size_t)(w - name), set->flags[i]);
+    }
+    return count;
+}
+
+static Flag *env_index_find(const EnvIndex *idx, const char *name, size_t len) {
+    uint64_t h = ft_hash_name(name, len);
+    size_t mask = idx->size - 1;
+    for (size_t i = (size_t)h & mask; idx->slots[i].flag; i = (i + 1) & mask) {
+        const EnvSlot *e = &idx->slots[i];
+        if (e->hash == (uint32_t)h && e->len == len && memcmp(e->name, name, len) == 0) return e->flag;
+    }
+    return NULL;
+}
+
+// Boolean spelled in an environment variable or config file: 1 or 0, -1 if neither
+int ft_parse_bool_word(const char *value) {
+    static const char *const truthy[] = { "1", "true", "yes", "on" };
+    static const char *const falsy[] = { "", "0", "false", "no", "off" };
+    for (size_t i = 0; i < sizeof(truthy) / sizeof(truthy[0]); i++) {
+        if (strcasecmp(value, truthy[i]) == 0) return 1;
+    }
+    for (size_t i = 0; i < sizeof(falsy) / sizeof(falsy[0]); i++) {
+        if (strcasecmp(value, falsy[i]) == 0) return 0;
+    }
+    return -1;
+}
+
+// Mark a multi flag as holding environment values for the command line to replace
+static void env_mark(FlagSet *set, Flag *f) {
+    if (f->index >= set->env_capacity) {
+        int capacity = set->flag_count;
+        unsigned char *grown = ft_mem_realloc(set, set->env_pending, (size_t)set->env_capacity, (size_t)capacity);
+        memset(grown + set->env_capacity, 0, (size_t)(capacity - set->env_capacity));
+        set->env_pending = grown;
+        set->env_capacity = capacity;
+    }
+    set->env_pending[f->index] = 1;
+}
+
+// Scan environ once for the variables bound in one set
+static int apply_bound(FlagSet *set) {
+    EnvIndex idx;
+    if (env_index_build(set, &idx) == 0) return 0;
+
+    int rc = 0;
+    for (char **entry = environ; entry && *entry && !rc; entry++) {
+        const char *var = *entry;
+        if (!idx.first[(unsigned char)var[0]]) continue;
+        const char *eq = strchr(var, '=');
+        if (!eq) continue;
+        size_t len = (size_t)(eq - var);
+        if (len < idx.min_len || len > idx.max_len) continue;
+        Flag *f = env_index_find(&idx, var, len);
+        if (!f) continue;
+
+        const char *value = eq + 1;
+        if (f->type == TYPE_BOOL) {
+            int b = ft_parse_bool_word(value);
+            rc = b < 0 ? FLAG_ERR_BAD_VALUE : ft_set_value(set, f, NULL, !b, 0);
+        } else {
+            rc = ft_set_value(set, f, value, 0, 0);
+        }
+        if (rc) {
+            fprintf(stderr, "Invalid value for flag %s in %.*s\n", set->info[f->index].names[0], (int)len, var);
+        } else if (f->supports_multiple) {
+            env_mark(set, f);
+        }
+    }
+    free(idx.slots);
+    free(idx.derived);
+    return rc;
+}
+
+/**
+ * flagset_apply_env - Sets flags from the environment variables bound to them.
+ *
+ * Call after registration and before flagset_parse(), so the command line
+ * overrides the environment. environ is scanned once: each entry is
+ * filtered by its first byte and length, then looked up in a hash index
+ * of the bound names, so the cost is O(flags + environ) rather than one
+ * getenv() per flag. Values are converted like command-line values (lists
+ * are split on the flag's separator); booleans accept 1/0, true/false,
+ * yes/no and on/off in any case. Commands whose set already exists get
+ * the environment too, and the others get it when they are created.
+ *
+ * The environment is applied once per reset: later calls return 0 without
+ * touching the values, so multi-instance flags do not collect the same
+ * variables again and parsed values are not overridden.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code for the first variable that does not convert
+ */
+int flagset_apply_env(FlagSet *set) {
+    if (set->env_applied) return 0; // Already applied since the last reset
+    int rc = apply_bound(set);
+    ft_publish(set);
+    if (rc == 0) set->env_applied = 1; // Commands created from now on take it too
+    for (int i = 0; i < set->command_count && rc == 0; i++) {
+        if (set->commands[i]->set) rc = flagset_apply_env(set->commands[i]->set);
+    }
+    return rc;
+}
+
+// Apply the environment again after ft_reload_slots() put every value back
+void ft_env_reapply(FlagSet *set) {
+    apply_bound(set);
+}
+
+int flag_apply_env() {
+    return flagset_apply_env(ft_default_set());
+}
+
+void ft_release_env(FlagSet *set) {
+    ft_mem_free(set, set->env_pending);
+    set->env_pending = NULL;
+    set->env_capacity = 0;
+    set->env_applied = 0;
+}
@@ -0,0 +1,471 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Snapshot images: the parsed registry of a set written to a file that
+ * other processes map read-only instead of parsing. Everything in the file
+ * is addressed by offsets from its start, so it works at any address and
+ * every process mapping it shares the same page cache pages.
+ *
+ */
+
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+
+#include "flagtool_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IMAGE_MAGIC "FLAGIMG"   // 8 bytes including the terminator
+#define IMAGE_VERSION 2
+
+/*
+ * Layout of an image, every offset counts from the start of the file and 0
+ * means none:
+ *
+ *     ImageHeader
+ *     Flag[flag_count]         hot flag records (set and bound are NULL)
+ *     ImageValue[flag_count]   values, by flag index
+ *     ImageName[table_size]    open-addressing table of every name
+ *     uint64_t[pointer_count]  string offsets of all string multi values
+ *     numeric arrays and strings
+ *
+ * The string multi arrays have to be arrays of pointers for the getters,
+ * so the loader builds them in anonymous memory right after the mapping.
+ */
+typedef struct ImageHeader {
+    char magic[8];              // IMAGE_MAGIC
+    uint32_t version;           // IMAGE_VERSION
+    uint32_t flag_size;         // sizeof(Flag) of the writer, layouts must match
+    uint64_t size;              // Bytes in the file
+    uint64_t flag_count;        // Flag records right after the header
+    uint64_t values;            // Offset of the ImageValue array
+    uint64_t table;             // Offset of the ImageName table
+    uint64_t table_size;        // Slots in the table, a power of two
+    uint64_t pointers;          // Offset of the string offset table
+    uint64_t pointer_count;     // Entries in it (values plus NULL terminators)
+} ImageHeader;
+
+// Value of one flag, defaults already applied
+typedef struct ImageValue {
+    uint64_t scalar;            // Offset of a string value, the bits of any other value
+    uint64_t multi;             // Offset of the numeric array, or first pointer index for strings
+    int32_t count;              // Number of multi values
+    int32_t reserved;           // Zero
+} ImageValue;
+
+// Slot of the name table, keyed like the registry's hash table
+typedef struct ImageName {
+    uint32_t name;              // Offset of the name, names come before all values
+    uint32_t hash;              // Low bits of ft_hash_name()
+    uint32_t len;               // Length of the name
+    int32_t flag;               // Index of the flag, -1 marks an empty slot
+} ImageName;
+
+// Output buffer while writing, addressed by offsets since it moves as it grows
+typedef struct ImageBuffer {
+    char *data;
+    size_t len;
+    size_t cap;
+} ImageBuffer;
+
+// Append len bytes (zeros if src is NULL) at the given alignment, returns their offset
+static uint64_t image_put(ImageBuffer *b, const void *src, size_t len, size_t align) {
+    size_t at = (b->len + align - 1) & ~(align - 1);
+    if (at + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < at + len) cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown) {
+            perror("realloc");
+            exit(1);
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memset(b->data + b->len, 0, at - b->len); // Padding
+    if (src) memcpy(b->data + at, src, len);
+    else memset(b->data + at, 0, len);
+    b->len = at + len;
+    return at;
+}
+
+static uint64_t image_put_string(ImageBuffer *b, const char *s) {
+    return s ? image_put(b, s, strlen(s) + 1, 1) : 0;
+}
+
+// Offset where the loader puts the string pointer arrays, past the last file page
+static size_t image_aux_offset(const ImageHeader *h) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return ((size_t)h->size + page - 1) & ~(page - 1);
+}
+
+// Image a mapped flag record belongs to, the records follow the header
+static const ImageHeader *image_of(const Flag *f) {
+    return (const ImageHeader *)(f - f->index) - 1;
+}
+
+// Fill in the value record and name table of one image being written
+static void image_add_flag(ImageBuffer *b, FlagSet *set, const FlagValue *v, int i,
+                           uint64_t **pointers, size_t *pointer_count, size_t *pointer_cap) {
+    Flag *f = set->flags[i];
+    ImageValue value = { 0 };
+    if (f->type == TYPE_STRING) {
+        value.scalar = image_put_string(b, v->value_str ? v->value_str : f->default_str);
+    } else if (f->type == TYPE_BOOL || f->type == TYPE_INT) {
+        value.scalar = (uint32_t)v->value_int; // Same storage as the boolean value
+    } else {
+        value.scalar = v->value_uint64; // All 8 bytes of a 64-bit value
+    }
+
+    if (f->supports_multiple) {
+        value.count = v->multiple_values_count;
+        if (f->type == TYPE_STRING) {
+            if (*pointer_count + (size_t)value.count + 1 > *pointer_cap) {
+                while (*pointer_count + (size_t)value.count + 1 > *pointer_cap) *pointer_cap = *pointer_cap ? *pointer_cap * 2 : 64;
+                uint64_t *grown = realloc(*pointers, *pointer_cap * sizeof(uint64_t));
+                if (!grown) {
+                    perror("realloc");
+                    exit(1);
+                }
+                *pointers = grown;
+            }
+            value.multi = *pointer_count;
+            for (int k = 0; k < value.count; k++) {
+                (*pointers)[(*pointer_count)++] = image_put_string(b, v->multiple_str_values[k]);
+            }
+            (*pointers)[(*pointer_count)++] = 0; // NULL terminator
+        } else if (value.count) {
+            size_t elem_size = f->type == TYPE_INT ? sizeof(int) : sizeof(uint64_t);
+            value.multi = image_put(b, v->multiple_int_values, (size_t)value.count * elem_size, elem_size);
+        }
+    }
+
+    const ImageHeader *h = (const ImageHeader *)b->data;
+    memcpy(b->data + h->values + (size_t)i * sizeof(ImageValue), &value, sizeof(value));
+}
+
+/**
+ * flagset_write_image - Writes the parsed state of a set to a snapshot image.
+ *
+ * The image holds every flag, every name (including --no- aliases) and the
+ * current values with defaults applied, multi-value arrays included. Other
+ * processes map it with flagset_map_image() and read the values with no
+ * parsing at all. The file is written next to @path and renamed over it,
+ * so processes that still map an older image are not disturbed.
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero if the file could not be written
+ */
+int flagset_write_image(FlagSet *set, const char *path) {
+    ImageBuffer b = { 0 };
+    size_t n = (size_t)set->flag_count;
+
+    // Names come from the hash table, or from the frozen table once it is freed
+    const HashEntry *registry = set->hash_table;
+    size_t registry_size = set->hash_table_size, registry_used = set->hash_table_used;
+    if (!registry && set->frozen.active) {
+        registry = set->frozen.slots;
+        registry_size = registry_used = set->frozen.slot_count;
+    }
+    size_t table_size = 16;
+    while (table_size < registry_used * 2) table_size *= 2; // Load at most one half
+
+    ImageHeader header = { .magic = IMAGE_MAGIC, .version = IMAGE_VERSION, .flag_size = sizeof(Flag),
+                           .flag_count = n, .table_size = table_size };
+    image_put(&b, &header, sizeof(header), 8);
+    uint64_t flags = image_put(&b, NULL, n * sizeof(Flag), 8);
+    uint64_t values = image_put(&b, NULL, n * sizeof(ImageValue), 8);
+    uint64_t table = image_put(&b, NULL, table_size * sizeof(ImageName), 8);
+    ImageHeader *h = (ImageHeader *)b.data;
+    h->values = values;
+    h->table = table;
+
+    // Flag records keep their hot fields, pointers are meaningless in other processes
+    for (size_t i = 0; i < n; i++) {
+        Flag record = *set->flags[i];
+        record.set = NULL;
+        record.bound = NULL;
+        record.interned = 0; // The pool stays behind, values are plain strings in the image
+        if (record.type == TYPE_STRING) record.default_str = NULL; // Lives in the value
+        memcpy(b.data + flags + i * sizeof(Flag), &record, sizeof(Flag));
+    }
+
+    for (size_t i = 0; i < table_size; i++) {
+        ((ImageName *)(b.data + table))[i].flag = -1;
+    }
+    for (size_t i = 0; i < registry_size; i++) {
+        const HashEntry *e = &registry[i];
+        if (!e->flag) continue;
+        ImageName slot = { (uint32_t)image_put(&b, e->name, e->len + 1, 1), e->hash, e->len, e->flag->index };
+        ImageName *names = (ImageName *)(b.data + table);
+        size_t j = e->hash & (table_size - 1);
+        while (names[j].flag >= 0) j = (j + 1) & (table_size - 1);
+        names[j] = slot;
+    }
+
+    // Values of a reloaded set come from its published snapshot
+    uint64_t *pointers = NULL;
+    size_t pointer_count = 0, pointer_cap = 0;
+    flag_read_lock();
+    FlagValues *live = flagset_snapshot(set);
+    for (size_t i = 0; i < n; i++) {
+        const FlagValue *v = live && (int)i < live->count ? &live->slots[i] : &set->slots[i];
+        image_add_flag(&b, set, v, (int)i, &pointers, &pointer_count, &pointer_cap);
+    }
+    flag_read_unlock();
+
+    uint64_t pointer_table = image_put(&b, pointers, pointer_count * sizeof(uint64_t), 8);
+    free(pointers);
+    h = (ImageHeader *)b.data;
+    h->pointers = pointer_table;
+    h->pointer_count = pointer_count;
+    h->size = b.len;
+
+    // Write to a temporary file and rename it into place
+    size_t path_len = strlen(path);
+    char *tmp = malloc(path_len + 5);
+    if (!tmp) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", 5);
+    int rc = 1;
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        size_t done = 0;
+        while (done < b.len) {
+            ssize_t w = write(fd, b.data + done, b.len - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) break;
+            done += (size_t)w;
+        }
+        rc = close(fd) != 0 || done != b.len || rename(tmp, path) != 0;
+    }
+    if (rc) {
+        fprintf(stderr, "Cannot write flag image %s: %s\n", path, strerror(errno));
+        unlink(tmp);
+    }
+    free(tmp);
+    free(b.data);
+    return rc;
+}
+
+int flag_write_image(const char *path) {
+    return flagset_write_image(ft_default_set(), path);
+}
+
+// Check that every section of a header lies inside a file of the given size
+static int image_valid(const ImageHeader *h, size_t size) {
+    if (memcmp(h->magic, IMAGE_MAGIC, sizeof(h->magic)) != 0) return 0;
+    if (h->version != IMAGE_VERSION || h->flag_size != sizeof(Flag) || h->size != size) return 0;
+    if (h->table_size == 0 || (h->table_size & (h->table_size - 1))) return 0;
+    if ((h->values | h->table | h->pointers) % 8) return 0; // Sections are read in place
+    return h->flag_count <= (size - sizeof(*h)) / sizeof(Flag)
+        && h->values <= size && h->flag_count <= (size - h->values) / sizeof(ImageValue)
+        && h->table <= size && h->table_size <= (size - h->table) / sizeof(ImageName)
+        && h->pointers <= size && h->pointer_count <= (size - h->pointers) / sizeof(uint64_t);
+}
+
+// Whether a string offset is 0 (none) or starts a string terminated inside the file
+static int image_string_valid(const char *base, size_t size, uint64_t offset) {
+    return offset == 0 || (offset >= sizeof(ImageHeader) && offset < size
+                           && memchr(base + offset, '\0', size - (size_t)offset) != NULL);
+}
+
+/**
+ * image_contents_valid - Checks every record of a mapped image against its size.
+ *
+ * The header only bounds the sections, so a damaged or hostile file could
+ * still point a name, a string or a multi array outside the mapping, claim
+ * a flag index the image does not have, or fill the name table so that a
+ * lookup of a missing name never ends. All of that is rejected here, before
+ * anything reads through the image.
+ *
+ * Returns:
+ *   1 if the image is safe to read, 0 otherwise
+ */
+static int image_contents_valid(const char *base, const ImageHeader *h) {
+    size_t size = (size_t)h->size;
+    const Flag *flags = (const Flag *)(base + sizeof(ImageHeader));
+    const ImageValue *values = (const ImageValue *)(base + h->values);
+    const ImageName *names = (const ImageName *)(base + h->table);
+    const uint64_t *offsets = (const uint64_t *)(base + h->pointers);
+
+    for (size_t i = 0; i < h->pointer_count; i++) {
+        if (!image_string_valid(base, size, offsets[i])) return 0;
+    }
+
+    int empty = 0;
+    for (size_t i = 0; i < h->table_size; i++) {
+        const ImageName *e = &names[i];
+        if (e->flag < 0) {
+            empty = 1;
+            continue;
+        }
+        if ((uint64_t)e->flag >= h->flag_count) return 0;
+        if (e->name < sizeof(ImageHeader) || e->name >= size || e->len >= size - e->name) return 0;
+    }
+    if (!empty) return 0; // A full table never ends the probe for a missing name
+
+    for (size_t i = 0; i < h->flag_count; i++) {
+        const Flag *f = &flags[i];
+        const ImageValue *v = &values[i];
+        if (f->set || f->bound || f->index != (int)i || f->type > TYPE_DURATION || f->interned) return 0;
+        if (f->type == TYPE_STRING && (f->default_str || !image_string_valid(base, size, v->scalar))) return 0;
+        if (!f->supports_multiple) continue;
+        if (v->count < 0) return 0;
+        if (f->type == TYPE_STRING) {
+            // Pointer indices: count values, then a NULL terminator, all inside the table
+            if (v->multi > h->pointer_count || (uint64_t)v->count >= h->pointer_count - v->multi) return 0;
+            for (int32_t k = 0; k < v->count; k++) {
+                if (!offsets[v->multi + (uint64_t)k]) return 0;
+            }
+            if (offsets[v->multi + (uint64_t)v->count]) return 0;
+        } else if (v->count) {
+            size_t elem_size = f->type == TYPE_INT ? sizeof(int) : sizeof(uint64_t);
+            if (v->multi < sizeof(ImageHeader) || v->multi % elem_size || v->multi >= size
+                || (uint64_t)v->count > (size - v->multi) / elem_size) return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * flagset_map_image - Attaches a snapshot image written by flagset_write_image().
+ *
+ * The file is mapped read-only and shared, so all processes mapping the
+ * same image share its pages. Afterwards flagset_find() also answers names
+ * from the image (after the set's own flags), and the flag_get_* functions
+ * read those flags straight from the mapping. Flags found in an image are
+ * read-only: they can be queried, and the calls that would change them
+ * (parsing, binding, groups, reserve, separators, handlers, environment
+ * names, freeing) leave them alone. The mapping lives until
+ * flagset_cleanup() or the next call.
+ *
+ * Flags the set registered itself keep answering flagset_find(), so they
+ * take the image's values instead: each flag whose first name is in the
+ * image with the same type and instance kind gets a copy of its value
+ * (multi values included) now, or at registration if it comes later. A
+ * later parse stores over those values as usual, and flagset_reset()
+ * returns the flags to their defaults.
+ * Every offset and index in the file is checked before it is used, so a
+ * damaged image is rejected instead of read out of bounds.
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero if the file is missing or not an image of this build
+ */
+int flagset_map_image(FlagSet *set, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    ImageHeader h;
+    if (fd < 0 || fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)
+        || !image_valid(&h, (size_t)st.st_size)) {
+        fprintf(stderr, "Cannot map flag image %s: %s\n", path, fd < 0 ? strerror(errno) : "not a flag image");
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    // Reserve room for the file plus the pointer arrays, then map the file over the front
+    size_t aux = image_aux_offset(&h);
+    size_t len = aux + h.pointer_count * sizeof(char *);
+    char *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED || mmap(base, h.size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        fprintf(stderr, "Cannot map flag image %s: %s\n", path, strerror(errno));
+        if (base != MAP_FAILED) munmap(base, len);
+        close(fd);
+        return 1;
+    }
+    close(fd);
+    if (memcmp(base, &h, sizeof(h)) != 0 || !image_contents_valid(base, &h)) { // Header may have changed since the read
+        fprintf(stderr, "Cannot map flag image %s: damaged flag image\n", path);
+        munmap(base, len);
+        return 1;
+    }
+
+    const uint64_t *offsets = (const uint64_t *)(base + h.pointers);
+    char **strings = (char **)(base + aux);
+    for (size_t i = 0; i < h.pointer_count; i++) {
+        strings[i] = offsets[i] ? base + offsets[i] : NULL;
+    }
+
+    ft_release_image(set);
+    set->image = base;
+    set->image_len = len;
+    for (int i = 0; i < set->flag_count; i++) ft_image_adopt(set->flags[i]);
+    ft_publish(set);
+    return 0;
+}
+
+int flag_map_image(const char *path) {
+    return flagset_map_image(ft_default_set(), path);
+}
+
+// Look a name up in the image of a set, NULL if it has none
+Flag *ft_image_find(FlagSet *set, const char *name, size_t len) {
+    const char *base = set->image;
+    const ImageHeader *h = set->image;
+    const ImageName *names = (const ImageName *)(base + h->table);
+    size_t mask = h->table_size - 1;
+    uint64_t hash = ft_hash_name(name, len);
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+        const ImageName *e = &names[i];
+        if (e->flag < 0) return NULL;
+        if (e->hash == (uint32_t)hash && e->len == len && memcmp(base + e->name, name, len) == 0) {
+            return (Flag *)(h + 1) + e->flag;
+        }
+    }
+}
+
+// Give a flag registered in a set with an image the value the image holds
+// under the flag's first name, if the image has it with the same type
+void ft_image_adopt(Flag *f) {
+    const FlagInfo *info = &f->set->info[f->index];
+    if (!f->set->image || info->name_count == 0) return;
+    const Flag *g = ft_image_find(f->set, info->names[0], strlen(info->names[0]));
+    if (!g || g->type != f->type || g->supports_multiple != f->supports_multiple) return;
+    FlagValue view;
+    ft_copy_value(f, ft_image_value(g, &view));
+}
+
+// View the value of a mapped flag as a FlagValue for the shared getters
+const FlagValue *ft_image_value(const Flag *f, FlagValue *out) {
+    const ImageHeader *h = image_of(f);
+    const char *base = (const char *)h;
+    const ImageValue *v = (const ImageValue *)(base + h->values) + f->index;
+    memset(out, 0, sizeof(*out));
+    if (f->type == TYPE_STRING) {
+        out->value_str = v->scalar ? (char *)base + v->scalar : NULL;
+    } else if (f->type == TYPE_BOOL || f->type == TYPE_INT) {
+        out->value_int = (int)(uint32_t)v->scalar;
+    } else {
+        out->value_uint64 = v->scalar;
+    }
+    if (f->supports_multiple) {
+        out->multiple_values_count = v->count;
+        if (f->type == TYPE_STRING) {
+            out->multiple_str_values = (char **)(base + image_aux_offset(h)) + v->multi;
+        } else {
+            out->multiple_int_values = v->multi ? (int *)(base + v->multi) : NULL; // Any numeric array
+        }
+    }
+    return out;
+}
+
+// Unmap the image of a set being cleaned up
+void ft_release_image(FlagSet *set) {
+    if (set->image) {
+        munmap((void *)set->image, set->image_len);
+        set->image = NULL;
+        set->image_len = 0;
+    }
+}
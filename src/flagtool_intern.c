@@ -0,0 +1,207 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Interned string values: a multi-instance string flag opted in with
+ * flag_intern() keeps one copy of each distinct value in a hashed pool, and
+ * every occurrence of it is a pointer to that copy. Inputs where most
+ * values repeat (users or hosts from a log) cost memory per distinct value
+ * instead of per occurrence, and each value gets a small dense ID.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_BLOCK (16 * 1024)
+
+// Slot of the pool's hash table
+typedef struct PoolSlot {
+    const char *str;    // Pooled copy, NULL marks an empty slot
+    uint32_t hash;      // Low bits of ft_hash_name()
+    uint32_t len;       // Length of the string
+} PoolSlot;
+
+// Distinct values of one flag. Each copy is preceded by its 4-byte ID, so
+// the ID of a stored value is read without hashing it again.
+struct StringPool {
+    PoolSlot *slots;        // Open-addressing table, a power of two
+    size_t size;
+    const char **by_id;     // Copies in order of first appearance
+    uint32_t count;         // Distinct values, the next ID
+    uint32_t capacity;      // Room in by_id
+    Arena strings;          // Copies with their ID in front
+};
+
+static StringPool *pool_new() {
+    StringPool *pool = calloc(1, sizeof(StringPool));
+    if (!pool) {
+        perror("calloc");
+        exit(1);
+    }
+    pool->strings.block_size = POOL_BLOCK;
+    return pool;
+}
+
+/**
+ * flag_intern - Stores one copy of each distinct value of a string multi flag.
+ *
+ * Repeated values become pointers to the first copy, so
+ * flag_get_string_multi() may return the same pointer several times and
+ * the IDs of flag_get_string_id() tell values apart without comparing
+ * strings. Values still parsed into records (flag_parse_values) are plain
+ * copies. Ignored for other flag types. Must be called before the flag
+ * has values: the values already stored are plain copies without an ID,
+ * so a flag that has any stays as it is.
+ *
+ * Returns:
+ *   @flag, so the call can wrap the creator
+ */
+Flag *flag_intern(Flag *flag) {
+    if (!flag->set || !flag->supports_multiple || flag->type != TYPE_STRING || flag->interned) return flag;
+    if (flag->set->slots[flag->index].multiple_values_count) {
+        fprintf(stderr, "flag_intern must be called before the flag has values\n");
+        return flag;
+    }
+    flag->set->info[flag->index].pool = pool_new();
+    flag->interned = 1;
+    return flag;
+}
+
+static inline uint32_t string_id(const char *s) {
+    uint32_t id;
+    memcpy(&id, s - sizeof(uint32_t), sizeof(id));
+    return id;
+}
+
+// Slot holding a value, or the empty slot where it would go
+static PoolSlot *pool_find(const StringPool *pool, const char *s, size_t len, uint64_t h) {
+    size_t mask = pool->size - 1;
+    size_t i = (size_t)h & mask;
+    for (; pool->slots[i].str; i = (i + 1) & mask) {
+        const PoolSlot *e = &pool->slots[i];
+        if (e->hash == (uint32_t)h && e->len == len && memcmp(e->str, s, len) == 0) break;
+    }
+    return &pool->slots[i];
+}
+
+// Double the table, rehashing from the stored hashes
+static void pool_grow(StringPool *pool) {
+    size_t size = pool->size ? pool->size * 2 : 64;
+    PoolSlot *slots = calloc(size, sizeof(PoolSlot));
+    if (!slots) {
+        perror("calloc");
+        exit(1);
+    }
+    for (size_t i = 0; i < pool->size; i++) {
+        if (!pool->slots[i].str) continue;
+        size_t j = pool->slots[i].hash & (size - 1);
+        while (slots[j].str) j = (j + 1) & (size - 1);
+        slots[j] = pool->slots[i];
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->size = size;
+}
+
+/**
+ * ft_intern - Returns the pooled copy of a value, adding it if it is new.
+ *
+ * @s need not be terminated, @len bytes of it are the value.
+ *
+ * Returns:
+ *   Terminated copy shared by every occurrence of the value
+ */
+char *ft_intern(Flag *f, const char *s, size_t len) {
+    StringPool *pool = f->set->info[f->index].pool;
+    if ((size_t)pool->count * 2 >= pool->size) pool_grow(pool); // Load at most one half
+    uint64_t h = ft_hash_name(s, len);
+    PoolSlot *slot = pool_find(pool, s, len, h);
+    if (slot->str) return (char *)slot->str;
+
+    if (pool->count == pool->capacity) {
+        uint32_t capacity = pool->capacity ? pool->capacity * 2 : 64;
+        const char **grown = realloc(pool->by_id, (size_t)capacity * sizeof(char *));
+        if (!grown) {
+            perror("realloc");
+            exit(1);
+        }
+        pool->by_id = grown;
+        pool->capacity = capacity;
+    }
+    uint32_t id = pool->count++;
+    char *copy = (char *)ft_arena_alloc(&pool->strings, sizeof(id) + len + 1) + sizeof(id);
+    memcpy(copy - sizeof(id), &id, sizeof(id));
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    *slot = (PoolSlot){ copy, (uint32_t)h, (uint32_t)len };
+    pool->by_id[id] = copy;
+    return copy;
+}
+
+// Number of distinct values stored, -1 if the flag is not interned
+int flag_get_distinct_count(Flag *flag) {
+    return flag->interned ? (int)flag->set->info[flag->index].pool->count : -1;
+}
+
+/**
+ * flag_get_string_id - ID of one value of an interned flag.
+ *
+ * IDs count distinct values from 0 in order of first appearance, so equal
+ * values have equal IDs and they index a table of flag_get_distinct_count()
+ * entries. Value @i is the one flag_get_string_multi() returns: once the
+ * set has been reloaded it comes from the published snapshot, whose
+ * copies carry their ID in front like the pooled ones.
+ *
+ * Returns:
+ *   ID of value @i, or -1 if the flag is not interned or has no such value
+ */
+int flag_get_string_id(Flag *flag, int i) {
+    if (!flag->interned) return -1;
+    FlagSet *set = flag->set;
+    if (!atomic_load_explicit(&set->live, memory_order_relaxed)) {
+        const FlagValue *v = &set->slots[flag->index]; // Every value is a pooled copy
+        if (i < 0 || i >= v->multiple_values_count) return -1;
+        return (int)string_id(v->multiple_str_values[i]);
+    }
+
+    int id = -1;
+    flag_read_lock();
+    const FlagValues *live = flagset_snapshot(set);
+    if (flag->index < live->count) {
+        const FlagValue *v = &live->slots[flag->index];
+        if (i >= 0 && i < v->multiple_values_count) id = (int)string_id(v->multiple_str_values[i]);
+    }
+    flag_read_unlock();
+    return id;
+}
+
+// Value with a given ID, NULL if no value has it
+const char *flag_get_distinct_string(Flag *flag, int id) {
+    if (!flag->interned) return NULL;
+    const StringPool *pool = flag->set->info[flag->index].pool;
+    return id >= 0 && (uint32_t)id < pool->count ? pool->by_id[id] : NULL;
+}
+
+// Forget every value but keep the table, the ID array and a block of copies
+void ft_reset_pool(FlagInfo *info) {
+    StringPool *pool = info->pool;
+    if (pool->count) memset(pool->slots, 0, pool->size * sizeof(PoolSlot));
+    pool->count = 0;
+    ft_arena_rewind(&pool->strings);
+}
+
+void ft_release_pool(FlagInfo *info) {
+    StringPool *pool = info->pool;
+    if (!pool) return;
+    ft_arena_release(&pool->strings);
+    free(pool->slots);
+    free(pool->by_id);
+    free(pool);
+    info->pool = NULL;
+}
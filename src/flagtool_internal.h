@@ -0,0 +1,431 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Internal structures shared by the library sources, not installed.
+ *
+ */
+
+#ifndef FLAGTOOL_INTERNAL_H
+#define FLAGTOOL_INTERNAL_H
+
+#include "flagtool.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef FLAGTOOL_STATS
+#include <time.h>
+#endif
+
+// Enum for flag types
+typedef enum {
+    TYPE_STRING, TYPE_BOOL, TYPE_INT,
+    TYPE_INT64, TYPE_UINT64, TYPE_DOUBLE, TYPE_SIZE, TYPE_DURATION
+} FlagType;
+
+// Constants for the registry and maximum flag names
+#define HASH_TABLE_MIN_SIZE 16      // Initial slot count, always a power of two
+#define HASH_TABLE_MAX_LOAD 70      // Rehash once this percentage of slots is used
+#define MAX_FLAG_NAMES 10
+#define MULTI_MIN_CAPACITY 8        // First allocation of a multi-instance array
+#define FLAG_STORE_MIN_FLAGS 32     // Flags in the first block of a set's flag store
+
+// Slot of the open-addressing hash table, the key is stored with its hash
+typedef struct HashEntry {
+    const char *name;       // Flag name
+    Flag *flag;             // Flag owning the name (NULL marks an empty slot)
+    uint32_t hash;          // Low bits of the name hash, checked before the key
+    uint32_t len : 31;      // Length of the name
+    uint32_t negated : 1;   // Generated --no- alias of a boolean flag
+} HashEntry;
+
+// Parsed value of one flag, kept apart from the flag so a read-only registry
+// can parse into many independent records (see FlagValues)
+typedef struct FlagValue {
+    union {                             // Current value, by flag type
+        char *value_str;                // String value (NULL until set)
+        int value_bool;                 // Boolean value
+        int value_int;                  // Integer value
+        int64_t value_int64;            // 64-bit or duration (ns) value
+        uint64_t value_uint64;          // Unsigned or size (bytes) value, also the whole scalar
+        double value_double;            // Floating-point value
+    };
+    union {                             // Multi values, grown geometrically
+        char **multiple_str_values;     // NULL-terminated string values
+        int *multiple_int_values;       // Int values (no NULL for int)
+        int64_t *multiple_int64_values; // 64-bit or duration values
+        uint64_t *multiple_uint64_values; // Unsigned or size values
+        double *multiple_double_values; // Floating-point values
+    };
+    int multiple_values_count;          // Number of multi values
+    int multiple_capacity;              // Elements the multi array has room for
+} FlagValue;
+
+// Hot part of a flag: everything matching a name and storing a value reads.
+// Flags are packed side by side in their set, their values sit in the set's
+// slot column and the rest in its cold FlagInfo column, all by index.
+struct Flag {
+    FlagSet *set;                       // Set the flag is registered in
+    void *bound;                        // Variable written on parse (flag_*_var), or NULL
+    union {                             // Default value, by flag type
+        const char *default_str;        // Default string value
+        int default_bool;               // Default boolean value
+        int default_int;                // Default integer value
+        int64_t default_int64;          // Default 64-bit or duration value
+        uint64_t default_uint64;        // Default unsigned or size value, also the whole scalar
+        double default_double;          // Default floating-point value
+    };
+    int index;                          // Registration index within the set
+    unsigned char type;                 // Type of the flag (FlagType)
+    unsigned char supports_multiple;    // Flag to indicate if multiple instances allowed
+    char separator;                     // Splits each value into a list (0 for none)
+    unsigned char has_handler : 1;      // Values go to the handler in FlagInfo (flag_on_*)
+    unsigned char interned : 1;         // String values are pooled in FlagInfo (flag_intern)
+};
+
+typedef struct StringPool StringPool;
+
+// Cold part of a flag, only read by registration, usage and error messages
+typedef struct FlagInfo {
+    const char *names[MAX_FLAG_NAMES];  // Array of flag names
+    int name_count;                     // Number of names
+    int multiple_reserve;               // Expected number of instances (flag_reserve)
+    const char *help;                   // Help description
+    FlagGroup *group;                   // Pointer to flag group
+    union {                             // Receives each value instead of the slot
+        FlagStringHandler on_string;    // String multi flags
+        FlagIntHandler on_int;          // Int multi flags
+    };
+    void *handler_ctx;                  // Passed to the handler
+    const char *env_name;               // Environment variable given by flag_env(), or NULL
+    StringPool *pool;                   // Distinct string values (flagtool_intern.c), or NULL
+} FlagInfo;
+
+// Structure representing a flag group
+typedef struct FlagGroup {
+    const char *name; // Name of flag group
+    Flag **flags; // Flag in group
+    int flag_count; // Number of flags in group
+    int flag_capacity; // Room in flags before it has to grow
+    FlagSet *set; // Set the group belongs to
+} FlagGroup;
+
+// Frozen lookup table built by flagset_freeze(): a minimal perfect hash
+// (hash-and-displace) mapping every distinct name to exactly one slot
+typedef struct FrozenTable {
+    HashEntry *slots;       // One slot per distinct name
+    uint32_t *disp;         // Displacement per bucket, mixed into the slot hash
+    size_t slot_count;      // Number of slots (== number of distinct names)
+    size_t bucket_count;    // Number of displacement buckets
+    uint64_t seed;          // Seed the table was built with
+    int active;             // Nonzero while lookups go through the table
+} FrozenTable;
+
+// Block of an internally allocated arena
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;    // Previously filled block
+    size_t size;                // Usable bytes in data
+    max_align_t data[];         // Allocations are carved from here
+} ArenaBlock;
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+// Bump allocator handing out memory from a few large blocks
+typedef struct Arena {
+    char *user_buf;         // Caller supplied first block (never freed)
+    size_t user_size;       // Size of the caller supplied block
+    ArenaBlock *blocks;     // Blocks allocated by the arena, newest first
+    size_t block_size;      // Size of the next block to allocate
+    size_t initial_block;   // block_size before the first block, restored on release
+    char *cur;              // Next free byte of the current block
+    char *end;              // End of the current block
+} Arena;
+
+// Memory-mapped response file, kept alive while values point into it
+typedef struct FlagMapping {
+    struct FlagMapping *next;   // Mapping made before this one
+    void *addr;                 // Start of the mapping
+    size_t len;                 // Length of the mapping
+} FlagMapping;
+
+#ifdef FLAGTOOL_STATS
+// Counters of a set, named like the FlagStats fields they fill
+#define FT_STAT_COUNTERS(X) \
+    X(finds) X(find_hits) X(probes) X(compares) \
+    X(allocs) X(alloc_bytes) X(frees) \
+    X(registrations) X(register_ns) \
+    X(parses) X(parsed_args) X(parse_ns) \
+    X(freeze_ns) X(reset_ns) X(cleanup_ns)
+
+// Bumped with relaxed atomics so concurrent flag_parse_values() calls
+// against one schema can count too
+typedef struct FlagSetStats {
+#define FT_STAT_DECLARE(name) _Atomic uint64_t name;
+    FT_STAT_COUNTERS(FT_STAT_DECLARE)
+#undef FT_STAT_DECLARE
+} FlagSetStats;
+
+static inline uint64_t ft_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Instrumentation hooks, compiled out entirely without FLAGTOOL_STATS
+#define FT_STAT_ADD(set, field, n) \
+    atomic_fetch_add_explicit(&(set)->stats.field, (uint64_t)(n), memory_order_relaxed)
+#define FT_STAT_CLOCK(var) uint64_t var = ft_clock_ns()
+#define FT_STAT_ELAPSED(set, field, var) FT_STAT_ADD(set, field, ft_clock_ns() - (var))
+#define FT_STAT_FIND(set, name, len, hit) count_find(set, name, len, hit)
+#else
+#define FT_STAT_ADD(set, field, n) ((void)0)
+#define FT_STAT_CLOCK(var) ((void)0)
+#define FT_STAT_ELAPSED(set, field, var) ((void)0)
+#define FT_STAT_FIND(set, name, len, hit) ((void)0)
+#endif
+
+// Registered names in bytewise order for prefix queries (flagtool_complete.c)
+typedef struct PrefixIndex {
+    size_t count;           // Number of names
+    HashEntry entries[];    // Copies of the live hash table entries, sorted
+} PrefixIndex;
+
+// Subcommand of a set, its flags are registered when it is first invoked
+struct FlagCommand {
+    const char *name;           // Word selecting the command
+    const char *help;           // Help description
+    FlagCommandInit init;       // Registers the command's flags
+    void *ctx;                  // Passed to init
+    FlagSet *parent;            // Set the command belongs to
+    FlagSet *set;               // Flags of the command, NULL until invoked
+};
+
+// Structure owning a registry and its parsed values
+struct FlagSet {
+    HashEntry *hash_table;      // Open-addressing table (linear probing, grows by doubling)
+    size_t hash_table_size;     // Number of slots
+    size_t hash_table_used;     // Number of occupied slots
+    FrozenTable frozen;         // Perfect hash built by flagset_freeze()
+
+    Flag **flags;               // Array to store registered flags
+    FlagValue *slots;           // Values parsed by flag_parse(), by registration index
+    FlagInfo *info;             // Cold data of the flags, by registration index
+    int flag_count;             // Count of registered flags
+    int flag_capacity;          // Room in flags, slots and info
+    Arena flag_store;           // Flags themselves, packed in registration order
+    FlagGroup **groups;         // Registered groups
+    int group_count;
+    int group_capacity;
+
+    int use_arena;              // Registry allocations come from arena
+    Arena arena;                // Opt-in arena (see flagset_use_arena)
+    Arena values;               // Copies of parsed strings, rewound by flagset_reset()
+    FlagMapping *mappings;      // Response files the values point into
+    _Atomic(FlagValues *) live; // Snapshot published by flagset_reload(), read by the getters
+    FlagValues *retired;        // Superseded snapshots a pointer escaped from, freed by cleanup
+    const void *image;          // Snapshot image mapped by flagset_map_image(), or NULL
+    size_t image_len;           // Length of that mapping
+    const char *env_prefix;     // Prefix of derived variable names (flagset_env_prefix)
+    unsigned char *env_pending; // Multi flags holding environment values, by index
+    int env_capacity;           // Entries in env_pending
+    int env_applied;            // flagset_apply_env() ran since the last reset, commands follow
+    _Atomic(PrefixIndex *) prefix; // Sorted names, built by the first prefix query
+    int abbrev;                 // Unique prefixes of --names are accepted (flagset_allow_abbrev)
+    FlagSet *parent;            // Set of the command owning this one, whose flags are inherited
+    FlagCommand **commands;     // Subcommands (flagset_command)
+    int command_count;
+    int command_capacity;
+    FlagCommand *active;        // Subcommand the last parse dispatched to, or NULL
+    unsigned generation;        // Bumped by every registration, invalidates the usage cache
+    struct UsageCache *usage;   // Rendered usage (flagtool_usage.c), or NULL
+    struct ConfigSource *config; // Config file layer (flagtool_config.c), or NULL
+#ifdef FLAGTOOL_STATS
+    FlagSetStats stats;         // Counters reported by flagset_stats()
+#endif
+};
+
+// Values of every flag of a schema for one parsed command line
+struct FlagValues {
+    FlagSet *schema;            // Set the record was created for
+    int count;                  // Number of slots (flags registered at creation)
+    int error;                  // Result of the last parse into the record
+    Arena strings;              // Copies of parsed strings
+    FlagMapping *mappings;      // Response files the values point into
+    unsigned char *seen;        // Flags the parse stored, by index (flagset_reload() only), or NULL
+    atomic_int escaped;         // A pointer into the record left a read section, keep it
+    FlagValues *retired;        // Next superseded snapshot kept by the set
+    FlagValue slots[];          // One slot per flag, by registration index
+};
+
+// Arena entry points for the other translation units
+void *ft_arena_alloc(Arena *a, size_t size);
+void ft_arena_rewind(Arena *a);
+void ft_arena_release(Arena *a);
+
+// Registry allocator of a set (its arena if enabled, counted in its stats)
+void *ft_mem_calloc(FlagSet *set, size_t count, size_t size);
+void *ft_mem_realloc(FlagSet *set, void *ptr, size_t old_size, size_t new_size);
+void ft_mem_free(FlagSet *set, void *ptr);
+
+// Maximum nesting of @file arguments inside response files
+#define MAX_RESPONSE_DEPTH 16
+
+// Parse loop shared by every entry point, starts at argv[first]
+int ft_parse_args(FlagSet *set, FlagValues *out, int argc, char *argv[], int first, int borrow, int depth);
+
+// Single steps of that loop for the streaming parser (flagtool_stream.c)
+const HashEntry *ft_find_entry(FlagSet *set, const char *name, size_t len, int *ambiguous);
+int ft_set_value(FlagSet *set, Flag *f, const char *val, int negated, int borrow);
+
+// borrow value for writable values that outlive the flag's (a config
+// mapping): string lists are split in place instead of copied
+#define FT_BORROW_SPLIT 2
+
+// Expand one @file argument and parse its tokens (flagtool_respfile.c),
+// threads > 1 parses them with ft_parse_parallel()
+int ft_parse_response_file(FlagSet *set, FlagValues *out, const char *path, int depth, int threads);
+// Map a file privately with one writable byte after its end, st receives its status
+struct stat;
+FlagMapping *ft_map_file(const char *path, struct stat *st);
+
+// Chunked parallel form of ft_parse_args() into the set itself (flagtool_parallel.c)
+int ft_parse_parallel(FlagSet *set, int argc, char *argv[], int first, int borrow, int depth, int threads);
+// Chunk and merge steps: store into a record, apply a record value to its flag,
+// keep a record's strings alive in the set
+int ft_record_value(FlagValues *out, Flag *f, const char *val, int negated, int borrow);
+void ft_merge_value(Flag *f, const FlagValue *from);
+void ft_copy_value(Flag *f, const FlagValue *from);
+void ft_adopt_strings(FlagSet *set, FlagValues *values);
+void ft_release_mappings(FlagMapping **mappings);
+
+// Hash the registry table slots a name by (low bits pick the slot)
+uint64_t ft_hash_name(const char *name, size_t len);
+
+// Set behind the flag_* functions
+FlagSet *ft_default_set();
+
+// Prefix queries (flagtool_complete.c): abbreviated --names, the index is
+// dropped whenever a name changes
+const HashEntry *ft_find_abbrev(FlagSet *set, const char *name, size_t len, int *ambiguous);
+void ft_release_prefix(FlagSet *set);
+
+// Subcommands (flagtool_command.c): the parse loop hands the arguments after
+// a command's name to the command's set, created on first use
+FlagCommand *ft_find_command(FlagSet *set, const char *name);
+int ft_parse_command(FlagSet *set, FlagCommand *cmd, int argc, char *argv[], int first, int borrow);
+FlagSet *ft_command_set(FlagCommand *cmd);
+void ft_reset_commands(FlagSet *set);
+void ft_release_commands(FlagSet *set);
+
+// Usage output (flagtool_usage.c)
+typedef struct UsageCache UsageCache;
+void ft_release_usage(FlagSet *set);
+
+// Hot reload (flagtool_reload.c): once a set has been reloaded, every
+// change to its values is published as a fresh copy (ft_values_copy()),
+// which also writes the bound variables; a parse publishes the command
+// it dispatched to as well
+void ft_publish(FlagSet *set);
+void ft_publish_parse(FlagSet *set);
+void ft_escape(FlagValues *values);
+void ft_release_live(FlagSet *set);
+FlagValues *ft_values_copy(FlagSet *set);
+int ft_write_bound_values(const FlagValues *values);
+void ft_reload_slots(FlagSet *set, FlagValues *argv_values);
+void ft_config_reapply(FlagSet *set);
+void ft_env_reapply(FlagSet *set);
+
+// Environment fallback (flagtool_env.c): the command line replaces the
+// environment values of a multi flag instead of appending to them
+static inline void ft_drop_env_values(FlagSet *set, Flag *f, FlagValue *v) {
+    if (!set->env_pending || f->index >= set->env_capacity || !set->env_pending[f->index]) return;
+    set->env_pending[f->index] = 0;
+    v->multiple_values_count = 0;
+    if (f->type == TYPE_STRING && v->multiple_capacity) v->multiple_str_values[0] = NULL;
+}
+void ft_release_env(FlagSet *set);
+
+// Config file layer (flagtool_config.c): exact name lookup, booleans spelled
+// as words, a flag stored by any other layer is claimed and left alone by
+// reloads, and reloads put changed flags back to their default first
+const HashEntry *ft_find_name(FlagSet *set, const char *name, size_t len);
+int ft_parse_bool_word(const char *value);
+void ft_config_claim(FlagSet *set, Flag *f, FlagValue *v);
+void ft_reset_flag(Flag *f);
+void ft_write_bound(Flag *f);
+void ft_release_config(FlagSet *set);
+// Apply the parent's config file to a command's set, its `name.key` lines
+int ft_config_inherit(FlagSet *set, const char *name);
+
+// Interned string values (flagtool_intern.c): one copy per distinct value
+char *ft_intern(Flag *f, const char *s, size_t len);
+void ft_reset_pool(FlagInfo *info);
+void ft_release_pool(FlagInfo *info);
+
+// Snapshot images (flagtool_image.c), mapped flags have no set; registered
+// flags of a set with an image take its values
+Flag *ft_image_find(FlagSet *set, const char *name, size_t len);
+void ft_image_adopt(Flag *f);
+const FlagValue *ft_image_value(const Flag *f, FlagValue *out);
+void ft_release_image(FlagSet *set);
+
+// Delimited int lists (flagtool_intlist.c), out holds (len + 1) / 2 values
+int ft_parse_int_list(const char *s, size_t len, char sep, int *out);
+
+// Numbers of every numeric flag type (flagtool_number.c), [s, end) needs no
+// terminator. Return 0, FLAG_ERR_BAD_VALUE or FLAG_ERR_OUT_OF_RANGE.
+typedef union FlagNumber {
+    int i;                  // TYPE_INT
+    int64_t i64;            // TYPE_INT64, TYPE_DURATION (nanoseconds)
+    uint64_t u64;           // TYPE_UINT64, TYPE_SIZE (bytes)
+    double d;               // TYPE_DOUBLE
+} FlagNumber;
+
+int ft_parse_number(int type, const char *s, const char *end, FlagNumber *out);
+int ft_parse_int64(const char *s, const char *end, int64_t *out);
+int ft_parse_uint64(const char *s, const char *end, uint64_t *out);
+int ft_parse_double(const char *s, const char *end, double *out);
+int ft_parse_size(const char *s, const char *end, uint64_t *out);
+int ft_parse_duration(const char *s, const char *end, int64_t *out);
+// Shortest exact spelling with a unit suffix, for usage output
+void ft_format_size(uint64_t bytes, char *buf, size_t size);
+void ft_format_duration(int64_t ns, char *buf, size_t size);
+
+// SWAR digit conversion shared by the int list and number parsers
+static inline uint64_t ft_load64(const char *p) {
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x; // Little-endian: p[0] in the low byte
+}
+
+/**
+ * ft_eight_digits - Converts the first n (1..8) bytes at p, eight bytes readable.
+ *
+ * The digits are shifted into the top of the register so the missing
+ * leading positions read as zeros, then combined pairwise (x10, x100,
+ * x10000) with three multiplies instead of one per digit.
+ *
+ * Returns:
+ *   0 if all n bytes are digits (value in *out)
+ *   -1 otherwise
+ */
+static inline int ft_eight_digits(const char *p, size_t n, uint64_t *out) {
+    uint64_t raw = ft_load64(p);
+    uint64_t keep = n == 8 ? ~0ULL : (1ULL << (8 * n)) - 1;
+    uint64_t x = (raw & keep) | (0x3030303030303030ULL & ~keep); // Pad with '0'
+    if ((((x & 0xF0F0F0F0F0F0F0F0ULL) | (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))) != 0x3333333333333333ULL) {
+        return -1; // Some byte outside '0'..'9'
+    }
+    x = (x - 0x3030303030303030ULL) << (8 * (8 - n));
+    x = (x * 10) + (x >> 8);
+    x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    *out = x;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Delimited int lists (--ids=1,2,3): separators are located and characters
+ * validated 64 bytes at a time with SSE2 or AVX2, and each value is
+ * converted eight digits at a time inside a 64-bit register.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define FT_HAVE_X86 1
+#endif
+
+// Map 64 bytes to a mask of separators, returns the mask of invalid bytes
+typedef uint64_t (*ScanFn)(const char *p, char sep, uint64_t *seps);
+
+#ifndef FT_HAVE_X86
+static uint64_t scan64_scalar(const char *p, char sep, uint64_t *seps) {
+    uint64_t s = 0, bad = 0;
+    for (int i = 0; i < 64; i++) {
+        char c = p[i];
+        s |= (uint64_t)(c == sep) << i;
+        bad |= (uint64_t)(c != sep && c != '-' && c != '+' && (unsigned char)(c - '0') > 9) << i;
+    }
+    *seps = s;
+    return bad;
+}
+#endif
+
+#ifdef FT_HAVE_X86
+// Bytes of one vector that are digits, a sign or the separator (bitmask)
+static inline uint32_t classify_sse2(__m128i x, __m128i vsep, uint32_t *seps) {
+    __m128i d = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+    __m128i digit = _mm_cmpeq_epi8(_mm_max_epu8(d, _mm_set1_epi8(9)), _mm_set1_epi8(9));
+    __m128i sep = _mm_cmpeq_epi8(x, vsep);
+    __m128i sign = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('-')), _mm_cmpeq_epi8(x, _mm_set1_epi8('+')));
+    *seps = (uint32_t)_mm_movemask_epi8(sep);
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(digit, sep), sign));
+}
+
+static uint64_t scan64_sse2(const char *p, char sep, uint64_t *seps) {
+    __m128i vsep = _mm_set1_epi8(sep);
+    uint64_t s = 0, valid = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t chunk_seps;
+        uint32_t ok = classify_sse2(_mm_loadu_si128((const __m128i *)(p + 16 * i)), vsep, &chunk_seps);
+        s |= (uint64_t)chunk_seps << (16 * i);
+        valid |= (uint64_t)ok << (16 * i);
+    }
+    *seps = s;
+    return ~valid;
+}
+
+__attribute__((target("avx2")))
+static uint64_t scan64_avx2(const char *p, char sep, uint64_t *seps) {
+    __m256i vsep = _mm256_set1_epi8(sep);
+    __m256i zero = _mm256_set1_epi8('0'), nine = _mm256_set1_epi8(9);
+    __m256i minus = _mm256_set1_epi8('-'), plus = _mm256_set1_epi8('+');
+    uint64_t s = 0, valid = 0;
+    for (int i = 0; i < 2; i++) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + 32 * i));
+        __m256i d = _mm256_sub_epi8(x, zero);
+        __m256i digit = _mm256_cmpeq_epi8(_mm256_max_epu8(d, nine), nine);
+        __m256i is_sep = _mm256_cmpeq_epi8(x, vsep);
+        __m256i sign = _mm256_or_si256(_mm256_cmpeq_epi8(x, minus), _mm256_cmpeq_epi8(x, plus));
+        __m256i ok = _mm256_or_si256(_mm256_or_si256(digit, is_sep), sign);
+        s |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_sep) << (32 * i);
+        valid |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ok) << (32 * i);
+    }
+    *seps = s;
+    return ~valid;
+}
+#endif
+
+// Pick the widest scanner the CPU supports
+static ScanFn select_scan() {
+#ifdef FT_HAVE_X86
+    if (__builtin_cpu_supports("avx2")) return scan64_avx2;
+    return scan64_sse2; // Always available on x86-64
+#else
+    return scan64_scalar;
+#endif
+}
+
+// Convert one list element p[0..n) to an int, limit bounds the readable bytes
+static inline int convert(const char *p, size_t n, const char *limit, int *out) {
+    const char *s = p, *end = p + n;
+    int negative = 0;
+    if (n && *p == '-') {
+        negative = 1;
+        p++;
+        n--;
+    }
+    if (n == 0) return -1; // Empty element
+    if (*p == '+' || *p == '-' || n > 10) { // Rare forms ('+', leading zeros) convert like a single value
+        FlagNumber num;
+        if (ft_parse_number(TYPE_INT, s, end, &num) != 0) return -1;
+        *out = num.i;
+        return 0;
+    }
+
+    uint64_t v = 0;
+    if (p + 8 <= limit) {
+        if (n <= 8) {
+            if (ft_eight_digits(p, n, &v) != 0) return -1;
+        } else {
+            uint64_t hi, lo;
+            if (ft_eight_digits(p, n - 8, &hi) != 0 || ft_eight_digits(p + n - 8, 8, &lo) != 0) return -1;
+            v = hi * 100000000ULL + lo;
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) { // Too close to the end for a full load
+            if ((unsigned char)(p[i] - '0') > 9) return -1;
+            v = v * 10 + (uint64_t)(p[i] - '0');
+        }
+    }
+    if (v > (negative ? (uint64_t)INT_MAX + 1 : (uint64_t)INT_MAX)) return -1; // Overflow
+    *out = (int)(negative ? -(int64_t)v : (int64_t)v);
+    return 0;
+}
+
+/**
+ * ft_parse_int_list - Parses a separated list of ints into out.
+ *
+ * @out must have room for (len + 1) / 2 values, the most a list of @len
+ * bytes can hold. Elements follow the rules of a single int value
+ * (ft_parse_number): an optional sign, then decimal digits, leading zeros
+ * allowed; empty elements, other characters and values outside int are
+ * rejected.
+ *
+ * Returns:
+ *   number of values stored
+ *   -1 on a malformed list (out may have been partially written)
+ */
+int ft_parse_int_list(const char *s, size_t len, char sep, int *out) {
+    const char *limit = s + len;
+    size_t start = 0, pos = 0;
+    int count = 0;
+
+    ScanFn scan = select_scan();
+    for (; pos + 64 <= len; pos += 64) {
+        uint64_t seps;
+        if (scan(s + pos, sep, &seps)) return -1; // Invalid character in this block
+        while (seps) {
+            size_t end = pos + (size_t)__builtin_ctzll(seps);
+            if (convert(s + start, end - start, limit, &out[count++]) != 0) return -1;
+            start = end + 1;
+            seps &= seps - 1; // Next separator
+        }
+    }
+    for (; pos < len; pos++) { // Tail shorter than a block
+        if (s[pos] != sep) continue;
+        if (convert(s + start, pos - start, limit, &out[count++]) != 0) return -1;
+        start = pos + 1;
+    }
+    if (convert(s + start, len - start, limit, &out[count++]) != 0) return -1;
+    return count;
+}
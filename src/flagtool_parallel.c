@@ -0,0 +1,303 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Parallel parse of one very long command line: argv is looked up in
+ * parallel, split into chunks that start on whole flags, each chunk is
+ * parsed into its own value record on a worker, and the records are merged
+ * into the set in argument order. The result is exactly what flag_parse()
+ * would have produced, errors included.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PARALLEL_MIN_CHUNK 4096     // Fewest arguments worth a chunk (and a thread) of their own
+#define PARALLEL_LOOKUP_RANGE 16384 // Arguments looked up per lookup job
+
+// Marks an @file argument in the lookup results
+static const HashEntry response_file_entry;
+
+// Arguments [first, last) parsed into one record, always whole flags
+typedef struct ParallelChunk {
+    int first;
+    int last;
+    FlagValues *values;     // Record the chunk parses into
+    unsigned char *seen;    // Flags the chunk stored a value for, by index
+    int error;              // Result of parsing the chunk
+} ParallelChunk;
+
+// State shared by the workers of one parallel parse
+typedef struct ParallelJob {
+    FlagSet *set;
+    int argc;
+    char **argv;
+    int first;                  // First argument to parse
+    int borrow;                 // Strings point into argv instead of being copied
+    int depth;                  // Response file nesting
+    int threads;                // Workers per phase
+    const HashEntry **entries;  // Lookup of every argument from first on
+    ParallelChunk *chunks;      // Chunks of the segment being parsed
+    int chunk_count;
+    void (*step)(struct ParallelJob *, int); // Work of the current phase
+    int steps;                  // Number of steps in the current phase
+    atomic_int next;            // Next unclaimed step
+} ParallelJob;
+
+// A flag named by arg (through entry e) takes the next argument as its value
+static inline int takes_next(const HashEntry *e, const char *arg) {
+    return arg[e->len] != '=' && e->flag->type != TYPE_BOOL;
+}
+
+static void *parallel_worker(void *arg) {
+    ParallelJob *job = arg;
+    int step;
+    while ((step = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->steps) {
+        job->step(job, step);
+    }
+    return NULL;
+}
+
+// Run steps [0, steps) of a phase on up to job->threads threads, the caller included
+static void run_phase(ParallelJob *job, void (*step)(ParallelJob *, int), int steps) {
+    job->step = step;
+    job->steps = steps;
+    atomic_store(&job->next, 0);
+    int threads = job->threads < steps ? job->threads : steps;
+    pthread_t *workers = malloc((size_t)threads * sizeof(pthread_t));
+    if (!workers) {
+        perror("malloc");
+        exit(1);
+    }
+    int started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&workers[started], NULL, parallel_worker, job) != 0) break;
+    }
+    parallel_worker(job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+}
+
+// Phase one: look up one range of arguments
+static void lookup_range(ParallelJob *job, int step) {
+    int first = job->first + step * PARALLEL_LOOKUP_RANGE;
+    int last = first + PARALLEL_LOOKUP_RANGE < job->argc ? first + PARALLEL_LOOKUP_RANGE : job->argc;
+    for (int i = first; i < last; i++) {
+        const char *arg = job->argv[i];
+        if (arg[0] == '@' && arg[1] != '\0') {
+            job->entries[i - job->first] = &response_file_entry;
+        } else {
+            size_t len = strcspn(arg, "=");
+            int ambiguous;
+            const HashEntry *e = ft_find_entry(job->set, arg, len, &ambiguous);
+            // Abbreviations (ambiguous ones included) are left to the serial
+            // loop, the chunks rely on e->len being the length of the name in argv
+            job->entries[i - job->first] = e && e->len == len ? e : NULL;
+        }
+    }
+}
+
+// Phase two: parse one chunk into its record with the lookups of phase one,
+// noting which flags it set. Errors only need detecting, the chunk is then
+// parsed again serially.
+static void parse_chunk(ParallelJob *job, int step) {
+    ParallelChunk *c = &job->chunks[step];
+    for (int i = c->first; i < c->last; i++) {
+        const HashEntry *e = job->entries[i - job->first];
+        if (!e || e == &response_file_entry) {
+            c->error = FLAG_ERR_UNKNOWN;
+            return;
+        }
+        const char *arg = job->argv[i], *val = NULL;
+        if (arg[e->len] == '=') {
+            val = arg + e->len + 1;
+        } else if (e->flag->type != TYPE_BOOL) {
+            if (i + 1 >= job->argc) {
+                c->error = FLAG_ERR_MISSING_VALUE;
+                return;
+            }
+            val = job->argv[++i];
+        }
+        if ((c->error = ft_record_value(c->values, e->flag, val, e->negated, job->borrow)) != 0) return;
+        c->seen[e->flag->index] = 1;
+    }
+}
+
+/**
+ * flush_segment - Parses the chunks collected so far and merges them in order.
+ *
+ * A chunk that fails is parsed again serially into the set, so the values
+ * in front of the bad argument are kept and the error is printed exactly
+ * as flag_parse() does.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code of the first failing chunk
+ */
+static int flush_segment(ParallelJob *job) {
+    int count = job->chunk_count;
+    job->chunk_count = 0;
+    if (count == 0) return 0;
+    if (count == 1) { // Too short to split
+        ParallelChunk *c = &job->chunks[0];
+        return ft_parse_args(job->set, NULL, c->last, job->argv, c->first, job->borrow, job->depth);
+    }
+
+    FlagSet *set = job->set;
+    for (int k = 0; k < count; k++) {
+        ParallelChunk *c = &job->chunks[k];
+        if (!c->values) {
+            c->values = flag_values_new(set);
+            c->seen = calloc((size_t)set->flag_count, 1);
+            if (!c->seen) {
+                perror("calloc");
+                exit(1);
+            }
+        }
+    }
+    run_phase(job, parse_chunk, count);
+
+    int rc = 0;
+    for (int k = 0; k < count; k++) {
+        ParallelChunk *c = &job->chunks[k];
+        if (!rc && c->error) {
+            rc = ft_parse_args(set, NULL, c->last, job->argv, c->first, job->borrow, job->depth);
+        } else if (!rc) {
+            ft_adopt_strings(set, c->values);
+            for (int i = 0; i < set->flag_count; i++) {
+                if (c->seen[i]) ft_merge_value(set->flags[i], &c->values->slots[i]);
+            }
+        }
+        flag_values_reset(c->values); // Ready for the next segment
+        memset(c->seen, 0, (size_t)set->flag_count);
+    }
+    return rc;
+}
+
+// Close the chunk ending before argument `last`
+static void end_chunk(ParallelJob *job, int first, int last) {
+    if (last <= first) return;
+    ParallelChunk *c = &job->chunks[job->chunk_count++];
+    c->first = first; // Record and seen array stay for reuse
+    c->last = last;
+    c->error = 0;
+}
+
+/**
+ * ft_parse_parallel - Parses argv[first..argc) into the set on several threads.
+ *
+ * The arguments are looked up in parallel, then walked once to find where
+ * each flag (and its value) starts, which is where chunks may be cut. An
+ * @file argument ends the current segment: the chunks before it are parsed
+ * and merged, then the file, whose own arguments are parsed the same way.
+ * Merging applies each chunk in order, single values replacing and multi
+ * values appending, so the set ends up as after the serial loop. Sets with
+ * flag_on_* handlers are parsed serially, since handlers must see every
+ * value in argument order.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error
+ */
+int ft_parse_parallel(FlagSet *set, int argc, char *argv[], int first, int borrow, int depth, int threads) {
+    int n = argc - first;
+    int serial = threads < 2 || n < 2 * PARALLEL_MIN_CHUNK;
+    for (int i = 0; i < set->flag_count && !serial; i++) {
+        serial = set->flags[i]->has_handler;
+    }
+    if (serial) return ft_parse_args(set, NULL, argc, argv, first, borrow, depth);
+
+    ParallelJob job = { .set = set, .argc = argc, .argv = argv, .first = first, .borrow = borrow,
+                        .depth = depth, .threads = threads };
+    job.entries = malloc((size_t)n * sizeof(HashEntry *));
+    job.chunks = calloc((size_t)threads, sizeof(ParallelChunk));
+    if (!job.entries || !job.chunks) {
+        perror("malloc");
+        exit(1);
+    }
+    run_phase(&job, lookup_range, (n + PARALLEL_LOOKUP_RANGE - 1) / PARALLEL_LOOKUP_RANGE);
+
+    // Cut chunks on flag boundaries, stopping at the first argument the
+    // serial loop would fail on (its chunk reports the error)
+    int chunk_size = n / threads > PARALLEL_MIN_CHUNK ? n / threads + 1 : PARALLEL_MIN_CHUNK;
+    int rc = 0, start = first, i = first;
+    while (i < argc && !rc) {
+        const HashEntry *e = job.entries[i - first];
+        if (e == &response_file_entry) {
+            end_chunk(&job, start, i);
+            if ((rc = flush_segment(&job)) == 0) {
+                rc = ft_parse_response_file(set, NULL, argv[i] + 1, depth + 1, threads);
+            }
+            start = ++i;
+            continue;
+        }
+        if (!e) {
+            i = argc; // Unknown flag, nothing after it is parsed
+            break;
+        }
+        i += takes_next(e, argv[i]) ? 2 : 1;
+        if (i >= argc) break; // A missing value is reported by the last chunk
+        if (i - start >= chunk_size) {
+            if (job.chunk_count == threads - 1) continue; // Last chunk takes the rest of the segment
+            end_chunk(&job, start, i);
+            start = i;
+        }
+    }
+    if (!rc) {
+        end_chunk(&job, start, i < argc ? i : argc);
+        rc = flush_segment(&job);
+    }
+
+    for (int k = 0; k < threads; k++) {
+        flag_values_free(job.chunks[k].values);
+        free(job.chunks[k].seen);
+    }
+    free(job.chunks);
+    free(job.entries);
+    return rc;
+}
+
+/**
+ * flagset_parse_parallel - Parses one very long command line on several threads.
+ *
+ * Same result as flagset_parse() (last value wins for single flags, multi
+ * flags keep argument order, the same error for the same bad argument),
+ * but the lookups and conversions of millions of arguments, including
+ * those of @files, are spread over @threads workers. Short command lines
+ * are parsed serially.
+ *
+ * @threads: Number of workers, <= 0 for one per online CPU.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error
+ */
+int flagset_parse_parallel(FlagSet *set, int argc, char *argv[], int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    set->active = NULL; // Set again if a subcommand is named
+    FT_STAT_CLOCK(start);
+    int rc = ft_parse_parallel(set, argc, argv, 1, 0, 0, threads);
+    FT_STAT_ADD(set, parses, 1);
+    FT_STAT_ADD(set, parsed_args, argc > 1 ? argc - 1 : 0);
+    FT_STAT_ELAPSED(set, parse_ns, start);
+    ft_publish_parse(set);
+    return rc;
+}
+
+int flag_parse_parallel(int argc, char *argv[], int threads) {
+    return flagset_parse_parallel(ft_default_set(), argc, argv, threads);
+}
@@ -0,0 +1,228 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Hot reload: the values of a set are copied into a fresh record that is
+ * published with one atomic pointer swap (RCU-style), after a reload and
+ * after every later change. Readers mark read sections with per-thread
+ * epochs and never block; the publishing thread waits until no section
+ * that could still see the old record is active before freeing it, and
+ * keeps it instead when a pointer into it left a section.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L // sched_yield, pthread
+
+#include "flagtool_internal.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Read-side state of one thread, records are reused after their thread exits
+typedef struct Reader {
+    _Atomic uint64_t epoch;     // Epoch the outermost section began in, 0 outside
+    atomic_int in_use;          // Claimed by a live thread
+    struct Reader *next;        // Next record, fixed once published
+    int nesting;                // Section depth, only touched by the owner
+} Reader;
+
+static _Atomic(Reader *) readers;           // Every record ever created
+static _Atomic uint64_t global_epoch = 1;   // Advanced by every grace period
+static _Thread_local Reader *self;          // Record of the calling thread
+static pthread_key_t reader_key;            // Releases the record on thread exit
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER; // Writers only
+
+static void reader_exit(void *arg) {
+    Reader *r = arg;
+    atomic_store_explicit(&r->epoch, 0, memory_order_release);
+    atomic_store_explicit(&r->in_use, 0, memory_order_release);
+}
+
+static void reader_key_init() {
+    pthread_key_create(&reader_key, reader_exit);
+}
+
+// Claim a free record or push a new one onto the list, without locking
+static Reader *reader_register() {
+    pthread_once(&reader_once, reader_key_init);
+    Reader *r;
+    for (r = atomic_load(&readers); r; r = r->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&r->in_use, &expected, 1)) break;
+    }
+    if (!r) {
+        r = calloc(1, sizeof(Reader));
+        if (!r) {
+            perror("calloc");
+            exit(1);
+        }
+        atomic_init(&r->in_use, 1);
+        r->next = atomic_load(&readers);
+        while (!atomic_compare_exchange_weak(&readers, &r->next, r)) {
+        }
+    }
+    pthread_setspecific(reader_key, r);
+    self = r;
+    return r;
+}
+
+/**
+ * flag_read_lock - Enters a read section of the calling thread.
+ *
+ * Only marks the thread as reading (no lock is taken and it never waits).
+ * Snapshots published by flagset_reload() stay alive until every section
+ * that could have seen them has ended, so strings and arrays read from a
+ * reloaded set remain valid up to the matching flag_read_unlock().
+ * Sections nest.
+ */
+void flag_read_lock() {
+    Reader *r = self ? self : reader_register();
+    if (r->nesting++ == 0) {
+        atomic_store(&r->epoch, atomic_load(&global_epoch)); // Seen by writers before our loads
+    }
+}
+
+void flag_read_unlock() {
+    Reader *r = self;
+    if (r && r->nesting > 0 && --r->nesting == 0) {
+        atomic_store_explicit(&r->epoch, 0, memory_order_release); // Our reads are done
+    }
+}
+
+// Wait until every section that began before this call has ended
+static void synchronize() {
+    uint64_t target = atomic_fetch_add(&global_epoch, 1) + 1;
+    for (Reader *r = atomic_load(&readers); r; r = r->next) {
+        uint64_t e;
+        while ((e = atomic_load(&r->epoch)) != 0 && e < target) {
+            sched_yield();
+        }
+    }
+}
+
+// Keep a snapshot until cleanup, a pointer into it is leaving the caller's
+// outermost read section (the getters' own section, or no section at all)
+void ft_escape(FlagValues *values) {
+    if (self && self->nesting <= 1 && !atomic_load_explicit(&values->escaped, memory_order_relaxed)) {
+        atomic_store_explicit(&values->escaped, 1, memory_order_relaxed);
+    }
+}
+
+// Current snapshot of a set, NULL until its first reload. Taken outside a
+// read section it stays valid until the set is cleaned up
+FlagValues *flagset_snapshot(FlagSet *set) {
+    flag_read_lock();
+    FlagValues *values = atomic_load(&set->live);
+    if (values) ft_escape(values);
+    flag_read_unlock();
+    return values;
+}
+
+FlagValues *flag_snapshot() {
+    return flagset_snapshot(ft_default_set());
+}
+
+// Publish a copy of the set's values and write its bound variables from
+// it, then free the old snapshot once no section can see it. Called with
+// reload_lock held. Inside a read section of the caller the old snapshot
+// is kept instead, waiting for our own section would never end
+static void publish(FlagSet *set) {
+    FlagValues *next = ft_values_copy(set);
+    if (ft_write_bound_values(next)) atomic_init(&next->escaped, 1); // A bound string points into it
+    FlagValues *old = atomic_exchange(&set->live, next);
+    if (!old) return;
+    if (self && self->nesting) {
+        atomic_store(&old->escaped, 1);
+    } else {
+        synchronize();
+    }
+    if (atomic_load(&old->escaped)) {
+        old->retired = set->retired;
+        set->retired = old;
+    } else {
+        flag_values_free(old);
+    }
+}
+
+// Publish the values of a reloaded set after a change, nothing before its first reload
+void ft_publish(FlagSet *set) {
+    if (!atomic_load_explicit(&set->live, memory_order_relaxed)) return;
+    pthread_mutex_lock(&reload_lock);
+    publish(set);
+    pthread_mutex_unlock(&reload_lock);
+}
+
+// After a parse: the set, and the sets of the commands it dispatched to
+void ft_publish_parse(FlagSet *set) {
+    for (FlagSet *s = set; s; s = s->active ? s->active->set : NULL) ft_publish(s);
+}
+
+/**
+ * flagset_reload - Atomically replaces the command line of a set.
+ *
+ * @argv is parsed into a record first; only if that succeeds do the values
+ * change. They are rebuilt like a fresh start: defaults, then the loaded
+ * config file, the environment if flagset_apply_env() ran, and @argv last.
+ * A copy is published, so readers see either the old or the new values
+ * and never a mix, and the variables bound by flag_*_var() are updated.
+ *
+ * From the first reload on, the flag_get_* functions read the current
+ * snapshot, and every later change (a parse, config or environment load,
+ * reset) is published the same way. The old snapshot is freed once no
+ * read section can still be using it, so this call may wait for readers
+ * but readers never wait for it. A snapshot that a string or array
+ * escaped from (read outside a section, or held by a bound variable) is
+ * kept until the set is cleaned up instead. Must not be called from inside
+ * a read section.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code if the command line is invalid (old values stay)
+ *   FLAG_ERR_IN_READ_SECTION if called inside a read section
+ */
+int flagset_reload(FlagSet *set, int argc, char *argv[]) {
+    if (self && self->nesting) {
+        fprintf(stderr, "flag reload inside a read section would never finish\n");
+        return FLAG_ERR_IN_READ_SECTION;
+    }
+    FlagValues *next = flag_values_new(set);
+    next->seen = calloc((size_t)next->count + 1, 1);
+    if (!next->seen) {
+        perror("calloc");
+        exit(1);
+    }
+    int rc = flag_parse_values(set, next, argc, argv);
+    if (rc != 0) {
+        flag_values_free(next);
+        return rc;
+    }
+
+    pthread_mutex_lock(&reload_lock);
+    ft_reload_slots(set, next);
+    publish(set);
+    pthread_mutex_unlock(&reload_lock);
+    flag_values_free(next);
+    return 0;
+}
+
+int flag_reload(int argc, char *argv[]) {
+    return flagset_reload(ft_default_set(), argc, argv);
+}
+
+// Drop the published snapshot of a set being cleaned up, and the kept ones
+void ft_release_live(FlagSet *set) {
+    FlagValues *old = atomic_exchange(&set->live, NULL);
+    if (old) {
+        synchronize();
+        flag_values_free(old);
+    }
+    while (set->retired) {
+        FlagValues *next = set->retired->retired;
+        flag_values_free(set->retired);
+        set->retired = next;
+    }
+}
@@ -0,0 +1,170 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Response files: an @path argument is replaced by the arguments stored in
+ * the file. The file is memory-mapped and tokenized in place, parsed values
+ * point straight into the mapping.
+ *
+ */
+
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+
+#include "flagtool_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int is_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/**
+ * tokenize - Splits a response file into NUL-terminated arguments in place.
+ *
+ * Quoting follows the usual response file rules:
+ *   - whitespace separates arguments
+ *   - '...' is taken literally
+ *   - "..." allows \" and \\ escapes
+ *   - a backslash outside quotes escapes the next character
+ *
+ * Unquoting only ever shrinks a token, so every token is compacted where it
+ * lies and terminated by overwriting the byte after it. @end must be
+ * followed by one writable byte.
+ *
+ * Returns:
+ *   the number of tokens stored in *tokens (grown with realloc)
+ */
+static int tokenize(char *p, char *end, char ***tokens, int *capacity) {
+    int count = 0;
+    while (p < end) {
+        while (p < end && is_separator(*p)) p++; // Skip separators
+        if (p >= end) break;
+
+        char *token = p, *w = p;
+        while (p < end && !is_separator(*p)) {
+            if (*p == '\'') {
+                for (p++; p < end && *p != '\''; ) *w++ = *p++;
+                if (p < end) p++; // Closing quote
+            } else if (*p == '"') {
+                for (p++; p < end && *p != '"'; ) {
+                    if (*p == '\\' && p + 1 < end && (p[1] == '"' || p[1] == '\\')) p++;
+                    *w++ = *p++;
+                }
+                if (p < end) p++; // Closing quote
+            } else if (*p == '\\' && p + 1 < end) {
+                p++;
+                *w++ = *p++;
+            } else {
+                *w++ = *p++;
+            }
+        }
+        p++; // Past the separator the terminator may overwrite
+        *w = '\0';
+
+        if (count == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 256;
+            char **grown = realloc(*tokens, (size_t)*capacity * sizeof(char *));
+            if (!grown) {
+                perror("realloc");
+                exit(1);
+            }
+            *tokens = grown;
+        }
+        (*tokens)[count++] = token;
+    }
+    return count;
+}
+
+// Map a file privately with one writable byte after its end, @st may be NULL
+FlagMapping *ft_map_file(const char *path, struct stat *st) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat own;
+    if (!st) st = &own;
+    if (fstat(fd, st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st->st_size;
+
+    // Reserve size + 1 bytes of zeroed memory, then map the file over it so
+    // the terminator after the last token lands in valid memory
+    size_t len = size + 1;
+    char *addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (size && mmap(addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int saved = errno;
+        munmap(addr, len);
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    close(fd);
+    posix_madvise(addr, size, POSIX_MADV_SEQUENTIAL); // Read once front to back
+
+    FlagMapping *m = malloc(sizeof(FlagMapping));
+    if (!m) {
+        perror("malloc");
+        exit(1);
+    }
+    m->addr = addr;
+    m->len = len;
+    m->next = NULL;
+    return m;
+}
+
+/**
+ * ft_parse_response_file - Parses the arguments stored in a response file.
+ *
+ * The mapping stays alive on the set (or record) until it is reset or
+ * cleaned up, because string values are stored as views into it. Response
+ * files may name further @files up to MAX_RESPONSE_DEPTH levels deep.
+ * With @threads > 1 (flagset_parse_parallel) the file's arguments are
+ * parsed in parallel chunks.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error
+ */
+int ft_parse_response_file(FlagSet *set, FlagValues *out, const char *path, int depth, int threads) {
+    if (depth > MAX_RESPONSE_DEPTH) {
+        if (!out) fprintf(stderr, "Response files nested too deeply at @%s\n", path);
+        return FLAG_ERR_RESPONSE_FILE;
+    }
+    FlagMapping *m = ft_map_file(path, NULL);
+    if (!m) {
+        if (!out) fprintf(stderr, "Cannot read response file %s: %s\n", path, strerror(errno));
+        return FLAG_ERR_RESPONSE_FILE;
+    }
+    FlagMapping **owner = out ? &out->mappings : &set->mappings;
+    m->next = *owner;
+    *owner = m;
+
+    char **tokens = NULL;
+    int capacity = 0;
+    int count = tokenize(m->addr, (char *)m->addr + m->len - 1, &tokens, &capacity);
+    int rc = threads > 1 && !out ? ft_parse_parallel(set, count, tokens, 0, 1, depth, threads)
+                                 : ft_parse_args(set, out, count, tokens, 0, 1, depth); // Values borrow from the mapping
+    free(tokens);
+    return rc;
+}
+
+// Unmap every response file once no value points into it anymore
+void ft_release_mappings(FlagMapping **mappings) {
+    while (*mappings) {
+        FlagMapping *next = (*mappings)->next;
+        munmap((*mappings)->addr, (*mappings)->len);
+        free(*mappings);
+        *mappings = next;
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Parsing against static tables declared with FLAGTOOL_STATIC(): nothing
+ * is registered or allocated, values go straight into the table's
+ * variables and strings are stored as pointers into argv.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include "flagtool_static.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STATIC_MAX_NAME 256 // Longest --no-name rewritten on the stack
+
+// Find a name, trying --no-name as the negation of a boolean --name
+static int static_lookup(const FlagStaticTable *table, const char *name, size_t len, int *negated) {
+    *negated = 0;
+    int index = table->lookup(name, len);
+    if (index >= 0 || len <= 5 || len >= STATIC_MAX_NAME || strncmp(name, "--no-", 5) != 0) return index;
+
+    char positive[STATIC_MAX_NAME];
+    positive[0] = positive[1] = '-';
+    memcpy(positive + 2, name + 5, len - 5);
+    index = table->lookup(positive, len - 3);
+    if (index < 0 || table->defs[index].type != FLAG_STATIC_BOOL) return -1;
+    *negated = 1;
+    return index;
+}
+
+/**
+ * flag_parse_static - Parses command-line arguments into a static table.
+ *
+ * Accepts the same forms as flag_parse() (--flag, --flag=value,
+ * --flag value, --no-flag for booleans) and converts ints with the same
+ * rules and errors. No memory is allocated: string values are pointers
+ * into @argv, which must outlive them.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error
+ */
+int flag_parse_static(const FlagStaticTable *table, int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+
+        size_t name_len = strcspn(arg, "=");
+        if (arg[name_len] == '=') val = arg + name_len + 1;
+
+        int negated;
+        int index = static_lookup(table, arg, name_len, &negated);
+        if (index < 0) {
+            fprintf(stderr, "Unknown flag: %s\n", arg);
+            return FLAG_ERR_UNKNOWN;
+        }
+        const FlagStaticDef *def = &table->defs[index];
+        if (def->type == FLAG_STATIC_BOOL) {
+            *(int *)def->var = !negated;
+            continue;
+        }
+        if (!val) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing value for flag %s\n", def->names[0]);
+                return FLAG_ERR_MISSING_VALUE;
+            }
+            val = argv[++i];
+        }
+        if (def->type == FLAG_STATIC_STRING) {
+            *(const char **)def->var = val;
+        } else {
+            FlagNumber n;
+            int rc = ft_parse_number(TYPE_INT, val, val + strlen(val), &n); // Same rules as flag_parse()
+            if (rc != 0) return rc;
+            *(int *)def->var = n.i;
+        }
+    }
+    return 0;
+}
+
+void flag_reset_static(const FlagStaticTable *table) {
+    for (int i = 0; i < table->count; i++) {
+        const FlagStaticDef *def = &table->defs[i];
+        if (def->type == FLAG_STATIC_STRING) {
+            *(const char **)def->var = def->default_str;
+        } else {
+            *(int *)def->var = def->default_int;
+        }
+    }
+}
+
+#define STATIC_MAX_NAME_COLUMN 32 // Same name column limit as print_flag_usage()
+
+// Names and value placeholder of a definition, as printed in front of its help
+static int static_spec(const FlagStaticDef *def, char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (const char *const *name = def->names; *name; name++) {
+        len += (size_t)snprintf(buf + len, len < size ? size - len : 0, "%s%s", *name, name[1] ? ", " : "");
+    }
+    const char *type = def->type == FLAG_STATIC_STRING ? " <string>" : def->type == FLAG_STATIC_INT ? " <int>" : "";
+    len += (size_t)snprintf(buf + len, len < size ? size - len : 0, "%s", type);
+    return (int)len;
+}
+
+// Print usage in the same layout as print_flag_usage(), help in one column
+void flag_print_usage_static(const FlagStaticTable *table, const char *progname) {
+    char spec[256];
+    int width = 0;
+    for (int i = 0; i < table->count; i++) {
+        int len = static_spec(&table->defs[i], spec, sizeof(spec));
+        if (len > width && len <= STATIC_MAX_NAME_COLUMN) width = len;
+    }
+    printf("Usage: %s [flags]\nFlags:\n", progname);
+    for (int i = 0; i < table->count; i++) {
+        const FlagStaticDef *def = &table->defs[i];
+        int len = static_spec(def, spec, sizeof(spec));
+        if (len > width) printf("    %s\n%*s", spec, width + 6, ""); // Help on the next line
+        else printf("    %-*s  ", width, spec);
+        switch (def->type) {
+            case FLAG_STATIC_STRING:
+                printf("%s (default: %s)\n", def->help, def->default_str ? def->default_str : "none");
+                break;
+            case FLAG_STATIC_BOOL:
+                printf("%s (default: %s)\n", def->help, def->default_int ? "true" : "false");
+                break;
+            case FLAG_STATIC_INT:
+                printf("%s (default: %d)\n", def->help, def->default_int);
+                break;
+        }
+    }
+}
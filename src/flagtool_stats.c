@@ -0,0 +1,120 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Statistics: counters gathered by the FT_STAT_* hooks when built with
+ * FLAGTOOL_STATS, plus the shape of the registry computed on request.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include "flagtool_internal.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef FLAGTOOL_STATS
+// Probe lengths and clustering of the open-addressing table
+static void table_shape(FlagSet *set, FlagStats *stats) {
+    size_t size = set->hash_table_size, mask = size - 1;
+    size_t total = 0, run = 0, first_empty = 0;
+    if (!set->hash_table || set->hash_table_used == size) return;
+
+    for (size_t i = 0; i < size; i++) {
+        const HashEntry *e = &set->hash_table[i];
+        if (!e->flag) continue;
+        size_t probes = ((i - (e->hash & mask)) & mask) + 1; // Distance from the home slot
+        stats->probe_histogram[probes < FLAG_STATS_PROBE_BUCKETS ? probes - 1 : FLAG_STATS_PROBE_BUCKETS - 1]++;
+        if (probes > stats->probe_max) stats->probe_max = probes;
+        total += probes;
+    }
+    if (set->hash_table_used) stats->probe_mean = (double)total / set->hash_table_used;
+
+    // Runs may wrap around the end, so start counting after an empty slot
+    while (set->hash_table[first_empty].flag) first_empty++;
+    for (size_t n = 1; n <= size; n++) {
+        if (set->hash_table[(first_empty + n) & mask].flag) {
+            if (++run > stats->cluster_max) stats->cluster_max = run;
+        } else {
+            run = 0;
+        }
+    }
+}
+#endif
+
+/**
+ * flagset_stats - Reports what a set has done and how its registry looks.
+ *
+ * Counters accumulate from the creation of the set (or the last
+ * flagset_stats_reset()) and survive flagset_cleanup(). The registry shape
+ * is computed from the current table on every call.
+ *
+ * Returns:
+ *   0 on success
+ *   non-zero if the library was built without FLAGTOOL_STATS (all zero)
+ */
+int flagset_stats(FlagSet *set, FlagStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+#ifdef FLAGTOOL_STATS
+    stats->enabled = 1;
+    stats->flags = (size_t)set->flag_count;
+    stats->table_slots = set->hash_table_size;
+    stats->table_used = set->hash_table_used;
+    stats->frozen = set->frozen.active;
+    table_shape(set, stats);
+#define FT_STAT_LOAD(name) stats->name = atomic_load_explicit(&set->stats.name, memory_order_relaxed);
+    FT_STAT_COUNTERS(FT_STAT_LOAD)
+#undef FT_STAT_LOAD
+    return 0;
+#else
+    (void)set;
+    return 1;
+#endif
+}
+
+void flagset_stats_reset(FlagSet *set) {
+#ifdef FLAGTOOL_STATS
+#define FT_STAT_CLEAR(name) atomic_store_explicit(&set->stats.name, 0, memory_order_relaxed);
+    FT_STAT_COUNTERS(FT_STAT_CLEAR)
+#undef FT_STAT_CLEAR
+#else
+    (void)set;
+#endif
+}
+
+// Write the stats of a set as one JSON object
+int flagset_stats_json(FlagSet *set, FILE *out) {
+    FlagStats stats;
+    int rc = flagset_stats(set, &stats);
+    fprintf(out, "{\n  \"enabled\": %s", stats.enabled ? "true" : "false");
+#ifdef FLAGTOOL_STATS
+    if (!rc) {
+        fprintf(out, ",\n  \"flags\": %zu,\n  \"table_slots\": %zu,\n  \"table_used\": %zu,\n  \"frozen\": %s",
+                stats.flags, stats.table_slots, stats.table_used, stats.frozen ? "true" : "false");
+        fprintf(out, ",\n  \"probe_histogram\": [");
+        for (int i = 0; i < FLAG_STATS_PROBE_BUCKETS; i++) {
+            fprintf(out, "%s%zu", i ? ", " : "", stats.probe_histogram[i]);
+        }
+        fprintf(out, "],\n  \"probe_max\": %zu,\n  \"probe_mean\": %.3f,\n  \"cluster_max\": %zu",
+                stats.probe_max, stats.probe_mean, stats.cluster_max);
+#define FT_STAT_PRINT(name) fprintf(out, ",\n  \"" #name "\": %llu", (unsigned long long)stats.name);
+        FT_STAT_COUNTERS(FT_STAT_PRINT)
+#undef FT_STAT_PRINT
+    }
+#endif
+    fprintf(out, "\n}\n");
+    return rc;
+}
+
+int flag_stats(FlagStats *stats) {
+    return flagset_stats(ft_default_set(), stats);
+}
+
+void flag_stats_reset() {
+    flagset_stats_reset(ft_default_set());
+}
+
+int flag_stats_json(FILE *out) {
+    return flagset_stats_json(ft_default_set(), out);
+}
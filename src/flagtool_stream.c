@@ -0,0 +1,239 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Streaming parse: arguments arrive as a byte stream in pieces of any size
+ * (a pipe, a socket, a generator) and are split with the response file
+ * rules as the bytes come in. Values of flags with a handler (flag_on_*)
+ * are passed on immediately, so memory stays bounded by the longest
+ * argument however long the stream runs.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STREAM_READ_SIZE 65536 // Bytes read from a descriptor at a time
+
+// Parser state carried from one piece of input to the next
+struct FlagStream {
+    FlagSet *set;           // Set the values go to
+    char *token;            // Argument being scanned, unquoted
+    size_t len;             // Bytes in token
+    size_t cap;             // Room in token
+    int in_token;           // Inside an argument (it may still be empty, e.g. '')
+    char quote;             // Open quote character, 0 outside quotes
+    int escape;             // Previous byte was a backslash
+    Flag *pending;          // Flag still waiting for its value
+    int pending_negated;    // Pending flag was named by a --no- alias
+    int error;              // First error, sticks until the stream is freed
+};
+
+// Bytes that end a run of plain argument characters
+static const unsigned char special[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\r'] = 1, ['\f'] = 1, ['\v'] = 1,
+    ['\''] = 1, ['"'] = 1, ['\\'] = 1,
+};
+
+// Make room for len more bytes plus a terminator, kept out of the byte loop
+static void token_grow(FlagStream *s, size_t len) {
+    size_t cap = s->cap ? s->cap : 256;
+    while (cap < s->len + len + 1) cap *= 2;
+    char *grown = realloc(s->token, cap);
+    if (!grown) {
+        perror("realloc");
+        exit(1);
+    }
+    s->token = grown;
+    s->cap = cap;
+}
+
+static inline void token_append(FlagStream *s, const char *data, size_t len) {
+    if (s->len + len + 1 > s->cap) token_grow(s, len);
+    memcpy(s->token + s->len, data, len);
+    s->len += len;
+}
+
+// Handle one complete argument: a flag name, a value or an @file
+static int stream_argument(FlagStream *s) {
+    token_append(s, "", 1); // Terminate
+    char *arg = s->token;
+    s->len = 0;
+    s->in_token = 0;
+
+    if (s->pending) {
+        Flag *f = s->pending;
+        s->pending = NULL;
+        return ft_set_value(s->set, f, arg, s->pending_negated, 0);
+    }
+    if (arg[0] == '@' && arg[1] != '\0') {
+        return ft_parse_response_file(s->set, NULL, arg + 1, 1, 0);
+    }
+
+    size_t name_len = strcspn(arg, "=");
+    int ambiguous;
+    const HashEntry *e = ft_find_entry(s->set, arg, name_len, &ambiguous);
+    if (ambiguous) {
+        fprintf(stderr, "Ambiguous flag: %s\n", arg);
+        return FLAG_ERR_AMBIGUOUS;
+    }
+    if (!e) {
+        fprintf(stderr, "Unknown flag: %s\n", arg);
+        return FLAG_ERR_UNKNOWN;
+    }
+    if (arg[name_len] == '=' || e->flag->type == TYPE_BOOL) {
+        return ft_set_value(s->set, e->flag, arg[name_len] == '=' ? arg + name_len + 1 : NULL, e->negated, 0);
+    }
+    s->pending = e->flag; // Value is the next argument
+    s->pending_negated = e->negated;
+    return 0;
+}
+
+// Create a stream parsing into a set, values accumulate on top of the set's
+FlagStream *flagset_stream_new(FlagSet *set) {
+    FlagStream *s = calloc(1, sizeof(FlagStream));
+    if (!s) {
+        perror("calloc");
+        exit(1);
+    }
+    s->set = set;
+    return s;
+}
+
+FlagStream *flag_stream_new() {
+    return flagset_stream_new(ft_default_set());
+}
+
+/**
+ * flag_stream_feed - Parses the next piece of a stream of arguments.
+ *
+ * Arguments are separated by whitespace and quoted like in response files;
+ * an argument, a quote or a flag and its value may be split across pieces
+ * anywhere. Each argument is handled as soon as the whitespace after it
+ * arrives, so handlers see values while the stream is still coming in.
+ * After an error the stream ignores further input.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error
+ */
+int flag_stream_feed(FlagStream *s, const char *data, size_t len) {
+    const char *p = data, *end = data + len;
+    while (p < end && !s->error) {
+        if (!s->quote && !s->escape) {
+            const char *run = p;
+            while (p < end && !special[(unsigned char)*p]) p++; // Plain characters
+            if (p > run) {
+                token_append(s, run, (size_t)(p - run));
+                s->in_token = 1;
+                continue;
+            }
+        }
+        char c = *p++;
+        if (s->escape) {
+            s->escape = 0;
+            if (s->quote && c != '"' && c != '\\') {
+                token_append(s, "\\", 1); // Inside "..." only \" and \\ are escapes
+                p--; // so c is an ordinary character
+                continue;
+            }
+            token_append(s, &c, 1);
+        } else if (s->quote == '\'') {
+            if (c == '\'') s->quote = 0;
+            else token_append(s, &c, 1);
+        } else if (s->quote == '"') {
+            if (c == '"') s->quote = 0;
+            else if (c == '\\') s->escape = 1;
+            else token_append(s, &c, 1);
+        } else if (c == '\'' || c == '"') {
+            s->quote = c;
+            s->in_token = 1;
+        } else if (c == '\\') {
+            s->escape = 1;
+            s->in_token = 1;
+        } else if (s->in_token) {
+            s->error = stream_argument(s); // Whitespace ends the argument
+        }
+    }
+    return s->error;
+}
+
+/**
+ * flag_stream_finish - Ends a stream, handling its last argument.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error, including a flag left without its value
+ */
+int flag_stream_finish(FlagStream *s) {
+    if (!s->error) {
+        if (s->escape) token_append(s, "\\", 1); // Trailing backslash is literal
+        s->escape = 0;
+        s->quote = 0;
+        if (s->in_token) s->error = stream_argument(s);
+        if (!s->error && s->pending) {
+            fprintf(stderr, "Missing value for flag %s\n", s->set->info[s->pending->index].names[0]);
+            s->error = FLAG_ERR_MISSING_VALUE;
+        }
+    }
+    ft_publish_parse(s->set); // Values stored before an error as well
+    return s->error;
+}
+
+void flag_stream_free(FlagStream *s) {
+    if (s) {
+        free(s->token);
+        free(s);
+    }
+}
+
+/**
+ * flagset_parse_stream - Parses all arguments readable from a descriptor.
+ *
+ * Reads @fd until end of file in fixed-size pieces and streams them through
+ * flag_stream_feed(), so a generator can pipe millions of values through
+ * flag_on_* handlers in constant memory.
+ *
+ * Returns:
+ *   0 on success
+ *   FLAG_ERR_* code on error, FLAG_ERR_READ if reading fails
+ */
+int flagset_parse_stream(FlagSet *set, int fd) {
+    char *buf = malloc(STREAM_READ_SIZE);
+    if (!buf) {
+        perror("malloc");
+        exit(1);
+    }
+    FlagStream *s = flagset_stream_new(set);
+    int rc = 0;
+    ssize_t n;
+    for (;;) {
+        n = read(fd, buf, STREAM_READ_SIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            fprintf(stderr, "Cannot read flag stream: %s\n", strerror(errno));
+            rc = FLAG_ERR_READ;
+            break;
+        }
+        if (n == 0) {
+            rc = flag_stream_finish(s);
+            break;
+        }
+        if ((rc = flag_stream_feed(s, buf, (size_t)n)) != 0) break;
+    }
+    if (n != 0) ft_publish_parse(set); // Stopped before flag_stream_finish(), which publishes
+    flag_stream_free(s);
+    free(buf);
+    return rc;
+}
+
+int flag_parse_stream(int fd) {
+    return flagset_parse_stream(ft_default_set(), fd);
+}
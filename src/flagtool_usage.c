@@ -0,0 +1,566 @@
+/*
+ *
+ * FLAG TOOL MADE BY @darwincereska on GitHub
+ * https://github.com/darwincereska/flagtool
+ *
+ * Usage output: the registry is turned once into a model (one row per flag
+ * in display order, with its names, type and default already formatted),
+ * which is rendered into column-aligned text, JSON or a man page. Each
+ * rendering is cached until a flag, group or command is registered, and
+ * printed with a single write(2).
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "flagtool_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define USAGE_WIDTH 80              // Help text is wrapped to this many columns
+#define USAGE_INDENT 4              // Columns in front of the flag names
+#define USAGE_MAX_NAME_COLUMN 32    // Longer names put their help on the next line
+#define USAGE_MIN_HELP_WIDTH 24     // Narrowest wrapped help column
+
+// Growable output buffer
+typedef struct UsageBuf {
+    char *data;
+    size_t len;
+    size_t cap;
+} UsageBuf;
+
+// One flag in display order; strings are offsets into the model's text
+typedef struct UsageRow {
+    const Flag *flag;
+    const FlagInfo *info;
+    size_t spec;        // "--jobs, -j <int>"
+    size_t spec_len;
+    size_t def;         // Formatted default, (size_t)-1 for none
+    size_t line;        // "help (default: x)" of the text form
+    size_t line_len;
+    int section;        // Index into the sections
+} UsageRow;
+
+typedef struct UsageSection {
+    const char *title;  // Group name, NULL for ungrouped, "" for the global flags
+    int first;          // First row
+    int count;
+} UsageSection;
+
+// Everything the renderers need, built from the registry in one pass
+typedef struct UsageModel {
+    UsageRow *rows;
+    int row_count;
+    UsageSection *sections;
+    int section_count;
+    const FlagSet *leaf;    // Set whose usage this is (the parsed command's)
+    UsageBuf strings;       // Specs, defaults and the command path
+    size_t path;            // "build run" below the program, offset into strings
+    size_t name_width;      // Name column of the text form, widest name that fits USAGE_MAX_NAME_COLUMN
+} UsageModel;
+
+// Renderings of one model, dropped when any set they cover changes
+struct UsageCache {
+    UsageModel model;
+    const FlagSet *leaf;            // Key: the set described ...
+    unsigned generation;            // ... at these registry generations (summed up the chain)
+    char *progname;                 // ... for this program name
+    char *text[FLAG_USAGE_MAN + 1]; // Renderings by format, NULL until asked for
+    size_t len[FLAG_USAGE_MAN + 1];
+};
+
+static void buf_reserve(UsageBuf *b, size_t extra) {
+    if (b->len + extra <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < b->len + extra) cap *= 2;
+    char *grown = realloc(b->data, cap);
+    if (!grown) {
+        perror("realloc");
+        exit(1);
+    }
+    b->data = grown;
+    b->cap = cap;
+}
+
+static void buf_add(UsageBuf *b, const char *s, size_t n) {
+    buf_reserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void buf_str(UsageBuf *b, const char *s) {
+    buf_add(b, s, strlen(s));
+}
+
+static void buf_fill(UsageBuf *b, char c, size_t n) {
+    buf_reserve(b, n);
+    memset(b->data + b->len, c, n);
+    b->len += n;
+}
+
+// Store a terminated string in the model's text, returns its offset
+static size_t model_str(UsageModel *m, const char *s) {
+    size_t off = m->strings.len;
+    buf_add(&m->strings, s, strlen(s) + 1);
+    return off;
+}
+
+static inline const char *model_at(const UsageModel *m, size_t off) {
+    return m->strings.data + off;
+}
+
+// Placeholder of a value type in usage lines, NULL for booleans
+static const char *type_name(const Flag *f) {
+    switch (f->type) {
+        case TYPE_STRING: return "string";
+        case TYPE_INT: return "int";
+        case TYPE_INT64: return "int64";
+        case TYPE_UINT64: return "uint64";
+        case TYPE_DOUBLE: return "float";
+        case TYPE_SIZE: return "size";
+        case TYPE_DURATION: return "duration";
+        default: return NULL;
+    }
+}
+
+// Default of a flag as printed, NULL for a string flag without one
+static const char *format_default(const Flag *f, char *buf, size_t size) {
+    switch (f->type) {
+        case TYPE_STRING: return f->default_str;
+        case TYPE_BOOL: return f->default_bool ? "true" : "false";
+        case TYPE_INT: snprintf(buf, size, "%d", f->default_int); break;
+        case TYPE_INT64: snprintf(buf, size, "%lld", (long long)f->default_int64); break;
+        case TYPE_UINT64: snprintf(buf, size, "%llu", (unsigned long long)f->default_uint64); break;
+        case TYPE_DOUBLE: snprintf(buf, size, "%g", f->default_double); break;
+        case TYPE_SIZE: ft_format_size(f->default_uint64, buf, size); break;
+        case TYPE_DURATION: ft_format_duration(f->default_int64, buf, size); break;
+    }
+    return buf;
+}
+
+static void model_add_row(UsageModel *m, const Flag *f, const FlagInfo *info, int section, int *capacity) {
+    if (m->row_count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        m->rows = realloc(m->rows, (size_t)*capacity * sizeof(UsageRow));
+        if (!m->rows) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    UsageRow *r = &m->rows[m->row_count++];
+    r->flag = f;
+    r->info = info;
+    r->section = section;
+    r->spec = m->strings.len;
+    for (int n = 0; n < info->name_count; n++) {
+        if (n) buf_add(&m->strings, ", ", 2); // Comma separation
+        buf_str(&m->strings, info->names[n]);
+    }
+    const char *type = type_name(f);
+    if (type) {
+        buf_add(&m->strings, " <", 2);
+        buf_str(&m->strings, type);
+        buf_add(&m->strings, ">", 1);
+    }
+    r->spec_len = m->strings.len - r->spec;
+    buf_add(&m->strings, "", 1);
+    char buf[64];
+    const char *def = format_default(f, buf, sizeof(buf));
+    r->def = def ? model_str(m, def) : (size_t)-1;
+    r->line = m->strings.len;
+    buf_str(&m->strings, info->help ? info->help : "");
+    buf_str(&m->strings, " (default: ");
+    buf_str(&m->strings, def ? def : "none");
+    buf_add(&m->strings, ")", 1);
+    r->line_len = m->strings.len - r->line;
+    buf_add(&m->strings, "", 1);
+    if (r->spec_len > m->name_width && r->spec_len <= USAGE_MAX_NAME_COLUMN) m->name_width = r->spec_len;
+}
+
+static void model_add_section(UsageModel *m, const char *title) {
+    m->sections = realloc(m->sections, (size_t)(m->section_count + 1) * sizeof(UsageSection));
+    if (!m->sections) {
+        perror("realloc");
+        exit(1);
+    }
+    m->sections[m->section_count++] = (UsageSection){ title, m->row_count, 0 };
+}
+
+/**
+ * model_build - Lays out the usage of the parsed command below @root.
+ *
+ * Groups come first in registration order, then the flags of no group,
+ * then the global flags inherited from the sets above. Names, types and
+ * defaults are formatted here once, along with the width of the name
+ * column shared by every row.
+ */
+static void model_build(UsageModel *m, FlagSet *root) {
+    memset(m, 0, sizeof(*m));
+    FlagSet *set = root;
+    m->path = m->strings.len;
+    while (set->active) {
+        buf_add(&m->strings, " ", 1);
+        buf_str(&m->strings, set->active->name);
+        set = set->active->set;
+    }
+    buf_add(&m->strings, "", 1);
+    m->leaf = set;
+
+    int capacity = 0;
+    for (int i = 0; i < set->group_count; i++) {
+        model_add_section(m, set->groups[i]->name);
+        for (int j = 0; j < set->groups[i]->flag_count; j++) {
+            const Flag *f = set->groups[i]->flags[j];
+            model_add_row(m, f, &f->set->info[f->index], m->section_count - 1, &capacity);
+        }
+        m->sections[m->section_count - 1].count = m->row_count - m->sections[m->section_count - 1].first;
+    }
+    model_add_section(m, NULL);
+    for (int i = 0; i < set->flag_count; i++) {
+        if (set->info[i].group == NULL) model_add_row(m, set->flags[i], &set->info[i], m->section_count - 1, &capacity);
+    }
+    m->sections[m->section_count - 1].count = m->row_count - m->sections[m->section_count - 1].first;
+
+    if (set->parent) {
+        model_add_section(m, "");
+        for (FlagSet *p = set->parent; p; p = p->parent) {
+            for (int i = 0; i < p->flag_count; i++) {
+                model_add_row(m, p->flags[i], &p->info[i], m->section_count - 1, &capacity);
+            }
+        }
+        m->sections[m->section_count - 1].count = m->row_count - m->sections[m->section_count - 1].first;
+    }
+}
+
+static void model_free(UsageModel *m) {
+    free(m->rows);
+    free(m->sections);
+    free(m->strings.data);
+    memset(m, 0, sizeof(*m));
+}
+
+// Append help text wrapped at USAGE_WIDTH, continuation lines start at column
+static void wrap_help(UsageBuf *b, const char *text, size_t len, size_t column) {
+    size_t width = USAGE_WIDTH > column + USAGE_MIN_HELP_WIDTH ? USAGE_WIDTH - column : USAGE_MIN_HELP_WIDTH;
+    if (len <= width) { // Most help fits on one line
+        buf_add(b, text, len);
+        buf_add(b, "\n", 1);
+        return;
+    }
+    size_t used = 0;
+    for (const char *p = text; *p;) {
+        while (*p == ' ') p++;
+        size_t word = strcspn(p, " ");
+        if (!word) break;
+        if (used && used + 1 + word > width) {
+            buf_add(b, "\n", 1);
+            buf_fill(b, ' ', column);
+            used = 0;
+        } else if (used) {
+            buf_add(b, " ", 1);
+            used++;
+        }
+        buf_add(b, p, word);
+        used += word;
+        p += word;
+    }
+    buf_add(b, "\n", 1);
+}
+
+// One aligned line (or more, wrapped) per flag: names, then help and default
+static void text_row(UsageBuf *b, const UsageModel *m, const UsageRow *r) {
+    size_t column = USAGE_INDENT + m->name_width + 2;
+    buf_fill(b, ' ', USAGE_INDENT);
+    buf_add(b, model_at(m, r->spec), r->spec_len);
+    if (r->spec_len > m->name_width) { // Help starts on the next line
+        buf_add(b, "\n", 1);
+        buf_fill(b, ' ', column);
+    } else {
+        buf_fill(b, ' ', column - USAGE_INDENT - r->spec_len);
+    }
+    wrap_help(b, model_at(m, r->line), r->line_len, column);
+}
+
+static void render_text(UsageBuf *b, const UsageModel *m, const char *progname) {
+    const FlagSet *leaf = m->leaf;
+    buf_str(b, "Usage: ");
+    buf_str(b, progname);
+    buf_str(b, model_at(m, m->path));
+    buf_str(b, leaf->command_count ? " [flags] <command> [flags]\nFlags:\n" : " [flags]\nFlags:\n");
+    for (int s = 0; s < m->section_count; s++) {
+        const UsageSection *sec = &m->sections[s];
+        if (!sec->title) {
+            buf_str(b, "\nUngrouped Flags:\n");
+        } else if (!sec->title[0]) {
+            buf_str(b, "\nGlobal Flags:\n");
+        } else {
+            buf_str(b, "  ");
+            buf_str(b, sec->title);
+            buf_str(b, ":\n");
+        }
+        for (int i = sec->first; i < sec->first + sec->count; i++) text_row(b, m, &m->rows[i]);
+    }
+    if (leaf->command_count) {
+        size_t width = 0;
+        for (int i = 0; i < leaf->command_count; i++) {
+            size_t len = strlen(leaf->commands[i]->name);
+            if (len > width) width = len;
+        }
+        if (width > USAGE_MAX_NAME_COLUMN) width = USAGE_MAX_NAME_COLUMN;
+        buf_str(b, "\nCommands:\n");
+        for (int i = 0; i < leaf->command_count; i++) {
+            const char *name = leaf->commands[i]->name;
+            size_t len = strlen(name);
+            buf_fill(b, ' ', USAGE_INDENT);
+            buf_add(b, name, len);
+            if (len > width) {
+                buf_add(b, "\n", 1);
+                buf_fill(b, ' ', USAGE_INDENT + width + 2);
+            } else {
+                buf_fill(b, ' ', width - len + 2);
+            }
+            wrap_help(b, leaf->commands[i]->help, strlen(leaf->commands[i]->help), USAGE_INDENT + width + 2);
+        }
+    }
+}
+
+// JSON string literal, NULL as null
+static void json_str(UsageBuf *b, const char *s) {
+    if (!s) {
+        buf_str(b, "null");
+        return;
+    }
+    buf_add(b, "\"", 1);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            buf_add(b, "\\", 1);
+            buf_add(b, s, 1);
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            buf_str(b, esc);
+        } else {
+            buf_add(b, s, 1);
+        }
+    }
+    buf_add(b, "\"", 1);
+}
+
+static void render_json(UsageBuf *b, const UsageModel *m, const char *progname) {
+    buf_str(b, "{\n  \"program\": ");
+    json_str(b, progname);
+    buf_str(b, ",\n  \"command\": ");
+    const char *path = model_at(m, m->path);
+    json_str(b, path[0] ? path + 1 : NULL);
+    buf_str(b, ",\n  \"flags\": [");
+    for (int i = 0; i < m->row_count; i++) {
+        const UsageRow *r = &m->rows[i];
+        const UsageSection *sec = &m->sections[r->section];
+        buf_str(b, i ? ",\n    {\"names\": [" : "\n    {\"names\": [");
+        for (int n = 0; n < r->info->name_count; n++) {
+            if (n) buf_add(b, ", ", 2);
+            json_str(b, r->info->names[n]);
+        }
+        buf_str(b, "], \"type\": ");
+        json_str(b, r->flag->type == TYPE_BOOL ? "bool" : type_name(r->flag));
+        buf_str(b, r->flag->supports_multiple ? ", \"multiple\": true" : ", \"multiple\": false");
+        buf_str(b, ", \"default\": ");
+        json_str(b, r->def == (size_t)-1 ? NULL : model_at(m, r->def));
+        buf_str(b, ", \"help\": ");
+        json_str(b, r->info->help);
+        buf_str(b, ", \"group\": ");
+        json_str(b, r->info->group ? r->info->group->name : NULL);
+        buf_str(b, sec->title && !sec->title[0] ? ", \"global\": true}" : ", \"global\": false}");
+    }
+    buf_str(b, m->row_count ? "\n  ],\n  \"commands\": [" : "],\n  \"commands\": [");
+    for (int i = 0; i < m->leaf->command_count; i++) {
+        buf_str(b, i ? ",\n    {\"name\": " : "\n    {\"name\": ");
+        json_str(b, m->leaf->commands[i]->name);
+        buf_str(b, ", \"help\": ");
+        json_str(b, m->leaf->commands[i]->help);
+        buf_add(b, "}", 1);
+    }
+    buf_str(b, m->leaf->command_count ? "\n  ]\n}\n" : "]\n}\n");
+}
+
+// Text escaped for roff, a leading . or ' would start a request
+static void roff_str(UsageBuf *b, const char *s, int line_start) {
+    if (line_start && (*s == '.' || *s == '\'')) buf_add(b, "\\&", 2);
+    for (; *s; s++) {
+        if (*s == '\\') buf_add(b, "\\e", 2);
+        else if (*s == '-') buf_add(b, "\\-", 2);
+        else buf_add(b, s, 1);
+    }
+}
+
+static void man_row(UsageBuf *b, const UsageModel *m, const UsageRow *r) {
+    buf_str(b, ".TP\n");
+    for (int n = 0; n < r->info->name_count; n++) {
+        if (n) buf_add(b, ", ", 2);
+        buf_str(b, "\\fB");
+        roff_str(b, r->info->names[n], 0);
+        buf_str(b, "\\fR");
+    }
+    const char *type = type_name(r->flag);
+    if (type) {
+        buf_str(b, " \\fI");
+        buf_str(b, type);
+        buf_str(b, "\\fR");
+    }
+    buf_add(b, "\n", 1);
+    roff_str(b, r->info->help ? r->info->help : "", 1);
+    buf_str(b, " (default: ");
+    roff_str(b, r->def == (size_t)-1 ? "none" : model_at(m, r->def), 0);
+    buf_str(b, ")\n");
+}
+
+static void render_man(UsageBuf *b, const UsageModel *m, const char *progname) {
+    const char *path = model_at(m, m->path);
+    buf_str(b, ".TH \"");
+    for (const char *p = progname; *p; p++) { // Title in upper case, words joined by -
+        char c = *p >= 'a' && *p <= 'z' ? (char)(*p - 'a' + 'A') : *p;
+        if (c != '"') buf_add(b, &c, 1);
+    }
+    for (const char *p = path; *p; p++) {
+        char c = *p == ' ' ? '-' : *p >= 'a' && *p <= 'z' ? (char)(*p - 'a' + 'A') : *p;
+        if (c != '"') buf_add(b, &c, 1);
+    }
+    buf_str(b, "\" 1\n.SH NAME\n");
+    roff_str(b, progname, 1);
+    roff_str(b, path, 0);
+    buf_str(b, "\n.SH SYNOPSIS\n.B ");
+    roff_str(b, progname, 0);
+    roff_str(b, path, 0);
+    buf_str(b, m->leaf->command_count ? "\n[flags] <command> [flags]\n" : "\n[flags]\n");
+    buf_str(b, ".SH OPTIONS\n");
+    for (int s = 0; s < m->section_count; s++) {
+        const UsageSection *sec = &m->sections[s];
+        if (sec->title && !sec->title[0]) {
+            buf_str(b, ".SH \"GLOBAL OPTIONS\"\n");
+        } else if (sec->title) {
+            buf_str(b, ".SS \"");
+            roff_str(b, sec->title, 0);
+            buf_str(b, "\"\n");
+        } else if (s > 0) {
+            buf_str(b, ".SS \"Other options\"\n");
+        }
+        for (int i = sec->first; i < sec->first + sec->count; i++) man_row(b, m, &m->rows[i]);
+    }
+    if (m->leaf->command_count) {
+        buf_str(b, ".SH COMMANDS\n");
+        for (int i = 0; i < m->leaf->command_count; i++) {
+            buf_str(b, ".TP\n\\fB");
+            roff_str(b, m->leaf->commands[i]->name, 0);
+            buf_str(b, "\\fR\n");
+            roff_str(b, m->leaf->commands[i]->help, 1);
+            buf_add(b, "\n", 1);
+        }
+    }
+}
+
+// Registry generation of a set and every set above it
+static unsigned chain_generation(const FlagSet *set) {
+    unsigned sum = 0;
+    for (; set; set = set->parent) sum += set->generation;
+    return sum;
+}
+
+void ft_release_usage(FlagSet *set) {
+    UsageCache *c = set->usage;
+    if (!c) return;
+    model_free(&c->model);
+    for (int f = 0; f <= FLAG_USAGE_MAN; f++) free(c->text[f]);
+    free(c->progname);
+    free(c);
+    set->usage = NULL;
+}
+
+/**
+ * flagset_usage - Returns the usage of a set, rendering it only when needed.
+ *
+ * The usage describes the subcommand the last parse dispatched to, if any.
+ * The model and each format rendered from it are cached on @set until a
+ * flag, group or command is registered in the described set or above it,
+ * or another program name or command is asked for.
+ *
+ * @format: FLAG_USAGE_TEXT, FLAG_USAGE_JSON or FLAG_USAGE_MAN.
+ *
+ * Returns:
+ *   The rendering (valid until the cache is dropped), its length in *len
+ *   NULL for an unknown format
+ */
+const char *flagset_usage(FlagSet *set, const char *progname, int format, size_t *len) {
+    if (format < FLAG_USAGE_TEXT || format > FLAG_USAGE_MAN) return NULL;
+    const FlagSet *leaf = set;
+    while (leaf->active) leaf = leaf->active->set;
+    UsageCache *c = set->usage;
+    if (c && (c->leaf != leaf || c->generation != chain_generation(leaf) || strcmp(c->progname, progname) != 0)) {
+        ft_release_usage(set);
+        c = NULL;
+    }
+    if (!c) {
+        c = calloc(1, sizeof(UsageCache));
+        if (!c || !(c->progname = strdup(progname))) {
+            perror("malloc");
+            exit(1);
+        }
+        model_build(&c->model, set);
+        c->leaf = leaf;
+        c->generation = chain_generation(leaf);
+        set->usage = c;
+    }
+    if (!c->text[format]) {
+        UsageBuf b = { 0 };
+        if (format == FLAG_USAGE_TEXT) render_text(&b, &c->model, progname);
+        else if (format == FLAG_USAGE_JSON) render_json(&b, &c->model, progname);
+        else render_man(&b, &c->model, progname);
+        buf_add(&b, "", 1);
+        c->text[format] = b.data;
+        c->len[format] = b.len - 1;
+    }
+    if (len) *len = c->len[format];
+    return c->text[format];
+}
+
+const char *flag_usage(const char *progname, int format, size_t *len) {
+    return flagset_usage(ft_default_set(), progname, format, len);
+}
+
+/**
+ * flagset_write_usage - Writes the cached usage of a set to a descriptor.
+ *
+ * The whole rendering goes out in one write(2) unless the descriptor
+ * accepts less (a pipe), in which case the rest follows.
+ *
+ * Returns:
+ *   0 on success
+ *   -1 if the format is unknown or the write fails
+ */
+int flagset_write_usage(FlagSet *set, const char *progname, int format, int fd) {
+    size_t len;
+    const char *text = flagset_usage(set, progname, format, &len);
+    if (!text) return -1;
+    while (len) {
+        ssize_t n = write(fd, text, len);
+        if (n <= 0) return -1;
+        text += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int flag_write_usage(const char *progname, int format, int fd) {
+    return flagset_write_usage(ft_default_set(), progname, format, fd);
+}
+
+void flagset_print_usage(FlagSet *set, const char *progname) {
+    fflush(stdout); // Keep the order of anything printed before
+    flagset_write_usage(set, progname, FLAG_USAGE_TEXT, STDOUT_FILENO);
+}
+
+void print_flag_usage(const char *progname) {
+    flagset_print_usage(ft_default_set(), progname);
+}
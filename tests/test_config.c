@@ -0,0 +1,209 @@
+// Layering of config file, environment and command line across reloads
+
+#define _POSIX_C_SOURCE 200809L // setenv, mkdtemp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static char dir[] = "/tmp/flagtool-config-XXXXXX";
+static char path[64], tmp[64];
+
+// Replace the config file by rename, so reloads always notice the change
+static void write_config(const char *text) {
+    FILE *f = fopen(tmp, "w");
+    if (!f || fputs(text, f) < 0 || fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror(tmp);
+        exit(1);
+    }
+}
+
+// A boolean given on the command line stays set when the file's spelling changes
+static void test_bool_claimed_by_argv() {
+    FlagSet *set = flagset_new();
+    Flag *verbose = flagset_bool(set, 0, "Verbose", "--verbose", NULL);
+    write_config("verbose = false\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    char *argv[] = { "prog", "--verbose", NULL };
+    CHECK(flagset_parse(set, 2, argv) == 0);
+    CHECK(flag_get_bool(verbose) == 1);
+
+    write_config("verbose = no\n");
+    CHECK(flagset_reload_config(set) == 0);
+    CHECK(flag_get_bool(verbose) == 1);
+
+    write_config("verbose = yes\n# now true\n");
+    CHECK(flagset_reload_config(set) == 0);
+    CHECK(flag_get_bool(verbose) == 1);
+    flagset_free(set);
+}
+
+// --no- on the command line beats a config file that turns the flag on
+static void test_negated_bool_claimed_by_argv() {
+    FlagSet *set = flagset_new();
+    Flag *color = flagset_bool(set, 0, "Color", "--color", NULL);
+    write_config("color = on\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    CHECK(flag_get_bool(color) == 1);
+    char *argv[] = { "prog", "--no-color", NULL };
+    CHECK(flagset_parse(set, 2, argv) == 0);
+    CHECK(flag_get_bool(color) == 0);
+
+    write_config("color = true\n");
+    CHECK(flagset_reload_config(set) == 0);
+    CHECK(flag_get_bool(color) == 0);
+    flagset_free(set);
+}
+
+// Flags only the file sets follow every reload, flags of other layers never do
+static void test_env_and_argv_over_reloads() {
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "TCFG_");
+    Flag *port = flagset_int(set, 80, "Port", "--port", NULL);
+    Flag *level = flagset_int(set, 1, "Level", "--level", NULL);
+    Flag *debug = flagset_bool(set, 0, "Debug", "--debug", NULL);
+    Flag *tags = flagset_string_multi(set, NULL, "Tags", "--tag", NULL);
+    setenv("TCFG_PORT", "2000", 1);
+    setenv("TCFG_DEBUG", "yes", 1);
+
+    write_config("port = 1000\nlevel = 3\ndebug = no\ntag = a\ntag = b\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    CHECK(flagset_apply_env(set) == 0);
+    char *argv[] = { "prog", "--tag", "c", NULL };
+    CHECK(flagset_parse(set, 3, argv) == 0);
+    CHECK(flag_get_int(port) == 2000);
+    CHECK(flag_get_bool(debug) == 1);
+    CHECK(flag_get_int(level) == 3);
+    CHECK(flag_get_multi_count(tags) == 1 && strcmp(flag_get_string_multi(tags)[0], "c") == 0);
+
+    for (int round = 0; round < 3; round++) {
+        char text[128];
+        snprintf(text, sizeof(text), "port = %d\nlevel = %d\ndebug = off\ntag = d%d\n", 3000 + round, 5 + round, round);
+        write_config(text);
+        CHECK(flagset_reload_config(set) == 0);
+        CHECK(flag_get_int(port) == 2000);
+        CHECK(flag_get_bool(debug) == 1);
+        CHECK(flag_get_int(level) == 5 + round);
+        CHECK(flag_get_multi_count(tags) == 1 && strcmp(flag_get_string_multi(tags)[0], "c") == 0);
+    }
+
+    // A line removed puts a file-only flag back to its default
+    write_config("port = 1\n");
+    CHECK(flagset_reload_config(set) == 0);
+    CHECK(flag_get_int(level) == 1);
+
+    // A rejected version keeps the previous one
+    write_config("port = 9\nlevel = nope\n");
+    CHECK(flagset_reload_config(set) != 0);
+    CHECK(flag_get_int(level) == 1);
+
+    // After a reset every layer is gone until applied again
+    flagset_reset(set);
+    CHECK(flag_get_int(port) == 80 && flag_get_bool(debug) == 0);
+    write_config("port = 7\nlevel = 4\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    CHECK(flag_get_int(port) == 7 && flag_get_int(level) == 4);
+    CHECK(flagset_apply_env(set) == 0);
+    CHECK(flag_get_int(port) == 2000);
+    unsetenv("TCFG_PORT");
+    unsetenv("TCFG_DEBUG");
+    flagset_free(set);
+}
+
+// List values split inside the file stay right across many reloads, changed or not
+static void test_list_reloads() {
+    FlagSet *set = flagset_new();
+    Flag *paths = flag_separator(flagset_string_multi(set, NULL, "Paths", "--path", NULL), ';');
+    Flag *level = flagset_int(set, 1, "Level", "--level", NULL);
+    write_config("path = /a;/b;/c\nlevel = 2\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    CHECK(flag_get_multi_count(paths) == 3 && strcmp(flag_get_string_multi(paths)[2], "/c") == 0);
+
+    for (int round = 0; round < 200; round++) {
+        char text[128];
+        if (round % 3 == 0) { // Only the other line changes
+            snprintf(text, sizeof(text), "path = /a;/b;/c\nlevel = %d\n", round);
+        } else {
+            snprintf(text, sizeof(text), "path = /a;/r%d;/c\npath = /d\nlevel = 2\n", round);
+        }
+        write_config(text);
+        CHECK(flagset_reload_config(set) == 0);
+        const char **values = flag_get_string_multi(paths);
+        if (round % 3 == 0) {
+            CHECK(flag_get_multi_count(paths) == 3 && strcmp(values[1], "/b") == 0);
+            CHECK(flag_get_int(level) == round);
+        } else {
+            char expect[16];
+            snprintf(expect, sizeof(expect), "/r%d", round);
+            CHECK(flag_get_multi_count(paths) == 4 && strcmp(values[1], expect) == 0);
+            CHECK(strcmp(values[3], "/d") == 0 && values[4] == NULL);
+        }
+    }
+    flagset_free(set);
+}
+
+static Flag *jobs, *dry_run;
+
+static void build_flags(FlagSet *set, void *ctx) {
+    (void)ctx;
+    jobs = flagset_int(set, 1, "Jobs", "--jobs", NULL);
+    dry_run = flagset_bool(set, 0, "Dry run", "--dry-run", NULL);
+}
+
+// A command created during the parse gets the file's and the environment's values
+static void test_command_layers() {
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "TCFG_");
+    flagset_command(set, "build", "Build", build_flags, NULL);
+    setenv("TCFG_DRY_RUN", "1", 1);
+    write_config("build.jobs = 4\nbuild.dry-run = no\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    CHECK(flagset_apply_env(set) == 0);
+    char *argv[] = { "prog", "build", NULL };
+    CHECK(flagset_parse(set, 2, argv) == 0);
+    CHECK(flag_get_int(jobs) == 4);
+    CHECK(flag_get_bool(dry_run) == 1);
+
+    write_config("build.jobs = 6\nbuild.dry-run = no\n");
+    CHECK(flagset_reload_config(set) == 0);
+    CHECK(flag_get_int(jobs) == 6);
+    CHECK(flag_get_bool(dry_run) == 1);
+    unsetenv("TCFG_DRY_RUN");
+    flagset_free(set);
+}
+
+int main() {
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/app.conf", dir);
+    snprintf(tmp, sizeof(tmp), "%s/app.conf.tmp", dir);
+
+    test_bool_claimed_by_argv();
+    test_negated_bool_claimed_by_argv();
+    test_env_and_argv_over_reloads();
+    test_command_layers();
+    test_list_reloads();
+
+    unlink(path);
+    rmdir(dir);
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_config: all checks passed\n");
+    return 0;
+}
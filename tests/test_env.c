@@ -0,0 +1,144 @@
+// Environment layer: bound names, prefixes, priority of argv, repeated applies
+
+#define _POSIX_C_SOURCE 200809L // setenv, fileno
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+// Names bound explicitly and derived from the prefix, in every type
+static void test_binding() {
+    setenv("FTT_MAX_CONNS", "512", 1);
+    setenv("FTT_VERBOSE", "Yes", 1);
+    setenv("FTT_IDS", "1,2,3", 1);
+    setenv("FTT_TIMEOUT", "1m30s", 1);
+    setenv("CUSTOM_NAME", "svc", 1);
+    setenv("FTT_SKIPPED", "9", 1);
+
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "FTT_");
+    Flag *conns = flagset_int(set, 0, "Connections", "--max-conns", NULL);
+    Flag *verbose = flagset_bool(set, 0, "Verbose", "-v", "--verbose", NULL);
+    Flag *ids = flag_separator(flagset_int_multi(set, 0, "IDs", "--ids", NULL), ',');
+    Flag *timeout = flagset_duration(set, 0, "Timeout", "--timeout", NULL);
+    Flag *name = flag_env(flagset_string(set, "app", "Name", "--name", NULL), "CUSTOM_NAME");
+    Flag *skipped = flag_env(flagset_int(set, 1, "Opted out", "--skipped", NULL), "");
+    CHECK(flagset_apply_env(set) == 0);
+    CHECK(flag_get_int(conns) == 512);
+    CHECK(flag_get_bool(verbose) == 1);
+    CHECK(flag_get_multi_count(ids) == 3 && flag_get_int_multi(ids)[2] == 3);
+    CHECK(flag_get_duration(timeout) == 90000000000LL);
+    CHECK(strcmp(flag_get_string(name), "svc") == 0);
+    CHECK(flag_get_int(skipped) == 1);
+    flagset_free(set);
+}
+
+// The command line replaces scalar values and the environment's multi values
+static void test_argv_priority() {
+    setenv("FTT_PORT", "5", 1);
+    setenv("FTT_TAG", "env", 1);
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "FTT_");
+    Flag *port = flagset_int(set, 0, "Port", "--port", NULL);
+    Flag *tags = flagset_string_multi(set, "", "Tags", "--tag", NULL);
+    CHECK(flagset_apply_env(set) == 0);
+    char *argv[] = { "prog", "--port", "9", "--tag", "a", "--tag", "b", NULL };
+    CHECK(flagset_parse(set, 7, argv) == 0);
+    CHECK(flag_get_int(port) == 9);
+    CHECK(flag_get_multi_count(tags) == 2 && strcmp(flag_get_string_multi(tags)[0], "a") == 0);
+    flagset_free(set);
+}
+
+// A second apply, before or after parsing, changes nothing until a reset
+static void test_applied_once() {
+    setenv("FTT_PORT", "5", 1);
+    setenv("FTT_TAG", "env", 1);
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "FTT_");
+    Flag *port = flagset_int(set, 0, "Port", "--port", NULL);
+    Flag *tags = flagset_string_multi(set, "", "Tags", "--tag", NULL);
+    CHECK(flagset_apply_env(set) == 0);
+    CHECK(flagset_apply_env(set) == 0);
+    CHECK(flag_get_multi_count(tags) == 1);
+
+    char *argv[] = { "prog", "--port=9", "--tag=a", NULL };
+    CHECK(flagset_parse(set, 3, argv) == 0);
+    CHECK(flagset_apply_env(set) == 0);
+    CHECK(flag_get_int(port) == 9);
+    CHECK(flag_get_multi_count(tags) == 1 && strcmp(flag_get_string_multi(tags)[0], "a") == 0);
+
+    flagset_reset(set);
+    CHECK(flag_get_int(port) == 0 && flag_get_multi_count(tags) == 0);
+    CHECK(flagset_apply_env(set) == 0);
+    CHECK(flag_get_int(port) == 5 && flag_get_multi_count(tags) == 1);
+    flagset_free(set);
+}
+
+// A variable that does not convert is reported with its code
+static void test_bad_value() {
+    setenv("FTT_COUNT", "many", 1);
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "FTT_");
+    Flag *count = flagset_int(set, 3, "Count", "--count", NULL);
+    fflush(stderr);
+    int saved = dup(2);
+    FILE *null = fopen("/dev/null", "w");
+    if (saved < 0 || !null || dup2(fileno(null), 2) < 0) {
+        perror("/dev/null");
+        exit(1);
+    }
+    int rc = flagset_apply_env(set);
+    fflush(stderr);
+    dup2(saved, 2);
+    close(saved);
+    fclose(null);
+    CHECK(rc == FLAG_ERR_BAD_VALUE);
+    CHECK(flag_get_int(count) == 3);
+    flagset_free(set);
+    unsetenv("FTT_COUNT");
+}
+
+// Commands created after the apply take the environment with the parent's prefix
+static void init_build(FlagSet *set, void *ctx) {
+    *(Flag **)ctx = flagset_int(set, 1, "Jobs", "--jobs", NULL);
+}
+
+static void test_command() {
+    setenv("FTT_JOBS", "8", 1);
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "FTT_");
+    Flag *jobs = NULL;
+    FlagCommand *build = flagset_command(set, "build", "Build", init_build, &jobs);
+    CHECK(flagset_apply_env(set) == 0);
+    char *argv[] = { "prog", "build", NULL };
+    CHECK(flagset_parse(set, 2, argv) == 0);
+    CHECK(flagset_active_command(set) == build);
+    CHECK(jobs && flag_get_int(jobs) == 8);
+    flagset_free(set);
+}
+
+int main() {
+    test_binding();
+    test_argv_priority();
+    test_applied_once();
+    test_bad_value();
+    test_command();
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_env: all checks passed\n");
+    return 0;
+}
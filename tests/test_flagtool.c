@@ -3,8 +3,8 @@
 
 int main(int argc, char *argv[]) {
     // Define flags
-    Flag *flagName = flag_string("World", "Name to greet", "--name");
-    Flag *flagVerbose = flag_bool(0, "Enable verbose output", "--verbose");
+    Flag *flagName = flag_string("World", "Name to greet", "--name", NULL);
+    Flag *flagVerbose = flag_bool(0, "Enable verbose output", "--verbose", NULL);
     Flag *flagCount = flag_int_multi(1, "Number of greetings", "--count", "-c", NULL);
 
     // Parse command line flags
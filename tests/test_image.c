@@ -0,0 +1,227 @@
+// Snapshot images: write, map, read back, and what mapped flags refuse
+
+#define _POSIX_C_SOURCE 200809L // mkdtemp, fileno
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static char dir[] = "/tmp/flagtool-image-XXXXXX";
+static char path[64], tmp[64];
+
+// Register the supervisor's schema and parse a command line into it
+static FlagSet *supervisor() {
+    FlagSet *set = flagset_new();
+    flagset_string(set, "app", "Name", "--name", "-n", NULL);
+    flagset_bool(set, 0, "Verbose", "--verbose", "-v", NULL);
+    flagset_bool(set, 1, "Color", "--color", NULL);
+    flagset_int(set, 80, "Port", "--port", "-p", NULL);
+    flagset_int64(set, 0, "Offset", "--offset", NULL);
+    flagset_double(set, 0.5, "Ratio", "--ratio", NULL);
+    flagset_size(set, 0, "Memory", "--mem", NULL);
+    flagset_duration(set, 0, "Timeout", "--timeout", NULL);
+    flagset_string_multi(set, "", "Tags", "--tag", "-t", NULL);
+    flag_separator(flagset_int_multi(set, 0, "IDs", "--ids", NULL), ',');
+    flagset_double_multi(set, 0, "Weights", "--weight", NULL);
+    flagset_string(set, "", "Only in the image", "--image-only", NULL);
+    char *argv[] = { "sup", "-n", "web", "-v", "--no-color", "--port=8080", "--offset=-5000000000",
+                     "--ratio=0.25", "--mem=2MiB", "--timeout=1m", "-t", "a", "--tag=b",
+                     "--ids=4,8,15", "--weight=1.5", "--image-only=yes", NULL };
+    if (flagset_parse(set, 16, argv) != 0) {
+        fprintf(stderr, "supervisor parse failed\n");
+        exit(1);
+    }
+    return set;
+}
+
+// Every value read through a set that has only the image
+static void check_mapped(FlagSet *worker) {
+    CHECK(strcmp(flag_get_string(flagset_find(worker, "-n")), "web") == 0);
+    CHECK(flag_get_bool(flagset_find(worker, "--verbose")) == 1);
+    CHECK(flag_get_bool(flagset_find(worker, "--no-color")) == 0);
+    CHECK(flag_get_int(flagset_find(worker, "-p")) == 8080);
+    CHECK(flag_get_int64(flagset_find(worker, "--offset")) == -5000000000LL);
+    CHECK(flag_get_double(flagset_find(worker, "--ratio")) == 0.25);
+    CHECK(flag_get_size(flagset_find(worker, "--mem")) == 2u << 20);
+    CHECK(flag_get_duration(flagset_find(worker, "--timeout")) == 60000000000LL);
+    Flag *tags = flagset_find(worker, "--tag");
+    CHECK(flag_get_multi_count(tags) == 2);
+    CHECK(strcmp(flag_get_string_multi(tags)[1], "b") == 0 && flag_get_string_multi(tags)[2] == NULL);
+    Flag *ids = flagset_find(worker, "--ids");
+    CHECK(flag_get_multi_count(ids) == 3 && flag_get_int_multi(ids)[2] == 15);
+    CHECK(flag_get_double_multi(flagset_find(worker, "--weight"))[0] == 1.5);
+    CHECK(flagset_find(worker, "--missing") == NULL);
+}
+
+// Write, map into an empty set, read everything back
+static void test_round_trip() {
+    FlagSet *set = supervisor();
+    CHECK(flagset_write_image(set, path) == 0);
+    FlagSet *worker = flagset_new();
+    CHECK(flagset_map_image(worker, path) == 0);
+    check_mapped(worker);
+    flagset_free(worker);
+    flagset_free(set);
+}
+
+// A frozen registry whose hash table was freed still writes every name
+static void test_frozen_registry() {
+    FlagSet *set = supervisor();
+    CHECK(flagset_freeze(set) == 0);
+    flagset_free_hash_table(set);
+    CHECK(flagset_write_image(set, path) == 0);
+    FlagSet *worker = flagset_new();
+    CHECK(flagset_map_image(worker, path) == 0);
+    check_mapped(worker);
+    flagset_free(worker);
+    flagset_free(set);
+}
+
+// Flags the worker registers itself take the image's values
+static void test_registered_flags() {
+    FlagSet *set = supervisor();
+    CHECK(flagset_write_image(set, path) == 0);
+    flagset_free(set);
+
+    FlagSet *worker = flagset_new();
+    int verbose = 0;
+    Flag *port = flagset_int(worker, 80, "Port", "--port", NULL);
+    Flag *tags = flagset_string_multi(worker, "", "Tags", "--tag", NULL);
+    Flag *name = flagset_int(worker, 7, "Name, but an int here", "--name", NULL);
+    CHECK(flagset_map_image(worker, path) == 0);
+    Flag *verbose_flag = flagset_bool_var(worker, &verbose, 0, "Verbose", "--verbose", NULL); // After mapping
+    Flag *ids = flagset_int_multi(worker, 0, "IDs", "--ids", NULL);
+    CHECK(flagset_find(worker, "--port") == port);
+    CHECK(flag_get_int(port) == 8080);
+    CHECK(flag_get_multi_count(tags) == 2 && strcmp(flag_get_string_multi(tags)[0], "a") == 0);
+    CHECK(flag_get_int(name) == 7); // Type differs, the default stays
+    CHECK(flag_get_bool(verbose_flag) == 1 && verbose == 1);
+    CHECK(flag_get_multi_count(ids) == 3 && flag_get_int_multi(ids)[1] == 8);
+
+    char *argv[] = { "worker", "--port=9", NULL };
+    CHECK(flagset_parse(worker, 2, argv) == 0);
+    CHECK(flag_get_int(port) == 9);
+    flagset_reset(worker);
+    CHECK(flag_get_int(port) == 80 && flag_get_multi_count(tags) == 0 && verbose == 0);
+    flagset_free(worker);
+}
+
+static void on_string(const char *value, size_t len, void *ctx) {
+    (void)value, (void)len;
+    (*(int *)ctx)++;
+}
+
+static void on_int(int value, void *ctx) {
+    (void)value;
+    (*(int *)ctx)++;
+}
+
+// Calls that change a flag leave the read-only mapped flags alone
+static void test_mapped_flags_refuse_changes() {
+    FlagSet *set = supervisor();
+    CHECK(flagset_write_image(set, path) == 0);
+    flagset_free(set);
+
+    FlagSet *worker = flagset_new();
+    CHECK(flagset_map_image(worker, path) == 0);
+    Flag *tags = flagset_find(worker, "--tag"), *ids = flagset_find(worker, "--ids");
+    Flag *only = flagset_find(worker, "--image-only");
+    int calls = 0;
+    CHECK(flag_reserve(tags, 100) == tags);
+    CHECK(flag_separator(tags, ';') == tags);
+    CHECK(flag_on_string(tags, on_string, &calls) == tags);
+    CHECK(flag_on_int(ids, on_int, &calls) == ids);
+    CHECK(flag_env(only, "FLAGTOOL_IMAGE_ONLY") == only);
+    FlagGroup *group = flagset_create_group(worker, "Mapped");
+    add_flag_to_group(group, only);
+    flag_free(tags);
+    CHECK(flag_get_multi_count(tags) == 2 && strcmp(flag_get_string_multi(tags)[0], "a") == 0);
+    CHECK(flag_get_multi_count(ids) == 3);
+    CHECK(strcmp(flag_get_string(only), "yes") == 0);
+    CHECK(calls == 0);
+    flagset_free(worker);
+}
+
+// A damaged file is refused instead of read out of bounds
+static void test_damaged_image() {
+    FlagSet *set = supervisor();
+    CHECK(flagset_write_image(set, path) == 0);
+    flagset_free(set);
+    FILE *in = fopen(path, "rb");
+    static char data[1 << 16];
+    size_t len = in ? fread(data, 1, sizeof(data), in) : 0;
+    if (in) fclose(in);
+    CHECK(len > 64 && len < sizeof(data));
+
+    fflush(stderr);
+    int saved = dup(2);
+    FILE *null = fopen("/dev/null", "w");
+    if (saved < 0 || !null || dup2(fileno(null), 2) < 0) {
+        perror("/dev/null");
+        exit(1);
+    }
+    for (int damage = 0; damage < 3; damage++) {
+        FILE *out = fopen(tmp, "wb");
+        if (!out) {
+            perror(tmp);
+            exit(1);
+        }
+        if (damage == 0) {
+            fwrite(data, 1, len / 2, out); // Truncated
+        } else if (damage == 1) {
+            fwrite(data, 1, len, out);
+            fwrite("x", 1, 1, out); // Size differs from the header
+        } else {
+            memset(data + 40, 0xff, 8); // Section offset far outside the file
+            fwrite(data, 1, len, out);
+        }
+        if (fclose(out) != 0 || rename(tmp, path) != 0) {
+            perror(path);
+            exit(1);
+        }
+        FlagSet *worker = flagset_new();
+        CHECK(flagset_map_image(worker, path) != 0);
+        CHECK(flagset_find(worker, "--port") == NULL);
+        flagset_free(worker);
+    }
+    fflush(stderr);
+    dup2(saved, 2);
+    close(saved);
+    fclose(null);
+}
+
+int main() {
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/flags.img", dir);
+    snprintf(tmp, sizeof(tmp), "%s/flags.img.new", dir);
+
+    test_round_trip();
+    test_frozen_registry();
+    test_registered_flags();
+    test_mapped_flags_refuse_changes();
+    test_damaged_image();
+
+    unlink(path);
+    rmdir(dir);
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_image: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Separated int lists: the bulk list parser against one value per argument
+//
+// Random lists (long enough to span several 64-byte blocks, with signs,
+// leading zeros, values at and past the int limits, empty elements and
+// stray characters) are parsed as one --ids=... argument and, element by
+// element, as --one=... arguments of a flag without a separator. Both must
+// accept or reject the list alike and store the same values.
+//
+// Usage: test_intlist [seed [cases]]
+
+#define _POSIX_C_SOURCE 200809L // fileno
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static unsigned long long state;
+
+// xorshift64*, reproducible from the seed
+static unsigned rnd(unsigned n) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (unsigned)((state * 2685821657736338717ULL) >> 33) % n;
+}
+
+// Parse with stderr sent to /dev/null, bad lists are expected here
+static int quiet_parse(FlagSet *set, int argc, char **argv) {
+    fflush(stderr);
+    int saved = dup(2);
+    FILE *null = fopen("/dev/null", "w");
+    if (saved < 0 || !null || dup2(fileno(null), 2) < 0) {
+        perror("/dev/null");
+        exit(1);
+    }
+    int rc = flagset_parse(set, argc, argv);
+    fflush(stderr);
+    dup2(saved, 2);
+    close(saved);
+    fclose(null);
+    return rc;
+}
+
+// Append one random element to buf at *len
+static void random_element(char *buf, size_t *len) {
+    char el[32];
+    switch (rnd(40)) {
+    case 0: el[0] = '\0'; break;                                         // Empty
+    case 1: snprintf(el, sizeof(el), "%u%c", rnd(1000), "x .e"[rnd(4)]); break; // Stray character
+    case 2: snprintf(el, sizeof(el), "%d", INT_MAX); break;
+    case 3: snprintf(el, sizeof(el), "%d", INT_MIN); break;
+    case 4: snprintf(el, sizeof(el), "%lld", (long long)INT_MAX + 1); break; // Out of range
+    case 5: snprintf(el, sizeof(el), "%lld", (long long)INT_MIN - 1); break;
+    case 6: snprintf(el, sizeof(el), "+%u", rnd(100000)); break;
+    case 7: snprintf(el, sizeof(el), "000000000000%u", rnd(1000)); break;  // Leading zeros past 10 digits
+    case 8: snprintf(el, sizeof(el), "-"); break;
+    case 9: snprintf(el, sizeof(el), "%u%u", rnd(100000), rnd(1000000)); break; // 9 to 11 digits
+    default: {
+        int digits = 1 + (int)rnd(9);
+        long long v = 0;
+        for (int i = 0; i < digits; i++) v = v * 10 + rnd(10);
+        snprintf(el, sizeof(el), "%s%lld", rnd(3) ? "" : "-", v);
+    }
+    }
+    memcpy(buf + *len, el, strlen(el));
+    *len += strlen(el);
+}
+
+static void differential(unsigned long long seed, int cases) {
+    state = seed ? seed : 1;
+    FlagSet *list = flagset_new();
+    Flag *ids = flag_separator(flagset_int_multi(list, 0, "IDs", "--ids", NULL), ',');
+    FlagSet *single = flagset_new();
+    Flag *one = flagset_int_multi(single, 0, "One ID", "--one", NULL);
+
+    static char buf[4096], arg[4200];
+    static char *elements[512], *argv[514];
+    static char pieces[512][48];
+    for (int c = 0; c < cases; c++) {
+        int n = 1 + (int)rnd(c % 4 == 0 ? 200 : 12), clean = rnd(2);
+        size_t len = 0;
+        for (int i = 0; i < n; i++) {
+            if (i) buf[len++] = ',';
+            size_t start = len;
+            if (clean) { // Mostly valid lists, so values get compared
+                snprintf(pieces[i], sizeof(pieces[i]), "%d", (int)rnd(2000000) - 1000000);
+                memcpy(buf + len, pieces[i], strlen(pieces[i]));
+                len += strlen(pieces[i]);
+            } else {
+                random_element(buf, &len);
+            }
+            elements[i] = pieces[i];
+            memcpy(pieces[i], buf + start, len - start);
+            pieces[i][len - start] = '\0';
+        }
+        buf[len] = '\0';
+
+        snprintf(arg, sizeof(arg), "--ids=%s", buf);
+        char *largv[] = { "prog", arg, NULL };
+        int list_rc = quiet_parse(list, 2, largv);
+
+        argv[0] = "prog";
+        for (int i = 0; i < n; i++) {
+            static char one_args[512][56];
+            snprintf(one_args[i], sizeof(one_args[i]), "--one=%s", elements[i]);
+            argv[i + 1] = one_args[i];
+        }
+        argv[n + 1] = NULL;
+        int single_rc = quiet_parse(single, n + 1, argv);
+
+        if ((list_rc != 0) != (single_rc != 0)) {
+            fprintf(stderr, "seed %llu case %d: list rc %d, single rc %d for %s\n", seed, c, list_rc, single_rc, buf);
+            failures++;
+        } else if (list_rc != 0) {
+            CHECK(flag_get_multi_count(ids) == 0); // A bad list adds nothing
+        } else {
+            int count = flag_get_multi_count(ids);
+            CHECK(count == n && flag_get_multi_count(one) == n);
+            const int *a = flag_get_int_multi(ids), *b = flag_get_int_multi(one);
+            for (int i = 0; i < count && i < n; i++) {
+                if (a[i] != b[i]) {
+                    fprintf(stderr, "seed %llu case %d: element %d is %d, expected %d\n", seed, c, i, a[i], b[i]);
+                    failures++;
+                    break;
+                }
+            }
+        }
+        flagset_reset(list);
+        flagset_reset(single);
+    }
+    flagset_free(list);
+    flagset_free(single);
+}
+
+// Separators that can be part of a value are ignored
+static void test_separator_rejected() {
+    FlagSet *set = flagset_new();
+    Flag *dash = flag_separator(flagset_int_multi(set, 0, "Dash", "--dash", NULL), '-');
+    Flag *digit = flag_separator(flagset_int_multi(set, 0, "Digit", "--digit", NULL), '5');
+    Flag *nul = flag_separator(flagset_string_multi(set, "", "Nul", "--nul", NULL), '\0');
+    Flag *exp = flag_separator(flagset_double_multi(set, 0, "Exp", "--exp", NULL), 'e');
+    Flag *semi = flag_separator(flagset_string_multi(set, "", "Semi", "--semi", NULL), ';');
+    char *argv[] = { "prog", "--dash=-7", "--digit=152", "--nul=a", "--exp=1e3", "--semi=a;b", NULL };
+    CHECK(flagset_parse(set, 6, argv) == 0);
+    CHECK(flag_get_multi_count(dash) == 1 && flag_get_int_multi(dash)[0] == -7);
+    CHECK(flag_get_multi_count(digit) == 1 && flag_get_int_multi(digit)[0] == 152);
+    CHECK(flag_get_multi_count(nul) == 1);
+    CHECK(flag_get_multi_count(exp) == 1 && flag_get_double_multi(exp)[0] == 1000.0);
+    CHECK(flag_get_multi_count(semi) == 2);
+    flagset_free(set);
+}
+
+// Before any value, and after a bad list, the arrays are empty but not NULL
+static void test_empty_arrays() {
+    FlagSet *set = flagset_new();
+    Flag *ids = flag_separator(flagset_int_multi(set, 0, "IDs", "--ids", NULL), ',');
+    Flag *ratios = flagset_double_multi(set, 0, "Ratios", "--ratio", NULL);
+    Flag *tags = flagset_string_multi(set, "", "Tags", "--tag", NULL);
+    CHECK(flag_get_int_multi(ids) != NULL && flag_get_double_multi(ratios) != NULL);
+    CHECK(flag_get_string_multi(tags) != NULL && flag_get_string_multi(tags)[0] == NULL);
+    char *argv[] = { "prog", "--ids=1,,2", NULL };
+    CHECK(quiet_parse(set, 2, argv) != 0);
+    CHECK(flag_get_multi_count(ids) == 0 && flag_get_int_multi(ids) != NULL);
+    flag_free(ids);
+    CHECK(flag_get_int_multi(ids) != NULL);
+    flagset_free(set);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 20261017;
+    int cases = argc > 2 ? atoi(argv[2]) : 3000;
+    test_separator_rejected();
+    test_empty_arrays();
+    differential(seed, cases);
+    if (failures) {
+        fprintf(stderr, "test_intlist: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_intlist: all checks passed\n");
+    return 0;
+}
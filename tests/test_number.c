@@ -0,0 +1,245 @@
+// Numeric values: range errors, sizes, durations, and doubles against strtod
+//
+// Random decimals (%.17g of random bit patterns, long digit strings with
+// any exponent, exact halfway points between neighbouring doubles and
+// numbers just above and below them) are parsed as --d=... and compared
+// bit for bit with glibc's correctly rounded strtod().
+//
+// Usage: test_number [seed [cases]]
+
+#define _POSIX_C_SOURCE 200809L // fileno
+
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static unsigned long long state;
+
+// xorshift64*, reproducible from the seed
+static uint64_t rnd64() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+static unsigned rnd(unsigned n) {
+    return (unsigned)(rnd64() >> 33) % n;
+}
+
+static FlagSet *set;
+static Flag *d_flag, *i_flag, *i64_flag, *size_flag, *dur_flag;
+
+// Parse one --name=value with stderr sent to /dev/null, bad values are expected here
+static int parse(const char *name, const char *value) {
+    static char arg[2048];
+    snprintf(arg, sizeof(arg), "%s=%s", name, value);
+    char *argv[] = { "prog", arg, NULL };
+    fflush(stderr);
+    int saved = dup(2);
+    FILE *null = fopen("/dev/null", "w");
+    if (saved < 0 || !null || dup2(fileno(null), 2) < 0) {
+        perror("/dev/null");
+        exit(1);
+    }
+    flagset_reset(set);
+    int rc = flagset_parse(set, 2, argv);
+    fflush(stderr);
+    dup2(saved, 2);
+    close(saved);
+    fclose(null);
+    return rc;
+}
+
+static void test_ints() {
+    CHECK(parse("--i", "2147483647") == 0 && flag_get_int(i_flag) == 2147483647);
+    CHECK(parse("--i", "-2147483648") == 0 && flag_get_int(i_flag) == -2147483647 - 1);
+    CHECK(parse("--i", "2147483648") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--i", "-2147483649") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--i64", "9223372036854775807") == 0 && flag_get_int64(i64_flag) == INT64_MAX);
+    CHECK(parse("--i64", "-9223372036854775808") == 0 && flag_get_int64(i64_flag) == INT64_MIN);
+    CHECK(parse("--i64", "9223372036854775808") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--i64", "99999999999999999999999") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--i64", "12x") == FLAG_ERR_BAD_VALUE);
+    CHECK(parse("--i64", "99999999999999999999x") == FLAG_ERR_BAD_VALUE); // Malformed beats too large
+    CHECK(parse("--i64", "") == FLAG_ERR_BAD_VALUE);
+}
+
+static void test_sizes() {
+    CHECK(parse("--size", "512") == 0 && flag_get_size(size_flag) == 512);
+    CHECK(parse("--size", "4K") == 0 && flag_get_size(size_flag) == 4096);
+    CHECK(parse("--size", "1.5GiB") == 0 && flag_get_size(size_flag) == 3ULL << 29);
+    CHECK(parse("--size", "2MB") == 0 && flag_get_size(size_flag) == 2ULL << 20);
+    CHECK(parse("--size", "1b") == 0 && flag_get_size(size_flag) == 1);
+    CHECK(parse("--size", "15E") == 0 && flag_get_size(size_flag) == 15ULL << 60);
+    CHECK(parse("--size", "16E") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--size", "18446744073709551616") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--size", "18446744073709551615") == 0 && flag_get_size(size_flag) == UINT64_MAX);
+    CHECK(parse("--size", "1X") == FLAG_ERR_BAD_VALUE);
+    CHECK(parse("--size", "-1K") == FLAG_ERR_BAD_VALUE);
+    CHECK(parse("--size", "K") == FLAG_ERR_BAD_VALUE);
+}
+
+static void test_durations() {
+    CHECK(parse("--dur", "250ms") == 0 && flag_get_duration(dur_flag) == 250000000);
+    CHECK(parse("--dur", "1.5s") == 0 && flag_get_duration(dur_flag) == 1500000000);
+    CHECK(parse("--dur", "1h30m") == 0 && flag_get_duration(dur_flag) == 5400000000000LL);
+    CHECK(parse("--dur", "-2m") == 0 && flag_get_duration(dur_flag) == -120000000000LL);
+    CHECK(parse("--dur", "1.5\xc2\xb5s") == 0 && flag_get_duration(dur_flag) == 1500);
+    CHECK(parse("--dur", "0") == 0 && flag_get_duration(dur_flag) == 0);
+    CHECK(parse("--dur", "9223372036854775807ns") == 0 && flag_get_duration(dur_flag) == INT64_MAX);
+    CHECK(parse("--dur", "-9223372036854775808ns") == 0 && flag_get_duration(dur_flag) == INT64_MIN);
+    CHECK(parse("--dur", "9223372036854775808ns") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--dur", "3000000h") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--dur", "1") == FLAG_ERR_BAD_VALUE); // No unit
+    CHECK(parse("--dur", "1d") == FLAG_ERR_BAD_VALUE);
+    CHECK(parse("--dur", "1h-5m") == FLAG_ERR_BAD_VALUE);
+}
+
+static uint64_t bits_of(double d) {
+    uint64_t b;
+    memcpy(&b, &d, sizeof(b));
+    return b;
+}
+
+// Expect exactly strtod's double, or a range error where it overflows
+static void compare(const char *text) {
+    errno = 0;
+    double want = strtod(text, NULL);
+    int overflow = errno == ERANGE && isinf(want);
+    int rc = parse("--d", text);
+    if (overflow ? rc != FLAG_ERR_OUT_OF_RANGE : rc != 0 || bits_of(flag_get_double(d_flag)) != bits_of(want)) {
+        fprintf(stderr, "%s: rc %d, got %.17g, strtod %.17g\n", text, rc, rc ? 0.0 : flag_get_double(d_flag), want);
+        failures++;
+    }
+}
+
+static void test_double_edges() {
+    CHECK(parse("--d", "1e999") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--d", "-1e999") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--d", "1e-999") == 0 && flag_get_double(d_flag) == 0);
+    CHECK(parse("--d", "0e999") == 0 && flag_get_double(d_flag) == 0);
+    CHECK(parse("--d", "-0") == 0 && signbit(flag_get_double(d_flag)));
+    CHECK(parse("--d", "+.5") == 0 && flag_get_double(d_flag) == 0.5);
+    CHECK(parse("--d", "1.7976931348623157e308") == 0 && flag_get_double(d_flag) == DBL_MAX);
+    CHECK(parse("--d", "1.7976931348623159e308") == FLAG_ERR_OUT_OF_RANGE);
+    CHECK(parse("--d", "4.9406564584124654e-324") == 0 && flag_get_double(d_flag) == 4.9406564584124654e-324);
+    CHECK(parse("--d", "2.4703282292062327e-324") == 0 && flag_get_double(d_flag) == 0); // Below half the smallest
+    CHECK(parse("--d", "2.4703282292062328e-324") == 0 && flag_get_double(d_flag) > 0);
+    const char *bad[] = { "inf", "nan", "0x1p3", ".", "1e", "1e+", "1.2.3", "--1", "1 ", "", NULL };
+    for (int i = 0; bad[i]; i++) CHECK(parse("--d", bad[i]) == FLAG_ERR_BAD_VALUE);
+    compare("9007199254740993");       // 2^53 + 1, a tie rounded to even
+    compare("9007199254740993.0000000000000000000001");
+    compare("179769313486231580793728971405301e276"); // Halfway above DBL_MAX
+    compare("2.2250738585072011e-308"); // Largest subnormal region
+    compare("2.2250738585072012e-308");
+}
+
+// A random decimal of one of several shapes into buf
+static void random_decimal(char *buf, size_t size) {
+    switch (rnd(5)) {
+    case 0: { // Any finite double, printed to round trip
+        double d;
+        uint64_t b;
+        do {
+            b = rnd64();
+            memcpy(&d, &b, sizeof(d));
+        } while (!isfinite(d));
+        snprintf(buf, size, "%.17g", d);
+        break;
+    }
+    case 1: { // Digits with a point somewhere and any exponent
+        int n = 1 + (int)rnd(40), point = (int)rnd((unsigned)n + 1);
+        size_t len = 0;
+        for (int i = 0; i < n; i++) {
+            if (i == point && i) buf[len++] = '.';
+            buf[len++] = (char)('0' + rnd(10));
+        }
+        snprintf(buf + len, size - len, "e%d", (int)rnd(700) - 360);
+        break;
+    }
+#if LDBL_MANT_DIG >= 64
+    case 2:
+    case 3: { // Halfway between two neighbours, exactly or with a nudge in the last digit
+        double d, next;
+        uint64_t b;
+        do {
+            b = rnd64() >> 1; // Positive, so the next double up is b + 1
+        } while ((b + 1) >> 52 == 0x7ff);
+        memcpy(&d, &b, sizeof(d));
+        b++;
+        memcpy(&next, &b, sizeof(next));
+        long double half = ((long double)d + next) / 2; // Exact with 64 bits
+        int len = snprintf(buf, size, "%.*Le", 40 + (int)rnd(760), half);
+        if (len >= (int)size) len = (int)size - 1;
+        int nudge = rnd(3);
+        char *e = strchr(buf, 'e');
+        if (nudge && e && e[-1] != '.') {
+            char *last = e - 1;
+            if (nudge == 1 && *last < '9') (*last)++;
+            else if (nudge == 2 && *last > '0') (*last)--;
+        }
+        break;
+    }
+#endif
+    default: { // Hundreds of digits, past what the exact path keeps
+        int n = 700 + (int)rnd(300);
+        size_t len = 0;
+        buf[len++] = (char)('1' + rnd(9));
+        buf[len++] = '.';
+        int zeros = rnd(2);
+        for (int i = 1; i < n && len < size - 16; i++) buf[len++] = zeros && i < n - 1 ? '0' : (char)('0' + rnd(10));
+        snprintf(buf + len, size - len, "e%d", (int)rnd(640) - 320);
+    }
+    }
+}
+
+static void differential(unsigned long long seed, int cases) {
+    state = seed ? seed : 1;
+    static char buf[1200];
+    for (int c = 0; c < cases; c++) {
+        random_decimal(buf, sizeof(buf));
+        compare(buf);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 20261017;
+    int cases = argc > 2 ? atoi(argv[2]) : 50000;
+    set = flagset_new();
+    d_flag = flagset_double(set, 0, "Double", "--d", NULL);
+    i_flag = flagset_int(set, 0, "Int", "--i", NULL);
+    i64_flag = flagset_int64(set, 0, "Int64", "--i64", NULL);
+    size_flag = flagset_size(set, 0, "Size", "--size", NULL);
+    dur_flag = flagset_duration(set, 0, "Duration", "--dur", NULL);
+
+    test_ints();
+    test_sizes();
+    test_durations();
+    test_double_edges();
+    differential(seed, cases);
+
+    flagset_free(set);
+    if (failures) {
+        fprintf(stderr, "test_number: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_number: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,459 @@
+// Randomized differential test: flagset_parse_parallel() against flagset_parse()
+//
+// Each case builds the same schema twice, loads the same config file and
+// environment into both sets, parses one random command line serially into
+// one and in parallel into the other, and compares the return code, the
+// message printed and every value. Command lines are long enough to be cut
+// into chunks, and mix separated lists, @files (nested, large enough to be
+// parsed in parallel themselves) and sometimes one bad argument anywhere.
+//
+// Usage: test_parallel [seed [cases]]
+
+#define _POSIX_C_SOURCE 200809L // setenv, mkdtemp, fileno
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+enum { T_STRING, T_BOOL, T_INT, T_INT64, T_DOUBLE, T_SIZE, T_DURATION, T_STRING_MULTI, T_INT_MULTI, T_DOUBLE_MULTI, T_UINT64_MULTI };
+
+// One flag of the schema, registered the same way in both sets
+typedef struct Spec {
+    const char *name;
+    const char *alias;
+    int type;
+    char separator;
+    int interned;
+} Spec;
+
+static const Spec specs[] = {
+    { "--name", "-n", T_STRING, 0, 0 },
+    { "--verbose", "-v", T_BOOL, 0, 0 },
+    { "--version", NULL, T_BOOL, 0, 0 },
+    { "--count", "-c", T_INT, 0, 0 },
+    { "--big", NULL, T_INT64, 0, 0 },
+    { "--ratio", NULL, T_DOUBLE, 0, 0 },
+    { "--mem", NULL, T_SIZE, 0, 0 },
+    { "--timeout", NULL, T_DURATION, 0, 0 },
+    { "--tag", "-t", T_STRING_MULTI, 0, 0 },
+    { "--id", NULL, T_INT_MULTI, ',', 0 },
+    { "--path", NULL, T_STRING_MULTI, ';', 0 },
+    { "--user", "-u", T_STRING_MULTI, 0, 1 },
+    { "--weight", NULL, T_DOUBLE_MULTI, 0, 0 },
+    { "--u64", NULL, T_UINT64_MULTI, 0, 0 },
+    { "--level", NULL, T_INT, 0, 0 }, // Bound to a variable
+};
+#define SPEC_COUNT (int)(sizeof(specs) / sizeof(specs[0]))
+#define LEVEL_SPEC (SPEC_COUNT - 1)
+
+typedef struct Side {
+    FlagSet *set;
+    Flag *flags[SPEC_COUNT];
+    int level;          // Variable bound to --level
+    int rc;
+    char *messages;     // What the parse printed to stderr
+} Side;
+
+static int failures = 0;
+static char dir[] = "/tmp/flagtool-parallel-XXXXXX";
+
+static uint64_t rng_state;
+
+static uint64_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int pick(int n) {
+    return (int)(rng() % (uint64_t)n);
+}
+
+// Arguments of one case, freed together
+typedef struct Args {
+    char **argv;
+    int argc;
+    int cap;
+} Args;
+
+static void push(Args *a, const char *s) {
+    if (a->argc == a->cap) {
+        a->cap = a->cap ? a->cap * 2 : 1024;
+        a->argv = realloc(a->argv, (size_t)a->cap * sizeof(char *));
+        if (!a->argv) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    a->argv[a->argc] = s ? strdup(s) : NULL;
+    if (s && !a->argv[a->argc]) {
+        perror("strdup");
+        exit(1);
+    }
+    a->argc++;
+}
+
+static void free_args(Args *a) {
+    for (int i = 0; i < a->argc; i++) free(a->argv[i]);
+    free(a->argv);
+}
+
+// A valid value for a flag of the given spec
+static void random_value(const Spec *s, char *buf, size_t size) {
+    static const char *sizes[] = { "4K", "1.5M", "123", "2GiB", "0" };
+    static const char *durations[] = { "250ms", "1h30m", "10s", "5us", "0" };
+    switch (s->type) {
+        case T_STRING:
+        case T_STRING_MULTI:
+            if (s->separator) {
+                int n = 1 + pick(3), len = 0;
+                for (int k = 0; k < n; k++) len += snprintf(buf + len, size - (size_t)len, "%sp%d", k ? ";" : "", pick(20));
+            } else {
+                snprintf(buf, size, "w%d", pick(40)); // Repeats, for the interned flag
+            }
+            break;
+        case T_INT:
+            if (pick(10) == 0) snprintf(buf, size, "+%03d", pick(100)); // Sign and leading zeros
+            else snprintf(buf, size, "%d", pick(20001) - 10000);
+            break;
+        case T_INT_MULTI: {
+            int n = 1 + pick(5), len = 0;
+            for (int k = 0; k < n; k++) len += snprintf(buf + len, size - (size_t)len, "%s%d", k ? "," : "", pick(2001) - 1000);
+            break;
+        }
+        case T_INT64:
+        case T_UINT64_MULTI:
+            snprintf(buf, size, "%llu", (unsigned long long)(rng() >> (s->type == T_INT64 ? 2 : 1)));
+            break;
+        case T_DOUBLE:
+        case T_DOUBLE_MULTI:
+            if (pick(4) == 0) snprintf(buf, size, "%de%d", pick(100), pick(10) - 5);
+            else snprintf(buf, size, "%d.%d", pick(1000) - 500, pick(1000));
+            break;
+        case T_SIZE:
+            snprintf(buf, size, "%s", sizes[pick(5)]);
+            break;
+        case T_DURATION:
+            snprintf(buf, size, "%s", durations[pick(5)]);
+            break;
+        default:
+            buf[0] = '\0';
+    }
+}
+
+// Append one flag (and its value) in a random spelling
+static void random_flag(Args *a) {
+    const Spec *s = &specs[pick(SPEC_COUNT)];
+    const char *name = s->alias && pick(3) == 0 ? s->alias : s->name;
+    char value[96], arg[160];
+    if (s->type == T_BOOL) {
+        if (pick(3) == 0 && name[1] == '-') snprintf(arg, sizeof(arg), "--no-%s", name + 2);
+        else snprintf(arg, sizeof(arg), "%s", name);
+        push(a, arg);
+        return;
+    }
+    random_value(s, value, sizeof(value));
+    if (name[1] == '-' && pick(2) == 0) {
+        snprintf(arg, sizeof(arg), "%s=%s", name, value);
+        push(a, arg);
+    } else {
+        push(a, name);
+        push(a, value);
+    }
+}
+
+// Append one argument the serial loop fails on
+static void random_error(Args *a, int abbrev) {
+    switch (pick(abbrev ? 7 : 6)) {
+        case 0:
+            push(a, "--nope");
+            break;
+        case 1:
+            push(a, "--count");
+            push(a, "x1");
+            break;
+        case 2:
+            push(a, "--count=99999999999"); // Out of range
+            break;
+        case 3:
+            push(a, "--id");
+            push(a, "1,,2");
+            break;
+        case 4:
+            push(a, "--mem=4Q");
+            break;
+        case 5: {
+            char arg[96];
+            snprintf(arg, sizeof(arg), "@%s/missing.args", dir);
+            push(a, arg);
+            break;
+        }
+        case 6:
+            push(a, "--ver"); // Ambiguous: --verbose and --version
+            break;
+    }
+}
+
+// Write a response file of about n arguments, possibly naming another one
+static void write_response_file(const char *path, int n, const char *nested, int bad) {
+    Args a = { 0 };
+    int at = nested ? pick(n + 1) : -1;
+    while (a.argc < n) {
+        if (a.argc >= at && at >= 0) {
+            char arg[100];
+            snprintf(arg, sizeof(arg), "@%s", nested);
+            push(&a, arg);
+            at = -1;
+        }
+        random_flag(&a);
+    }
+    if (bad) random_error(&a, 0);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    for (int i = 0; i < a.argc; i++) fprintf(f, "%s%c", a.argv[i], pick(8) ? ' ' : '\n');
+    fprintf(f, "--name \"quoted value %d\"\n", pick(10)); // Quoting only exists in files
+    fclose(f);
+    free_args(&a);
+}
+
+static void write_config(const char *path) {
+    static const char *lines[] = {
+        "name = cfg", "verbose = no", "count = 3", "tag = c1", "tag = c2", "id = 5,6",
+        "mem = 2K", "level = 4", "user = cfguser", "timeout = 5s", "path = x;y", "weight = 0.25",
+    };
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        if (pick(2)) fprintf(f, "%s\n", lines[i]);
+    }
+    fclose(f);
+}
+
+static void build(Side *side, int arena, int abbrev, const char *config) {
+    FlagSet *set = side->set = flagset_new();
+    if (arena) flagset_use_arena(set, NULL, 0);
+    flagset_allow_abbrev(set, abbrev);
+    flagset_env_prefix(set, "TPAR_");
+    for (int i = 0; i < SPEC_COUNT; i++) {
+        const Spec *s = &specs[i];
+        Flag *f = NULL;
+        switch (s->type) {
+            case T_STRING: f = flagset_string(set, "def", "", s->name, s->alias, NULL); break;
+            case T_BOOL: f = flagset_bool(set, 0, "", s->name, s->alias, NULL); break;
+            case T_INT:
+                f = i == LEVEL_SPEC ? flagset_int_var(set, &side->level, 1, "", s->name, NULL)
+                                    : flagset_int(set, 1, "", s->name, s->alias, NULL);
+                break;
+            case T_INT64: f = flagset_int64(set, -1, "", s->name, NULL); break;
+            case T_DOUBLE: f = flagset_double(set, 1.5, "", s->name, NULL); break;
+            case T_SIZE: f = flagset_size(set, 1024, "", s->name, NULL); break;
+            case T_DURATION: f = flagset_duration(set, 1000, "", s->name, NULL); break;
+            case T_STRING_MULTI: f = flagset_string_multi(set, NULL, "", s->name, s->alias, NULL); break;
+            case T_INT_MULTI: f = flagset_int_multi(set, 0, "", s->name, NULL); break;
+            case T_DOUBLE_MULTI: f = flagset_double_multi(set, 0, "", s->name, NULL); break;
+            case T_UINT64_MULTI: f = flagset_uint64_multi(set, 0, "", s->name, NULL); break;
+        }
+        if (s->separator) flag_separator(f, s->separator);
+        if (s->interned) flag_intern(f);
+        side->flags[i] = f;
+    }
+    if (config && flagset_load_config(set, config) != 0) {
+        fprintf(stderr, "config file rejected\n");
+        exit(1);
+    }
+    if (flagset_apply_env(set) != 0) {
+        fprintf(stderr, "environment rejected\n");
+        exit(1);
+    }
+}
+
+// Run one parse with stderr going to a file, keep what was printed
+static void parse(Side *side, Args *a, int threads) {
+    fflush(stderr);
+    FILE *capture = tmpfile();
+    int saved = dup(2);
+    if (!capture || saved < 0 || dup2(fileno(capture), 2) < 0) {
+        perror("capture stderr");
+        exit(1);
+    }
+    side->rc = threads ? flagset_parse_parallel(side->set, a->argc, a->argv, threads)
+                       : flagset_parse(side->set, a->argc, a->argv);
+    fflush(stderr);
+    dup2(saved, 2);
+    close(saved);
+    fseek(capture, 0, SEEK_END);
+    long len = ftell(capture);
+    side->messages = calloc(1, (size_t)len + 1);
+    if (!side->messages) {
+        perror("calloc");
+        exit(1);
+    }
+    rewind(capture);
+    if (len > 0 && fread(side->messages, 1, (size_t)len, capture) != (size_t)len) {
+        perror("fread");
+        exit(1);
+    }
+    fclose(capture);
+}
+
+static int report(const char *what, const char *flag, uint64_t seed) {
+    fprintf(stderr, "seed %llu: %s differs for %s\n", (unsigned long long)seed, what, flag);
+    failures++;
+    return 1;
+}
+
+// Compare every value of the two sets, returns non-zero on the first difference
+static int compare(Side *x, Side *y, uint64_t seed) {
+    if (x->rc != y->rc) return report("return code", "the parse", seed);
+    if (strcmp(x->messages, y->messages) != 0) return report("message", "the parse", seed);
+    if (x->level != y->level) return report("bound variable", "--level", seed);
+    for (int i = 0; i < SPEC_COUNT; i++) {
+        Flag *f = x->flags[i], *g = y->flags[i];
+        const char *name = specs[i].name;
+        int n = flag_get_multi_count(f);
+        switch (specs[i].type) {
+            case T_STRING:
+                if (strcmp(flag_get_string(f), flag_get_string(g)) != 0) return report("value", name, seed);
+                break;
+            case T_BOOL:
+                if (flag_get_bool(f) != flag_get_bool(g)) return report("value", name, seed);
+                break;
+            case T_INT:
+                if (flag_get_int(f) != flag_get_int(g)) return report("value", name, seed);
+                break;
+            case T_INT64:
+                if (flag_get_int64(f) != flag_get_int64(g)) return report("value", name, seed);
+                break;
+            case T_DOUBLE:
+                if (flag_get_double(f) != flag_get_double(g)) return report("value", name, seed);
+                break;
+            case T_SIZE:
+                if (flag_get_size(f) != flag_get_size(g)) return report("value", name, seed);
+                break;
+            case T_DURATION:
+                if (flag_get_duration(f) != flag_get_duration(g)) return report("value", name, seed);
+                break;
+            default:
+                if (n != flag_get_multi_count(g)) return report("count", name, seed);
+        }
+        switch (specs[i].type) {
+            case T_STRING_MULTI: {
+                const char **a = flag_get_string_multi(f), **b = flag_get_string_multi(g);
+                for (int k = 0; k < n; k++) {
+                    if (strcmp(a[k], b[k]) != 0) return report("value", name, seed);
+                    if (flag_get_string_id(f, k) != flag_get_string_id(g, k)) return report("string ID", name, seed);
+                }
+                if (flag_get_distinct_count(f) != flag_get_distinct_count(g)) return report("distinct count", name, seed);
+                break;
+            }
+            case T_INT_MULTI:
+                if (n && memcmp(flag_get_int_multi(f), flag_get_int_multi(g), (size_t)n * sizeof(int)) != 0) {
+                    return report("value", name, seed);
+                }
+                break;
+            case T_DOUBLE_MULTI:
+                for (int k = 0; k < n; k++) {
+                    if (flag_get_double_multi(f)[k] != flag_get_double_multi(g)[k]) return report("value", name, seed);
+                }
+                break;
+            case T_UINT64_MULTI:
+                if (n && memcmp(flag_get_uint64_multi(f), flag_get_uint64_multi(g), (size_t)n * sizeof(uint64_t)) != 0) {
+                    return report("value", name, seed);
+                }
+                break;
+        }
+    }
+    return 0;
+}
+
+static void run_case(uint64_t seed) {
+    rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    char small[96], large[96], config[96];
+    snprintf(small, sizeof(small), "%s/small.args", dir);
+    snprintf(large, sizeof(large), "%s/large.args", dir);
+    snprintf(config, sizeof(config), "%s/app.conf", dir);
+
+    int abbrev = pick(4) == 0;
+    int bad = pick(3) == 0; // One failing argument somewhere
+    int bad_in_file = bad && pick(4) == 0;
+    write_response_file(small, 50 + pick(200), NULL, bad_in_file && pick(2));
+    write_response_file(large, pick(2) ? 9000 + pick(8000) : 500, small, 0);
+    int use_config = pick(3) != 0;
+    if (use_config) write_config(config);
+
+    // Mostly long enough for several chunks, sometimes short (serial either way)
+    int n = pick(5) ? 8192 + pick(40000) : pick(9000);
+    int files = pick(4);
+    int error_at = bad && !bad_in_file ? pick(n + 1) : -1;
+    Args a = { 0 };
+    push(&a, "prog");
+    while (a.argc - 1 < n) {
+        if (a.argc - 1 >= error_at && error_at >= 0) {
+            random_error(&a, abbrev);
+            error_at = -1;
+        }
+        if (files && pick(n / 4 + 1) == 0) {
+            char arg[100];
+            snprintf(arg, sizeof(arg), "@%s", pick(2) ? large : small);
+            push(&a, arg);
+            files--;
+            continue;
+        }
+        random_flag(&a);
+    }
+    if (error_at >= 0) random_error(&a, abbrev);
+    if (bad && pick(5) == 0) push(&a, "--count"); // Missing value at the very end
+    push(&a, NULL);
+    a.argc--; // argv[argc] is NULL
+
+    int arena = pick(4) == 0;
+    Side serial = { 0 }, parallel = { 0 };
+    build(&serial, arena, abbrev, use_config ? config : NULL);
+    build(&parallel, arena, abbrev, use_config ? config : NULL);
+    parse(&serial, &a, 0);
+    parse(&parallel, &a, 2 + pick(7));
+    compare(&serial, &parallel, seed);
+
+    free(serial.messages);
+    free(parallel.messages);
+    flagset_free(serial.set);
+    flagset_free(parallel.set);
+    free_args(&a);
+    unlink(small);
+    unlink(large);
+    unlink(config);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t first = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    int cases = argc > 2 ? atoi(argv[2]) : 60;
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    // Environment layer under the command line, over the config file
+    setenv("TPAR_COUNT", "7", 1);
+    setenv("TPAR_TAG", "envtag", 1);
+    setenv("TPAR_ID", "9,8", 1);
+    setenv("TPAR_VERBOSE", "yes", 1);
+    setenv("TPAR_USER", "envuser", 1);
+    setenv("TPAR_RATIO", "0.5", 1);
+
+    for (int c = 0; c < cases; c++) run_case(first + (uint64_t)c);
+    rmdir(dir);
+    if (failures) {
+        fprintf(stderr, "%d case(s) failed, rerun one with: test_parallel <seed> 1\n", failures);
+        return 1;
+    }
+    printf("test_parallel: %d cases passed\n", cases);
+    return 0;
+}
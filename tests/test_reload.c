@@ -0,0 +1,220 @@
+// Hot reload: readers on other threads, layers kept, bound variables and
+// later changes published, pointers read outside a section kept alive
+//
+// Usage: test_reload [reloads [readers]]
+
+#define _POSIX_C_SOURCE 200809L // mkdtemp, setenv
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flagtool.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static char dir[] = "/tmp/flagtool-reload-XXXXXX";
+static char path[64], tmp[64];
+
+static void write_config(const char *text) {
+    FILE *f = fopen(tmp, "w");
+    if (!f || fputs(text, f) < 0 || fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror(tmp);
+        exit(1);
+    }
+}
+
+// Command line of generation n: every value derives from n
+typedef struct {
+    char port[32], name[32], ids[64];
+    char *argv[8];
+    int argc;
+} Generation;
+
+static void generation(Generation *g, int n) {
+    snprintf(g->port, sizeof(g->port), "--port=%d", n);
+    snprintf(g->name, sizeof(g->name), "--name=v%d", n);
+    snprintf(g->ids, sizeof(g->ids), "--ids=%d,%d,%d", n, n + 1, n + 2);
+    g->argc = 0;
+    g->argv[g->argc++] = "prog";
+    g->argv[g->argc++] = g->port;
+    g->argv[g->argc++] = g->name;
+    g->argv[g->argc++] = g->ids;
+    for (int k = 0; k < n % 3; k++) g->argv[g->argc++] = "--tag=t";
+    g->argv[g->argc] = NULL;
+}
+
+typedef struct {
+    FlagSet *set;
+    Flag *port, *name, *ids, *tags;
+    atomic_int stop;
+    atomic_int errors;
+} Shared;
+
+// Every read from one snapshot comes from the same generation
+static void *reader(void *arg) {
+    Shared *sh = arg;
+    long reads = 0;
+    while (!atomic_load(&sh->stop) || reads == 0) {
+        flag_read_lock();
+        FlagValues *now = flagset_snapshot(sh->set);
+        int port = flag_values_get_int(now, sh->port);
+        const char *name = flag_values_get_string(now, sh->name);
+        const int *ids = flag_values_get_int_multi(now, sh->ids);
+        int id_count = flag_values_get_multi_count(now, sh->ids);
+        int tags = flag_values_get_multi_count(now, sh->tags);
+        char want[32];
+        snprintf(want, sizeof(want), "v%d", port);
+        if (strcmp(name, want) != 0 || id_count != 3 || ids[0] != port || ids[2] != port + 2 || tags != port % 3) {
+            atomic_fetch_add(&sh->errors, 1);
+        }
+        const char *current = flag_get_string(sh->name); // Maybe a newer snapshot, valid until the unlock
+        if (current[0] != 'v' || atoi(current + 1) < port) atomic_fetch_add(&sh->errors, 1);
+        flag_read_unlock();
+
+        const char *outside = flag_get_string(sh->name); // Kept alive past later reloads
+        if (outside[0] != 'v') atomic_fetch_add(&sh->errors, 1);
+        reads++;
+    }
+    return NULL;
+}
+
+static void test_concurrent_readers(int reloads, int threads) {
+    FlagSet *set = flagset_new();
+    Shared sh = { 0 };
+    sh.set = set;
+    sh.port = flagset_int(set, 0, "Port", "--port", NULL);
+    sh.name = flagset_string(set, "v0", "Name", "--name", NULL);
+    sh.ids = flag_separator(flagset_int_multi(set, 0, "IDs", "--ids", NULL), ',');
+    sh.tags = flagset_string_multi(set, "", "Tags", "--tag", NULL);
+    Generation g;
+    generation(&g, 0);
+    CHECK(flagset_reload(set, g.argc, g.argv) == 0);
+
+    pthread_t tids[16];
+    if (threads > 16) threads = 16;
+    for (int t = 0; t < threads; t++) pthread_create(&tids[t], NULL, reader, &sh);
+    for (int n = 1; n <= reloads; n++) {
+        generation(&g, n);
+        CHECK(flagset_reload(set, g.argc, g.argv) == 0);
+    }
+    atomic_store(&sh.stop, 1);
+    for (int t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+    CHECK(atomic_load(&sh.errors) == 0);
+    CHECK(flag_get_int(sh.port) == reloads);
+    flagset_free(set);
+}
+
+// The config file and the environment stay under the new command line
+static void test_layers_kept() {
+    setenv("FTR_LEVEL", "7", 1);
+    setenv("FTR_HOST", "env-host", 1);
+    FlagSet *set = flagset_new();
+    flagset_env_prefix(set, "FTR_");
+    Flag *retries = flagset_int(set, 1, "Retries", "--retries", NULL);
+    Flag *level = flagset_int(set, 0, "Level", "--level", NULL);
+    Flag *host = flagset_string(set, "localhost", "Host", "--host", NULL);
+    Flag *port = flagset_int(set, 0, "Port", "--port", NULL);
+    write_config("retries = 3\nport = 80\n");
+    CHECK(flagset_load_config(set, path) == 0);
+    CHECK(flagset_apply_env(set) == 0);
+
+    char *first[] = { "prog", "--port=1", "--host=argv-host", NULL };
+    CHECK(flagset_reload(set, 3, first) == 0);
+    CHECK(flag_get_int(retries) == 3 && flag_get_int(level) == 7 && flag_get_int(port) == 1);
+    CHECK(strcmp(flag_get_string(host), "argv-host") == 0);
+
+    char *second[] = { "prog", NULL };
+    CHECK(flagset_reload(set, 1, second) == 0);
+    CHECK(flag_get_int(port) == 80); // The file's value again
+    CHECK(strcmp(flag_get_string(host), "env-host") == 0);
+
+    write_config("retries = 5\nport = 81\n");
+    CHECK(flagset_reload_config(set) == 0);
+    CHECK(flag_get_int(retries) == 5 && flag_get_int(port) == 81); // Published by the config reload
+    flagset_free(set);
+    unsetenv("FTR_LEVEL");
+    unsetenv("FTR_HOST");
+}
+
+// Bound variables follow every published snapshot
+static void test_bound_variables() {
+    FlagSet *set = flagset_new();
+    int port = 0, verbose = 0;
+    const char *name = NULL;
+    flagset_int_var(set, &port, 80, "Port", "--port", NULL);
+    flagset_bool_var(set, &verbose, 0, "Verbose", "--verbose", NULL);
+    flagset_string_var(set, &name, "app", "Name", "--name", NULL);
+    char *first[] = { "prog", "--port=1", "--verbose", "--name=one", NULL };
+    CHECK(flagset_reload(set, 4, first) == 0);
+    CHECK(port == 1 && verbose == 1 && strcmp(name, "one") == 0);
+    char *second[] = { "prog", "--name=two", NULL };
+    CHECK(flagset_reload(set, 2, second) == 0);
+    CHECK(port == 80 && verbose == 0 && strcmp(name, "two") == 0);
+    char *parse[] = { "prog", "--port=9", NULL };
+    CHECK(flagset_parse(set, 2, parse) == 0);
+    CHECK(port == 9 && strcmp(name, "two") == 0);
+    flagset_reset(set);
+    CHECK(port == 80 && strcmp(name, "app") == 0);
+    flagset_free(set);
+}
+
+// Plain parses and resets after a reload reach the getters
+static void test_later_changes_published() {
+    FlagSet *set = flagset_new();
+    Flag *port = flagset_int(set, 0, "Port", "--port", NULL);
+    Flag *tags = flag_intern(flagset_string_multi(set, "", "Tags", "--tag", NULL));
+    char *first[] = { "prog", "--port=1", "--tag=a", NULL };
+    CHECK(flagset_reload(set, 3, first) == 0);
+    const char *kept = flag_get_string_multi(tags)[0]; // Outside a section
+
+    char *parse[] = { "prog", "--port=2", "--tag=b", "--tag=a", NULL };
+    CHECK(flagset_parse(set, 4, parse) == 0);
+    CHECK(flag_get_int(port) == 2 && flag_get_multi_count(tags) == 3);
+    CHECK(flag_get_string_id(tags, 0) == flag_get_string_id(tags, 2));
+    CHECK(flag_get_string_id(tags, 1) != flag_get_string_id(tags, 0));
+
+    char *bad[] = { "prog", "--port=x", NULL };
+    CHECK(flagset_reload(set, 2, bad) != 0);
+    CHECK(flag_get_int(port) == 2);
+
+    flagset_reset(set);
+    CHECK(flag_get_int(port) == 0 && flag_get_multi_count(tags) == 0);
+    CHECK(strcmp(kept, "a") == 0); // Its snapshot was kept
+    flagset_free(set);
+}
+
+int main(int argc, char *argv[]) {
+    int reloads = argc > 1 ? atoi(argv[1]) : 2000;
+    int readers = argc > 2 ? atoi(argv[2]) : 4;
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/flags.conf", dir);
+    snprintf(tmp, sizeof(tmp), "%s/flags.conf.new", dir);
+
+    test_concurrent_readers(reloads, readers);
+    test_layers_kept();
+    test_bound_variables();
+    test_later_changes_published();
+
+    unlink(path);
+    rmdir(dir);
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_reload: all checks passed\n");
+    return 0;
+}